@@ -0,0 +1,606 @@
+/*
+ * Implementation of the REEact control socket.
+ *
+ * The statistics are kept in an open-addressing table keyed by the object
+ * and the kind of statistics. The table is only written by the event
+ * subscriber and read by the control thread, under an internal spin lock;
+ * the control thread copies the table out before writing it to the client,
+ * so that a slow client never holds up the delivery of events.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "reeact_control.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../events/reeact_events.h"
+#include "../policies/reeact_policy.h"
+#include "../policies/reeact_rules.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+/*
+ * the number of objects in the statistics table, must be a power of 2
+ */
+#define REEACT_CONTROL_STATS_SIZE 4096
+
+/*
+ * the longest command
+ */
+#define REEACT_CONTROL_LINE_SIZE 512
+
+/*
+ * the kinds of statistics
+ */
+#define REEACT_CONTROL_LOCK 0
+#define REEACT_CONTROL_BARRIER 1
+#define REEACT_CONTROL_COND 2
+
+static const char *reeact_control_kinds[] = {"lock", "barrier", "cond"};
+static const char *reeact_control_counts[] = {"contended", "episodes",
+					      "wakeups"};
+static const char *reeact_control_values[] = {"wait_ns", "skew_ns",
+					      "wait_ns"};
+
+/*
+ * the statistics of an object
+ *     obj: the object, NULL for an empty slot
+ *     kind: REEACT_CONTROL_*
+ *     count: the number of contentions, episodes or wake-ups
+ *     total, max: the total and the maximum wait time or arrival skew
+ */
+struct reeact_control_stat{
+	void *obj;
+	int kind;
+	unsigned long long count;
+	unsigned long long total;
+	unsigned long long max;
+};
+
+static struct reeact_control_stat *reeact_control_stats;
+static struct reeact_control_stat *reeact_control_snapshot;
+static unsigned long long reeact_control_overflow;
+static fastsync_spinlock reeact_control_stats_lock;
+
+/*
+ * the socket, its path, and the process that created it
+ */
+static int reeact_control_fd = -1;
+static struct sockaddr_un reeact_control_addr;
+static int reeact_control_pid;
+
+/*
+ * Write a reply to the client; the libc dprintf is hidden by the dprintf of
+ * reeact_utils.h.
+ */
+static void reeact_control_reply(int fd, const char *fmt, ...)
+{
+	char buf[256];
+	va_list args;
+	int len, ret, done = 0;
+
+	va_start(args, fmt);
+	len = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if(len >= sizeof(buf))
+		len = sizeof(buf) - 1;
+
+	while(done < len){
+		ret = send(fd, buf + done, len - done, MSG_NOSIGNAL);
+		if(ret < 0 && errno == EINTR)
+			continue;
+		if(ret <= 0)
+			return;
+		done += ret;
+	}
+
+	return;
+}
+
+/*
+ * Find the slot of an object, with reeact_control_stats_lock held.
+ * Return value:
+ *     the slot; NULL if the table is full
+ */
+static struct reeact_control_stat *reeact_control_slot(void *obj, int kind)
+{
+	unsigned long i, h;
+	struct reeact_control_stat *s;
+
+	h = ((unsigned long)obj >> 3) * 31 + kind;
+	for(i = 0; i < REEACT_CONTROL_STATS_SIZE; i++){
+		s = &(reeact_control_stats[(h + i) &
+					   (REEACT_CONTROL_STATS_SIZE - 1)]);
+		if(s->obj == obj && s->kind == kind)
+			return s;
+		if(s->obj == NULL){
+			s->obj = obj;
+			s->kind = kind;
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * The event subscriber: account an event to its object.
+ */
+static void reeact_control_event(const struct reeact_event *event, void *data)
+{
+	struct reeact_control_stat *s;
+	int kind;
+
+	switch(event->type){
+	case REEACT_EVENT_LOCK_CONTENDED:
+	case REEACT_EVENT_LOCK_ACQUIRED:
+		kind = REEACT_CONTROL_LOCK;
+		break;
+	case REEACT_EVENT_BARRIER_DONE:
+		kind = REEACT_CONTROL_BARRIER;
+		break;
+	case REEACT_EVENT_COND_WAKEUP:
+		kind = REEACT_CONTROL_COND;
+		break;
+	default:
+		return;
+	}
+
+	fastsync_spin_lock(&reeact_control_stats_lock);
+	s = reeact_control_slot(event->object, kind);
+	if(s == NULL){
+		reeact_control_overflow++;
+	}
+	else{
+		/* a contention is counted once, with its wait when acquired */
+		if(event->type != REEACT_EVENT_LOCK_ACQUIRED)
+			s->count++;
+		if(event->type != REEACT_EVENT_LOCK_CONTENDED){
+			s->total += event->value;
+			if(event->value > s->max)
+				s->max = event->value;
+		}
+	}
+	fastsync_spin_unlock(&reeact_control_stats_lock);
+
+	return;
+}
+
+/*
+ * the "stats" command
+ */
+static int reeact_control_cmd_stats(int fd, char *args)
+{
+	unsigned long long overflow;
+	struct reeact_control_stat *s;
+	int i;
+
+	fastsync_spin_lock(&reeact_control_stats_lock);
+	memcpy(reeact_control_snapshot, reeact_control_stats,
+	       sizeof(struct reeact_control_stat) * REEACT_CONTROL_STATS_SIZE);
+	overflow = reeact_control_overflow;
+	fastsync_spin_unlock(&reeact_control_stats_lock);
+
+	for(i = 0; i < REEACT_CONTROL_STATS_SIZE; i++){
+		s = &(reeact_control_snapshot[i]);
+		if(s->obj == NULL)
+			continue;
+		reeact_control_reply(fd, "%s %p %s=%llu %s=%llu max_%s=%llu\n",
+			reeact_control_kinds[s->kind], s->obj,
+			reeact_control_counts[s->kind], s->count,
+			reeact_control_values[s->kind], s->total,
+			reeact_control_values[s->kind], s->max);
+	}
+	reeact_control_reply(fd, "dropped %llu\noverflow %llu\n",
+			     reeact_events_dropped(), overflow);
+
+	return 0;
+}
+
+/*
+ * the "reset" command
+ */
+static int reeact_control_cmd_reset(int fd, char *args)
+{
+	fastsync_spin_lock(&reeact_control_stats_lock);
+	memset(reeact_control_stats, 0,
+	       sizeof(struct reeact_control_stat) * REEACT_CONTROL_STATS_SIZE);
+	reeact_control_overflow = 0;
+	fastsync_spin_unlock(&reeact_control_stats_lock);
+
+	return 0;
+}
+
+/*
+ * Find the cpu a thread last ran on, from /proc.
+ * Return value:
+ *     the cpu; -1 if it is not known
+ */
+static int reeact_control_thread_cpu(const char *tid)
+{
+	char path[64], buf[1024], *p;
+	int cpu = -1, i, len;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%s/stat", tid);
+	fp = fopen(path, "r");
+	if(fp == NULL)
+		return -1;
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	if(len <= 0)
+		return -1;
+	buf[len] = '\0';
+
+	/* "processor" is the 39th field, the 37th after the command name */
+	p = strrchr(buf, ')');
+	for(i = 0; p != NULL && i < 37; i++)
+		p = strchr(p + 1, ' ');
+	if(p != NULL)
+		cpu = atoi(p + 1);
+
+	return cpu;
+}
+
+/*
+ * the "threads" command
+ */
+static int reeact_control_cmd_threads(int fd, char *args)
+{
+	struct processor_topo *topo = NULL;
+	struct dirent *ent;
+	DIR *dir;
+	int cpu, node, socket;
+
+	if(reeact_handle != NULL && fastsync_load_topology() == 0)
+		topo = &(reeact_handle->topology);
+
+	dir = opendir("/proc/self/task");
+	if(dir == NULL)
+		return errno;
+	while((ent = readdir(dir)) != NULL){
+		if(ent->d_name[0] == '.')
+			continue;
+		cpu = reeact_control_thread_cpu(ent->d_name);
+		node = socket = -1;
+		if(topo != NULL && topo->cpu_nodes != NULL && cpu >= 0 &&
+		   cpu < topo->cpu_cnt)
+			node = topo->cpu_nodes[cpu];
+		if(topo != NULL && topo->node_sockets != NULL && node >= 0 &&
+		   node < topo->node_id_cnt)
+			socket = topo->node_sockets[node];
+		reeact_control_reply(fd, "thread %s cpu=%d node=%d socket=%d\n",
+			ent->d_name, cpu, node, socket);
+	}
+	closedir(dir);
+
+	return 0;
+}
+
+/*
+ * the "spin" command
+ */
+static int reeact_control_cmd_spin(int fd, char *args)
+{
+	char *what, *arg1, *arg2, *saveptr, *end;
+	int spin, rule, i;
+
+	what = strtok_r(args, " \t", &saveptr);
+	if(what == NULL){
+		reeact_control_reply(fd, "mutex %d\nbarrier %d\n",
+			reeact_rules_default_spin[REEACT_RULE_MUTEX],
+			reeact_rules_default_spin[REEACT_RULE_BARRIER]);
+		for(i = 0; i < reeact_rules_cnt; i++)
+			reeact_control_reply(fd, "rule %d %d\n", i,
+				atomic_read(reeact_rules[i].spin));
+		return 0;
+	}
+
+	arg1 = strtok_r(NULL, " \t", &saveptr);
+	arg2 = strtok_r(NULL, " \t", &saveptr);
+	if(arg1 == NULL)
+		return EINVAL;
+
+	if(strcmp(what, "rule") == 0){
+		if(arg2 == NULL)
+			return EINVAL;
+		rule = strtol(arg1, &end, 10);
+		if(*end != '\0')
+			return EINVAL;
+		spin = strtol(arg2, &end, 10);
+		if(*end != '\0')
+			return EINVAL;
+		return reeact_rules_set_spin(rule, spin);
+	}
+
+	if(arg2 != NULL)
+		return EINVAL;
+	spin = strtol(arg1, &end, 10);
+	if(*end != '\0')
+		return EINVAL;
+	if(strcmp(what, "mutex") == 0)
+		atomic_read(reeact_rules_default_spin[REEACT_RULE_MUTEX]) =
+			spin;
+	else if(strcmp(what, "barrier") == 0)
+		atomic_read(reeact_rules_default_spin[REEACT_RULE_BARRIER]) =
+			spin;
+	else
+		return EINVAL;
+
+	return 0;
+}
+
+/*
+ * the "policy" command
+ */
+static int reeact_control_cmd_policy(int fd, char *args)
+{
+	char *name, *saveptr;
+
+	name = strtok_r(args, " \t", &saveptr);
+	if(name == NULL){
+		reeact_control_reply(fd, "%s\n",
+				     atomic_read(reeact_active_policy)->name);
+		return 0;
+	}
+
+	return reeact_policy_switch(name);
+}
+
+static int reeact_control_cmd_help(int fd, char *args);
+
+/*
+ * the commands
+ */
+static const struct{
+	const char *name;
+	const char *usage;
+	int (*func)(int fd, char *args);
+} reeact_control_cmds[] = {
+	{"help", "help", reeact_control_cmd_help},
+	{"stats", "stats", reeact_control_cmd_stats},
+	{"threads", "threads", reeact_control_cmd_threads},
+	{"reset", "reset", reeact_control_cmd_reset},
+	{"spin", "spin [mutex N | barrier N | rule I N]",
+	 reeact_control_cmd_spin},
+	{"policy", "policy [NAME]", reeact_control_cmd_policy},
+	{"quit", "quit", NULL},
+};
+
+#define REEACT_CONTROL_CMD_CNT						\
+	(sizeof(reeact_control_cmds) / sizeof(reeact_control_cmds[0]))
+
+/*
+ * the "help" command
+ */
+static int reeact_control_cmd_help(int fd, char *args)
+{
+	int i;
+
+	for(i = 0; i < REEACT_CONTROL_CMD_CNT; i++)
+		reeact_control_reply(fd, "%s\n", reeact_control_cmds[i].usage);
+
+	return 0;
+}
+
+/*
+ * Run a command line and write the reply.
+ * Return value:
+ *     0: keep the connection
+ *     1: the client quits
+ */
+static int reeact_control_run(int fd, char *line)
+{
+	char *cmd, *args;
+	int i, ret_val;
+
+	cmd = line + strspn(line, " \t\r");
+	args = cmd + strcspn(cmd, " \t\r");
+	if(*args != '\0')
+		*args++ = '\0';
+	args[strcspn(args, "\r")] = '\0';
+	if(*cmd == '\0')
+		return 0;
+
+	for(i = 0; i < REEACT_CONTROL_CMD_CNT; i++)
+		if(strcmp(cmd, reeact_control_cmds[i].name) == 0)
+			break;
+	if(i == REEACT_CONTROL_CMD_CNT){
+		reeact_control_reply(fd,
+				     "error: unknown command %s, try help\n",
+				     cmd);
+		return 0;
+	}
+	if(reeact_control_cmds[i].func == NULL){
+		reeact_control_reply(fd, "ok\n");
+		return 1;
+	}
+
+	ret_val = reeact_control_cmds[i].func(fd, args);
+	if(ret_val == EINVAL)
+		reeact_control_reply(fd, "error: usage: %s\n",
+				     reeact_control_cmds[i].usage);
+	else if(ret_val)
+		reeact_control_reply(fd, "error: %s\n", strerror(ret_val));
+	else
+		reeact_control_reply(fd, "ok\n");
+
+	return 0;
+}
+
+/*
+ * Serve a connection until the client quits or closes it.
+ */
+static void reeact_control_serve(int fd)
+{
+	char buf[REEACT_CONTROL_LINE_SIZE];
+	int len = 0, ret, discard = 0;
+	char *line, *nl;
+
+	while(1){
+		ret = read(fd, buf + len, sizeof(buf) - 1 - len);
+		if(ret < 0 && errno == EINTR)
+			continue;
+		if(ret <= 0)
+			return;
+		len += ret;
+		buf[len] = '\0';
+
+		/* run the complete lines */
+		line = buf;
+		while((nl = strchr(line, '\n')) != NULL){
+			*nl = '\0';
+			if(discard)
+				discard = 0;
+			else if(reeact_control_run(fd, line))
+				return;
+			line = nl + 1;
+		}
+		len -= line - buf;
+		memmove(buf, line, len);
+
+		/* skip the rest of a line that is too long */
+		if(len == sizeof(buf) - 1){
+			if(!discard)
+				reeact_control_reply(
+					fd, "error: line too long\n");
+			discard = 1;
+			len = 0;
+		}
+	}
+}
+
+/*
+ * The control thread: serve the connections one at a time.
+ */
+static void *reeact_control_thread(void *arg)
+{
+	sigset_t mask;
+	int fd;
+
+	/* leave the signals to the application's threads */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	while(1){
+		fd = accept4(reeact_control_fd, NULL, NULL, SOCK_CLOEXEC);
+		if(fd < 0){
+			if(errno == EINTR || errno == ECONNABORTED)
+				continue;
+			/* the socket is shut down */
+			break;
+		}
+		reeact_control_serve(fd);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+/*
+ * start the control thread
+ */
+int reeact_control_init(void *data)
+{
+	const char *dir = getenv(REEACT_CONTROL_ENV);
+	pthread_t thread;
+	pthread_attr_t attr;
+	int len, ret_val;
+
+	if(dir == NULL || dir[0] == '\0')
+		return 0;
+
+	reeact_control_pid = getpid();
+	reeact_control_addr.sun_family = AF_UNIX;
+	len = snprintf(reeact_control_addr.sun_path,
+		       sizeof(reeact_control_addr.sun_path), "%s/reeact.%d",
+		       dir, reeact_control_pid);
+	if(len >= sizeof(reeact_control_addr.sun_path)){
+		LOGERR("Control socket path in %s is too long\n", dir);
+		return 1;
+	}
+
+	reeact_control_stats = (struct reeact_control_stat*)
+		calloc(REEACT_CONTROL_STATS_SIZE * 2,
+		       sizeof(struct reeact_control_stat));
+	if(reeact_control_stats == NULL){
+		LOGERRX("Unable to allocate memory for statistics: ");
+		return 3;
+	}
+	reeact_control_snapshot = reeact_control_stats +
+		REEACT_CONTROL_STATS_SIZE;
+	fastsync_spin_init(&reeact_control_stats_lock, 0);
+
+	reeact_control_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(reeact_control_fd < 0){
+		LOGERRX("Unable to create control socket: ");
+		return 2;
+	}
+	/* a socket left by an earlier process with the same pid */
+	unlink(reeact_control_addr.sun_path);
+	if(bind(reeact_control_fd, (struct sockaddr*)&reeact_control_addr,
+		sizeof(reeact_control_addr)) ||
+	   chmod(reeact_control_addr.sun_path, S_IRUSR | S_IWUSR) ||
+	   listen(reeact_control_fd, 4)){
+		LOGERRX("Unable to set up control socket %s: ",
+			reeact_control_addr.sun_path);
+		close(reeact_control_fd);
+		reeact_control_fd = -1;
+		return 2;
+	}
+
+	ret_val = reeact_events_subscribe(REEACT_EVENTS_LOCK |
+		REEACT_EVENT_MASK(REEACT_EVENT_BARRIER_DONE) |
+		REEACT_EVENT_MASK(REEACT_EVENT_COND_WAKEUP),
+		reeact_control_event, NULL);
+	if(ret_val)
+		LOGERR("Unable to subscribe to events, no statistics: %s\n",
+		       strerror(ret_val));
+
+	/* bypass the hooks, this thread is not part of the application */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret_val = real_pthread_create(&thread, &attr, reeact_control_thread,
+				      NULL);
+	pthread_attr_destroy(&attr);
+	if(ret_val){
+		LOGERR("Unable to create control thread: %s\n",
+		       strerror(ret_val));
+		reeact_control_cleanup(data);
+		return 4;
+	}
+
+	DPRINTF("control socket at %s\n", reeact_control_addr.sun_path);
+
+	return 0;
+}
+
+/*
+ * remove the socket
+ */
+int reeact_control_cleanup(void *data)
+{
+	/* a child process does not own the socket of its parent */
+	if(reeact_control_fd < 0 || getpid() != reeact_control_pid)
+		return 0;
+
+	/* wakes up the control thread blocked in accept */
+	shutdown(reeact_control_fd, SHUT_RDWR);
+	unlink(reeact_control_addr.sun_path);
+
+	return 0;
+}
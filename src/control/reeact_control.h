@@ -0,0 +1,69 @@
+/*
+ * Header file of the REEact control socket. When the REEACT_CONTROL
+ * environment variable names a directory, REEact starts a background thread
+ * that serves a Unix-domain socket named reeact.<pid> in that directory, so
+ * that a running process can be inspected and tuned without restarting it,
+ * e.g., with "socat - UNIX-CONNECT:/tmp/reeact.1234".
+ *
+ * The protocol is text, one command per line; the reply to a command is any
+ * number of lines followed by a line of "ok", or by a line starting with
+ * "error: ". The commands are:
+ *     help: list the commands
+ *     stats: the statistics of the locks, barriers and conditional variables
+ *            that have been waited on since the last reset, one per line:
+ *                lock ADDRESS contended=N wait_ns=TOTAL max_wait_ns=MAX
+ *                barrier ADDRESS episodes=N skew_ns=TOTAL max_skew_ns=MAX
+ *                cond ADDRESS wakeups=N wait_ns=TOTAL max_wait_ns=MAX
+ *            followed by the number of events dropped and the number of
+ *            objects that did not fit in the statistics table
+ *     threads: the threads of the process and where they run, one per line:
+ *                thread TID cpu=N node=N socket=N
+ *     reset: clear the statistics
+ *     spin: list the spin counts (see policies/reeact_rules.h)
+ *     spin mutex|barrier N: set the spin count of the mutexes or barriers
+ *                           that match no rule; negative to never block
+ *     spin rule I N: set the spin count of rule I
+ *     policy: print the active policy
+ *     policy NAME: switch to policy NAME (see reeact_policy_switch)
+ *     quit: close the connection
+ *
+ * The statistics are gathered with the event API (see
+ * events/reeact_events.h), so they cover the waits of the hooks that report
+ * events, and the control socket turns on the reporting of lock, barrier and
+ * cond events. Neither the control thread nor the event subscriber takes
+ * locks the application's threads use. One connection is served at a time.
+ * Note that with the control thread running, the process is no longer
+ * single-threaded for glibc (see reeact_single_threaded).
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_CONTROL_H__
+#define __REEACT_CONTROL_H__
+
+#define REEACT_CONTROL_ENV "REEACT_CONTROL"
+
+/*
+ * Start the control thread if REEACT_CONTROL is set.
+ * Input parameters:
+ *     data: the data used by the user policy. By default a pointer to the
+ *           "struct reeact_data" is passed.
+ * Return value:
+ *     0: success, or REEACT_CONTROL is not set
+ *     1: the socket path is too long
+ *     2: error creating the socket
+ *     3: error allocating space for statistics
+ *     4: error creating the control thread
+ */
+int reeact_control_init(void *data);
+
+/*
+ * Remove the socket of the process.
+ * Input parameters:
+ *     data: the same as reeact_control_init
+ * Return value:
+ *     0: success
+ */
+int reeact_control_cleanup(void *data);
+
+#endif
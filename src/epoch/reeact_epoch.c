@@ -0,0 +1,362 @@
+/*
+ * Implementation of the REEact epoch-based memory reclamation service.
+ *
+ * There is a global epoch counter. Every thread that reads has an epoch 
+ * record; entering a read-side critical section copies the global epoch into
+ * the record, tagged as active, and leaving clears it. The global epoch can 
+ * be advanced from e to e + 1 only when every active record is in epoch e. 
+ * An object deferred in epoch e may still be seen by readers in epoch e (or 
+ * e - 1, which started before the object is unlinked); once the global epoch
+ * reaches e + 2, none of these readers can be active, so the object is safe
+ * to free.
+ *
+ * Deferred objects are pushed on a lock-free stack. A background thread, 
+ * started on the first deferred free, takes them off the stack, advances the 
+ * global epoch and frees the objects whose grace period has passed. It 
+ * blocks on an eventcount when there is nothing to free.
+ *
+ * Threads register their records lazily on their first read-side critical
+ * section. The records are never freed: the record of an exited thread is 
+ * marked unused and reused by a later thread, so that the record list can be
+ * traversed without locks.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "reeact_epoch.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+/*
+ * the interval of the background thread when there are objects to free, in
+ * nanoseconds
+ */
+#define REEACT_EPOCH_INTERVAL 1000000
+
+/*
+ * the epoch record of a thread, on its own cache line
+ *     epoch: the epoch the thread is reading in, shifted left by 1, with the 
+ *            lowest bit set; 0 if the thread is not reading
+ *     nesting: the nesting level of read-side critical sections
+ *     in_use: 1 if the record belongs to a live thread
+ *     next: the next record in the list of all records
+ */
+struct reeact_epoch_record{
+	unsigned long epoch;
+	int nesting;
+	int in_use;
+	struct reeact_epoch_record *next;
+	char padding[64 - 2 * sizeof(unsigned long) - 2 * sizeof(int)];
+};
+
+/*
+ * an object waiting for its grace period
+ */
+struct reeact_epoch_deferred{
+	void *ptr; // the object to free
+	void (*free_func)(void*); // the function to free the object
+	unsigned long epoch; // the global epoch when the object is deferred
+	struct reeact_epoch_deferred *next;
+};
+
+/*
+ * the global epoch, on its own cache line
+ */
+static struct{
+	unsigned long epoch;
+	char padding[64 - sizeof(unsigned long)];
+} __attribute__((aligned(64))) reeact_global_epoch = {0};
+
+/*
+ * the list of all epoch records
+ */
+static struct reeact_epoch_record *reeact_epoch_records = NULL;
+
+/*
+ * the epoch record of current thread
+ */
+static __thread struct reeact_epoch_record *reeact_my_record = NULL;
+
+/*
+ * key to release the epoch record when a thread exits
+ */
+static pthread_key_t reeact_epoch_key;
+static pthread_once_t reeact_epoch_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * stack of deferred objects, and the eventcount the background thread 
+ * blocks on
+ */
+static struct reeact_epoch_deferred *reeact_epoch_pending = NULL;
+static fastsync_eventcount reeact_epoch_ec = {0, 0};
+
+/*
+ * the background thread
+ */
+static pthread_once_t reeact_epoch_thread_once = PTHREAD_ONCE_INIT;
+static int reeact_epoch_thread_started = 0;
+
+/*
+ * release the epoch record of an exited thread
+ */
+static void reeact_epoch_release(void *data)
+{
+	struct reeact_epoch_record *rec = (struct reeact_epoch_record*)data;
+
+	rec->nesting = 0;
+	atomic_read(rec->epoch) = 0;
+	gcc_barrier();
+	atomic_read(rec->in_use) = 0;
+
+	return;
+}
+
+static void reeact_epoch_key_init()
+{
+	if(pthread_key_create(&reeact_epoch_key, reeact_epoch_release))
+		LOGERR("Unable to create key for epoch records\n");
+}
+
+/*
+ * get an epoch record for current thread, reusing the record of an exited
+ * thread if possible
+ */
+static struct reeact_epoch_record *reeact_epoch_register()
+{
+	struct reeact_epoch_record *rec, *head;
+
+	pthread_once(&reeact_epoch_key_once, reeact_epoch_key_init);
+
+	for(rec = atomic_read(reeact_epoch_records); rec != NULL; 
+	    rec = rec->next){
+		if(atomic_read(rec->in_use) == 0 &&
+		   atomic_cmpxchg(&(rec->in_use), 0, 1) == 0)
+			goto found;
+	}
+
+	/* no free record, allocate a new one */
+	if(posix_memalign((void**)&rec, 64, 
+			  sizeof(struct reeact_epoch_record)))
+		return NULL;
+	memset(rec, 0, sizeof(struct reeact_epoch_record));
+	rec->in_use = 1;
+	do{
+		head = atomic_read(reeact_epoch_records);
+		rec->next = head;
+	}while(atomic_cmpxchg(&reeact_epoch_records, head, rec) != head);
+
+ found:
+	pthread_setspecific(reeact_epoch_key, rec);
+	reeact_my_record = rec;
+
+	return rec;
+}
+
+/*
+ * enter a read-side critical section
+ */
+int reeact_read_lock()
+{
+	struct reeact_epoch_record *rec = reeact_my_record;
+
+	if(rec == NULL){
+		rec = reeact_epoch_register();
+		if(rec == NULL)
+			return ENOMEM;
+	}
+
+	if(rec->nesting++ == 0){
+		atomic_read(rec->epoch) = 
+			(atomic_read(reeact_global_epoch.epoch) << 1) | 1;
+		/* announce the epoch before reading the shared data */
+		mem_barrier();
+	}
+
+	return 0;
+}
+
+/*
+ * leave a read-side critical section
+ */
+int reeact_read_unlock()
+{
+	struct reeact_epoch_record *rec = reeact_my_record;
+
+	if(rec == NULL || rec->nesting == 0)
+		return EPERM;
+
+	if(--rec->nesting == 0){
+		/* finish reading the shared data before leaving */
+		gcc_barrier();
+		atomic_read(rec->epoch) = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Try to advance the global epoch. 
+ * Return value:
+ *     the global epoch after the attempt
+ */
+static unsigned long reeact_epoch_try_advance()
+{
+	struct reeact_epoch_record *rec;
+	unsigned long epoch, e;
+
+	epoch = atomic_read(reeact_global_epoch.epoch);
+	mem_barrier();
+
+	for(rec = atomic_read(reeact_epoch_records); rec != NULL; 
+	    rec = rec->next){
+		e = atomic_read(rec->epoch);
+		if((e & 1) && (e >> 1) != epoch)
+			/* someone is still reading in an older epoch */
+			return epoch;
+	}
+
+	/* other threads may be advancing too; only one of them succeeds */
+	atomic_cmpxchg(&(reeact_global_epoch.epoch), epoch, epoch + 1);
+
+	return atomic_read(reeact_global_epoch.epoch);
+}
+
+/*
+ * The background thread: collect the deferred objects, advance the global
+ * epoch and free the objects whose grace period has passed.
+ */
+static void *reeact_epoch_thread(void *arg)
+{
+	struct reeact_epoch_deferred *limbo = NULL; // objects to free
+	struct reeact_epoch_deferred *d, *next, **prev;
+	struct timespec interval = {0, REEACT_EPOCH_INTERVAL};
+	unsigned long epoch;
+	int key;
+
+	while(1){
+		/* take the newly deferred objects */
+		d = atomic_xchg(&reeact_epoch_pending, NULL);
+		while(d != NULL){
+			next = d->next;
+			d->next = limbo;
+			limbo = d;
+			d = next;
+		}
+
+		if(limbo == NULL){
+			/* nothing to free, wait for a deferred object */
+			fastsync_eventcount_prepare_wait(&reeact_epoch_ec,
+							 &key);
+			if(atomic_read(reeact_epoch_pending) != NULL)
+				fastsync_eventcount_cancel_wait(
+					&reeact_epoch_ec);
+			else
+				fastsync_eventcount_commit_wait(
+					&reeact_epoch_ec, key);
+			continue;
+		}
+
+		/* free the objects that are two epochs old */
+		epoch = reeact_epoch_try_advance();
+		prev = &limbo;
+		for(d = limbo; d != NULL; d = next){
+			next = d->next;
+			if(epoch - d->epoch >= 2){
+				*prev = next;
+				d->free_func(d->ptr);
+				free(d);
+			}
+			else
+				prev = &(d->next);
+		}
+
+		if(limbo != NULL)
+			nanosleep(&interval, NULL);
+	}
+
+	return NULL;
+}
+
+static void reeact_epoch_thread_init()
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+	int (*create)(pthread_t*, const pthread_attr_t*, void *(*)(void*), 
+		      void*);
+
+	/* bypass the hooks, this thread is not part of the application */
+	create = real_pthread_create ? real_pthread_create : pthread_create;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(create(&thread, &attr, reeact_epoch_thread, NULL) == 0)
+		reeact_epoch_thread_started = 1;
+	else
+		LOGERR("Unable to create epoch reclamation thread\n");
+	pthread_attr_destroy(&attr);
+}
+
+/*
+ * free an object after a grace period
+ */
+int reeact_defer_free(void *ptr, void (*free_func)(void*))
+{
+	struct reeact_epoch_deferred *d, *head;
+
+	pthread_once(&reeact_epoch_thread_once, reeact_epoch_thread_init);
+	if(!reeact_epoch_thread_started)
+		return EAGAIN;
+
+	d = (struct reeact_epoch_deferred*)
+		malloc(sizeof(struct reeact_epoch_deferred));
+	if(d == NULL)
+		return ENOMEM;
+
+	d->ptr = ptr;
+	d->free_func = free_func ? free_func : free;
+	/* the object is unlinked before this read of the epoch */
+	mem_barrier();
+	d->epoch = atomic_read(reeact_global_epoch.epoch);
+
+	do{
+		head = atomic_read(reeact_epoch_pending);
+		d->next = head;
+	}while(atomic_cmpxchg(&reeact_epoch_pending, head, d) != head);
+
+	fastsync_eventcount_notify(&reeact_epoch_ec);
+
+	return 0;
+}
+
+/*
+ * wait for a grace period
+ */
+int reeact_synchronize()
+{
+	unsigned long target;
+
+	if(reeact_my_record != NULL && reeact_my_record->nesting != 0)
+		return EDEADLK;
+
+	mem_barrier();
+	target = atomic_read(reeact_global_epoch.epoch) + 2;
+
+	while((long)(reeact_epoch_try_advance() - target) < 0)
+		sched_yield();
+
+	return 0;
+}
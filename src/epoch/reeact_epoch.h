@@ -0,0 +1,61 @@
+/*
+ * Header file of the REEact epoch-based memory reclamation service. Readers
+ * of a shared data structure enclose their accesses with reeact_read_lock and
+ * reeact_read_unlock; writers unlink an object from the structure and then
+ * hand it to reeact_defer_free, which frees it once every reader that might
+ * still see it has left its read-side critical section. Readers only write
+ * their own per-thread epoch, which is on its own cache line.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_EPOCH_H__
+#define __REEACT_EPOCH_H__
+
+/*
+ * Enter a read-side critical section. Critical sections can be nested. 
+ * Input parameters:
+ *     none
+ * Return value:
+ *     0: success
+ *     ENOMEM: unable to allocate the epoch record of this thread
+ */
+int reeact_read_lock();
+
+/*
+ * Leave a read-side critical section.
+ * Input parameters:
+ *     none
+ * Return value:
+ *     0: success
+ *     EPERM: the calling thread is not in a read-side critical section
+ */
+int reeact_read_unlock();
+
+/*
+ * Free an object after a grace period, i.e., after all read-side critical 
+ * sections that were running when this function is called have finished. 
+ * The object should have been made unreachable to new readers already. The 
+ * object is freed by a background thread.
+ * Input parameters:
+ *     ptr: the object to free
+ *     free_func: the function to free the object; free() if NULL
+ * Return value:
+ *     0: success
+ *     ENOMEM: unable to allocate the bookkeeping of the deferred free
+ *     EAGAIN: unable to start the background thread
+ */
+int reeact_defer_free(void *ptr, void (*free_func)(void*));
+
+/*
+ * Wait for a grace period. Must not be called in a read-side critical 
+ * section.
+ * Input parameters:
+ *     none
+ * Return value:
+ *     0: success
+ *     EDEADLK: called in a read-side critical section
+ */
+int reeact_synchronize();
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * Implementation of the REEact event API.
+ *
+ * Every thread that reports an event gets a ring buffer of
+ * REEACT_EVENTS_BUFFER_SIZE events, with a single producer (the thread) and a
+ * single consumer (the poll, which is serialized by a lock). The producer
+ * only writes the head and the consumer only writes the tail, each on its own
+ * cache line. Buffers are registered lazily on the first event of a thread
+ * and are never freed: the buffer of an exited thread is marked unused and
+ * reused by a later thread, so that the buffer list can be traversed without
+ * locks. Events left in a buffer by an exited thread are still delivered.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "reeact_events.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../threads/reeact_threads.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+/*
+ * the number of events in a buffer, must be a power of 2
+ */
+#define REEACT_EVENTS_BUFFER_SIZE 1024
+
+/*
+ * the interval of the background thread, in nanoseconds
+ */
+#define REEACT_EVENTS_INTERVAL 10000000
+
+/*
+ * the event buffer of a thread
+ *     head: the number of events reported, only written by the owner
+ *     tail: the number of events delivered, only written by the poll
+ *     in_use: 1 if the buffer belongs to a live thread
+ *     next: the next buffer in the list of all buffers
+ *     events: the ring of events
+ */
+struct reeact_events_buffer{
+	unsigned long long head;
+	char padding1[64 - sizeof(unsigned long long)];
+	unsigned long long tail;
+	int in_use;
+	struct reeact_events_buffer *next;
+	char padding2[64 - sizeof(unsigned long long) - sizeof(int) -
+		      sizeof(void*)];
+	struct reeact_event events[REEACT_EVENTS_BUFFER_SIZE];
+};
+
+/*
+ * a subscriber
+ */
+struct reeact_events_subscriber{
+	unsigned int mask;
+	reeact_events_callback callback;
+	void *data;
+};
+
+/*
+ * the types of events the subscribers want
+ */
+unsigned int reeact_events_mask = 0;
+
+/*
+ * the subscribers, protected by reeact_events_sub_lock
+ */
+static struct reeact_events_subscriber
+reeact_events_subs[REEACT_EVENTS_MAX_SUBSCRIBERS];
+static int reeact_events_sub_cnt = 0;
+static fastsync_spinlock reeact_events_sub_lock;
+
+/*
+ * the list of all buffers, and the lock serializing the polls
+ */
+static struct reeact_events_buffer *reeact_events_buffers = NULL;
+static fastsync_spinlock reeact_events_poll_lock;
+
+/*
+ * the number of events dropped because a buffer was full
+ */
+static unsigned long long reeact_events_dropped_cnt = 0;
+
+/*
+ * the buffer and thread id of current thread; a thread stops reporting
+ * events once its buffer is released at exit
+ */
+static __thread struct reeact_events_buffer *reeact_my_buffer = NULL;
+static __thread int reeact_my_tid = 0;
+static __thread int reeact_my_buffer_released = 0;
+
+/*
+ * key to release the buffer when a thread exits
+ */
+static pthread_key_t reeact_events_key;
+static pthread_once_t reeact_events_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * the background thread
+ */
+static pthread_once_t reeact_events_thread_once = PTHREAD_ONCE_INIT;
+static int reeact_events_thread_started = 0;
+
+/*
+ * the state of a barrier kept in its side table entry: the time of the
+ * first arrival of the current episode, 0 if no thread has arrived yet
+ */
+struct reeact_events_barrier{
+	unsigned long long first;
+};
+_Static_assert(sizeof(struct reeact_events_barrier) <=
+	       sizeof(((reeact_sidetable_entry*)0)->data),
+	       "barrier event state does not fit in a side table entry");
+
+/*
+ * release the buffer of an exited thread
+ */
+static void reeact_events_release(void *data)
+{
+	struct reeact_events_buffer *buf = (struct reeact_events_buffer*)data;
+
+	reeact_my_buffer = NULL;
+	reeact_my_buffer_released = 1;
+	gcc_barrier();
+	atomic_read(buf->in_use) = 0;
+
+	return;
+}
+
+static void reeact_events_key_init()
+{
+	if(pthread_key_create(&reeact_events_key, reeact_events_release))
+		LOGERR("Unable to create key for event buffers\n");
+}
+
+/*
+ * get a buffer for current thread, reusing the buffer of an exited thread if
+ * possible
+ */
+static struct reeact_events_buffer *reeact_events_register()
+{
+	struct reeact_events_buffer *buf, *head;
+
+	pthread_once(&reeact_events_key_once, reeact_events_key_init);
+
+	for(buf = atomic_read(reeact_events_buffers); buf != NULL;
+	    buf = buf->next)
+		if(atomic_read(buf->in_use) == 0 &&
+		   atomic_cmpxchg(&(buf->in_use), 0, 1) == 0)
+			break;
+
+	if(buf == NULL){
+		if(posix_memalign((void**)&buf, 64, sizeof(*buf)) != 0)
+			return NULL;
+		memset(buf, 0, sizeof(*buf));
+		buf->in_use = 1;
+		do{
+			head = atomic_read(reeact_events_buffers);
+			buf->next = head;
+		}while(atomic_cmpxchg(&reeact_events_buffers, head, buf)
+		       != head);
+	}
+
+	pthread_setspecific(reeact_events_key, buf);
+	reeact_my_tid = syscall(SYS_gettid);
+	reeact_my_buffer = buf;
+
+	return buf;
+}
+
+/*
+ * find where current thread runs
+ */
+static void reeact_events_locate(struct reeact_event *event)
+{
+	struct processor_topo *topo;
+	int cpu = sched_getcpu();
+	int node = -1, socket = -1;
+
+	if(reeact_handle != NULL && cpu >= 0 && fastsync_topology_known()){
+		topo = &(reeact_handle->topology);
+		if(topo->cpu_nodes != NULL && cpu < topo->cpu_cnt)
+			node = topo->cpu_nodes[cpu];
+		if(topo->node_sockets != NULL && node >= 0 &&
+		   node < topo->node_id_cnt)
+			socket = topo->node_sockets[node];
+	}
+
+	event->core = cpu;
+	event->node = node;
+	event->socket = socket;
+
+	return;
+}
+
+/*
+ * report an event of current thread
+ */
+void reeact_events_emit(int type, void *object, unsigned long long value)
+{
+	struct reeact_events_buffer *buf = reeact_my_buffer;
+	struct reeact_thread *rec = reeact_threads_current();
+	struct reeact_event *event;
+
+	if(!reeact_events_enabled(REEACT_EVENT_MASK(type)))
+		return;
+
+	/* the statistics of the thread, even if the event is dropped */
+	if(rec != NULL && type == REEACT_EVENT_LOCK_ACQUIRED){
+		rec->stats.lock_waits++;
+		rec->stats.lock_wait_ns += value;
+	}
+	else if(rec != NULL && type == REEACT_EVENT_COND_WAKEUP){
+		rec->stats.cond_waits++;
+		rec->stats.cond_wait_ns += value;
+	}
+
+	if(buf == NULL){
+		if(reeact_my_buffer_released ||
+		   (buf = reeact_events_register()) == NULL)
+			return;
+	}
+
+	/* never wait for the subscribers */
+	if(buf->head - atomic_read(buf->tail) >= REEACT_EVENTS_BUFFER_SIZE){
+		atomic_addf(&reeact_events_dropped_cnt, 1);
+		return;
+	}
+
+	event = &(buf->events[buf->head & (REEACT_EVENTS_BUFFER_SIZE - 1)]);
+	event->time = reeact_events_now();
+	event->value = value;
+	event->object = object;
+	event->type = type;
+	event->tid = reeact_my_tid;
+	reeact_events_locate(event);
+	if(rec != NULL)
+		reeact_threads_ran_on(rec, event->core, event->node,
+				      event->socket);
+
+	/* publish the event after it is written */
+	gcc_barrier();
+	atomic_read(buf->head) = buf->head + 1;
+
+	return;
+}
+
+/*
+ * deliver the buffered events
+ */
+int reeact_events_poll(void)
+{
+	struct reeact_events_subscriber subs[REEACT_EVENTS_MAX_SUBSCRIBERS];
+	struct reeact_events_buffer *buf;
+	struct reeact_event *event;
+	unsigned long long head;
+	int sub_cnt, i, cnt = 0;
+
+	fastsync_spin_lock(&reeact_events_sub_lock);
+	sub_cnt = reeact_events_sub_cnt;
+	memcpy(subs, reeact_events_subs, sizeof(subs[0]) * sub_cnt);
+	fastsync_spin_unlock(&reeact_events_sub_lock);
+
+	fastsync_spin_lock(&reeact_events_poll_lock);
+	for(buf = atomic_read(reeact_events_buffers); buf != NULL;
+	    buf = buf->next){
+		head = atomic_read(buf->head);
+		gcc_barrier();
+		while(buf->tail != head){
+			event = &(buf->events[buf->tail &
+					      (REEACT_EVENTS_BUFFER_SIZE - 1)]);
+			for(i = 0; i < sub_cnt; i++)
+				if(subs[i].mask & REEACT_EVENT_MASK(event->type))
+					subs[i].callback(event, subs[i].data);
+			/* let the owner reuse the slot */
+			gcc_barrier();
+			atomic_read(buf->tail) = buf->tail + 1;
+			cnt++;
+		}
+	}
+	fastsync_spin_unlock(&reeact_events_poll_lock);
+
+	return cnt;
+}
+
+/*
+ * The background thread: deliver the buffered events periodically.
+ */
+static void *reeact_events_thread(void *arg)
+{
+	struct timespec interval = {0, REEACT_EVENTS_INTERVAL};
+
+	while(1){
+		nanosleep(&interval, NULL);
+		reeact_events_poll();
+	}
+
+	return NULL;
+}
+
+static void reeact_events_thread_init()
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	/* bypass the hooks, this thread is not part of the application */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(real_pthread_create(&thread, &attr, reeact_events_thread, NULL)
+	   == 0)
+		reeact_events_thread_started = 1;
+	else
+		LOGERR("Unable to create event delivery thread\n");
+	pthread_attr_destroy(&attr);
+}
+
+/*
+ * recompute the mask of wanted events, with reeact_events_sub_lock held
+ */
+static void reeact_events_update_mask()
+{
+	unsigned int mask = 0;
+	int i;
+
+	for(i = 0; i < reeact_events_sub_cnt; i++)
+		mask |= reeact_events_subs[i].mask;
+
+	atomic_read(reeact_events_mask) = mask;
+
+	return;
+}
+
+/*
+ * subscribe to events
+ */
+int reeact_events_subscribe(unsigned int mask, reeact_events_callback callback,
+			    void *data)
+{
+	mask &= REEACT_EVENTS_ALL;
+	if(mask == 0 || callback == NULL)
+		return EINVAL;
+
+	fastsync_spin_lock(&reeact_events_sub_lock);
+	if(reeact_events_sub_cnt == REEACT_EVENTS_MAX_SUBSCRIBERS){
+		fastsync_spin_unlock(&reeact_events_sub_lock);
+		return ENOSPC;
+	}
+	reeact_events_subs[reeact_events_sub_cnt].mask = mask;
+	reeact_events_subs[reeact_events_sub_cnt].callback = callback;
+	reeact_events_subs[reeact_events_sub_cnt].data = data;
+	reeact_events_sub_cnt++;
+	reeact_events_update_mask();
+	fastsync_spin_unlock(&reeact_events_sub_lock);
+
+	pthread_once(&reeact_events_thread_once, reeact_events_thread_init);
+
+	return 0;
+}
+
+/*
+ * unsubscribe
+ */
+int reeact_events_unsubscribe(reeact_events_callback callback, void *data)
+{
+	int i;
+
+	fastsync_spin_lock(&reeact_events_sub_lock);
+	for(i = 0; i < reeact_events_sub_cnt; i++)
+		if(reeact_events_subs[i].callback == callback &&
+		   reeact_events_subs[i].data == data)
+			break;
+	if(i == reeact_events_sub_cnt){
+		fastsync_spin_unlock(&reeact_events_sub_lock);
+		return ENOENT;
+	}
+	reeact_events_sub_cnt--;
+	memmove(&(reeact_events_subs[i]), &(reeact_events_subs[i + 1]),
+		sizeof(reeact_events_subs[0]) * (reeact_events_sub_cnt - i));
+	reeact_events_update_mask();
+	fastsync_spin_unlock(&reeact_events_sub_lock);
+
+	return 0;
+}
+
+/*
+ * get the number of dropped events
+ */
+unsigned long long reeact_events_dropped(void)
+{
+	return atomic_read(reeact_events_dropped_cnt);
+}
+
+/*
+ * record the arrival at a barrier
+ */
+unsigned long long reeact_events_barrier_arrive(void *barrier)
+{
+	reeact_sidetable_entry *entry;
+	struct reeact_events_barrier *state;
+	unsigned long long now = reeact_events_now();
+
+	if(reeact_sidetable_get(barrier, REEACT_SIDETABLE_EVENTS, NULL, NULL,
+				&entry) != 0)
+		return now;
+
+	state = (struct reeact_events_barrier*)entry->data;
+	if(atomic_read(state->first) == 0)
+		atomic_cmpxchg(&(state->first), 0, now);
+
+	return now;
+}
+
+/*
+ * report the end of a barrier episode
+ */
+void reeact_events_barrier_done(void *barrier, unsigned long long arrival)
+{
+	reeact_sidetable_entry *entry = reeact_sidetable_lookup(barrier);
+	struct reeact_events_barrier *state;
+	unsigned long long first;
+
+	if(entry == NULL || entry->type != REEACT_SIDETABLE_EVENTS)
+		return;
+
+	state = (struct reeact_events_barrier*)entry->data;
+	first = atomic_xchg(&(state->first), 0);
+	if(first == 0)
+		return;
+	/* taken from the next episode, put it back */
+	if(first > arrival){
+		atomic_cmpxchg(&(state->first), 0, first);
+		return;
+	}
+
+	reeact_events_emit(REEACT_EVENT_BARRIER_DONE, barrier, arrival - first);
+
+	return;
+}
@@ -0,0 +1,240 @@
+/*
+ * Header file of the REEact event API. A policy (or any other part of REEact)
+ * that only needs to watch the synchronization behaviour of the application
+ * subscribes to events, instead of re-implementing the hooks. The built-in
+ * policies report the events from their hooks. A thread writes its events to
+ * its own ring buffer, without locks or system calls, and the subscribers are
+ * called later by a background thread (or by reeact_events_poll), so they
+ * never slow down the hooks. Without subscribers, a hook only tests a global
+ * mask. A full buffer drops new events instead of waiting for the
+ * subscribers.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_EVENTS_H__
+#define __REEACT_EVENTS_H__
+
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+/*
+ * Event types. The object and the value of an event depend on its type:
+ *     THREAD_CREATE: a thread created with pthread_create starts; object is
+ *                    its start routine, value is 0
+ *     THREAD_EXIT: the thread exits; object is its start routine, value is
+ *                  its run time in nanoseconds
+ *     LOCK_CONTENDED: a mutex, rwlock or spinlock is not available right
+ *                     away; object is the lock, value is 0
+ *     LOCK_ACQUIRED: the lock is acquired after the wait; object is the
+ *                    lock, value is the wait time in nanoseconds
+ *     BARRIER_DONE: the last thread arrives at a barrier; object is the
+ *                   barrier, value is the arrival skew, i.e., the time
+ *                   between the first and the last arrivals, in nanoseconds
+ *     COND_WAKEUP: a thread waiting on a conditional variable is woken up
+ *                  (not timed out); object is the conditional variable, value
+ *                  is the wait time in nanoseconds
+ */
+#define REEACT_EVENT_THREAD_CREATE 0
+#define REEACT_EVENT_THREAD_EXIT 1
+#define REEACT_EVENT_LOCK_CONTENDED 2
+#define REEACT_EVENT_LOCK_ACQUIRED 3
+#define REEACT_EVENT_BARRIER_DONE 4
+#define REEACT_EVENT_COND_WAKEUP 5
+#define REEACT_EVENT_TYPES 6
+
+/*
+ * masks of event types, for subscribing and for testing in the hooks
+ */
+#define REEACT_EVENT_MASK(type) (1U << (type))
+#define REEACT_EVENTS_THREAD (REEACT_EVENT_MASK(REEACT_EVENT_THREAD_CREATE) |\
+			      REEACT_EVENT_MASK(REEACT_EVENT_THREAD_EXIT))
+#define REEACT_EVENTS_LOCK (REEACT_EVENT_MASK(REEACT_EVENT_LOCK_CONTENDED) | \
+			    REEACT_EVENT_MASK(REEACT_EVENT_LOCK_ACQUIRED))
+#define REEACT_EVENTS_ALL ((1U << REEACT_EVENT_TYPES) - 1)
+
+/*
+ * An event.
+ *     time: when the event happened, CLOCK_MONOTONIC in nanoseconds
+ *     value: depends on the type, see above
+ *     object: depends on the type, see above
+ *     type: REEACT_EVENT_*
+ *     tid: the thread id (gettid) of the thread reporting the event
+ *     core: the cpu (SMT context) the thread was running on
+ *     node: the node of the cpu; -1 if the topology is not known
+ *     socket: the socket of the cpu; -1 if the topology is not known
+ */
+struct reeact_event{
+	unsigned long long time;
+	unsigned long long value;
+	void *object;
+	int type;
+	int tid;
+	short core;
+	short node;
+	short socket;
+};
+
+/*
+ * A subscriber. It is called from the background thread, or from the
+ * thread calling reeact_events_poll, with the events of one thread at a time
+ * in the order they were reported; events of different threads are not
+ * ordered. A subscriber must not block on the application's locks.
+ *     event: the event
+ *     data: the data given to reeact_events_subscribe
+ */
+typedef void (*reeact_events_callback)(const struct reeact_event *event,
+				       void *data);
+
+/*
+ * the types of events some subscriber wants, tested by the hooks
+ */
+extern unsigned int reeact_events_mask;
+
+static inline int reeact_events_enabled(unsigned int mask)
+{
+	return (reeact_events_mask & mask) != 0;
+}
+
+/*
+ * the time stamp of events, CLOCK_MONOTONIC (from the vDSO) in nanoseconds
+ */
+static inline unsigned long long reeact_events_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Subscribe to events. The background thread that calls the subscribers is
+ * started on the first subscription.
+ * Input parameters:
+ *     mask: the types of events to receive, see REEACT_EVENT_MASK
+ *     callback: the subscriber
+ *     data: passed to the subscriber
+ * Return value:
+ *     0: success
+ *     EINVAL: mask or callback is empty
+ *     ENOSPC: there are REEACT_EVENTS_MAX_SUBSCRIBERS subscribers already
+ */
+#define REEACT_EVENTS_MAX_SUBSCRIBERS 8
+int reeact_events_subscribe(unsigned int mask, reeact_events_callback callback,
+			    void *data);
+
+/*
+ * Unsubscribe. A poll that is already running may still call the subscriber.
+ * Input parameters:
+ *     callback, data: the same as given to reeact_events_subscribe
+ * Return value:
+ *     0: success
+ *     ENOENT: no such subscriber
+ */
+int reeact_events_unsubscribe(reeact_events_callback callback, void *data);
+
+/*
+ * Deliver the buffered events to the subscribers now, e.g., from a policy
+ * that makes decisions on its own thread. Polls are serialized.
+ * Return value:
+ *     the number of events delivered
+ */
+int reeact_events_poll(void);
+
+/*
+ * Get the number of events dropped because a buffer was full.
+ */
+unsigned long long reeact_events_dropped(void);
+
+/*
+ * Report an event of the calling thread, if some subscriber wants its type.
+ * Input parameters:
+ *     type: REEACT_EVENT_*
+ *     object, value: depend on the type, see above
+ */
+void reeact_events_emit(int type, void *object, unsigned long long value);
+
+/*
+ * Helpers of the hooks to report events.
+ *
+ * REEACT_EVENTS_OBSERVE_LOCK returns from the hook with the result of the
+ * acquisition if lock events are wanted: trylock_call is tried first, and if
+ * it fails with EBUSY, the contention and the wait of lock_call are reported.
+ *
+ * REEACT_EVENTS_OBSERVE_WAIT returns from the hook with the result of
+ * wait_call if events of the type are wanted, reporting the wait time when
+ * wait_call returns 0.
+ *
+ * REEACT_EVENTS_OBSERVE_BARRIER returns from the hook with the result of
+ * wait_call if barrier events are wanted; the thread that gets
+ * PTHREAD_BARRIER_SERIAL_THREAD, i.e., the last to arrive, reports the
+ * arrival skew. The first arrival of an episode is kept in the side table
+ * entry of the barrier, so that barriers of any policy can be observed. The
+ * skew of an episode may be underestimated if threads of the next episode 
+ * arrive before the last thread of the previous episode returns.
+ */
+#define REEACT_EVENTS_OBSERVE_LOCK(lock, trylock_call, lock_call)	\
+	do{								\
+		unsigned long long __start;				\
+		int __ret_val;						\
+		if(!reeact_events_enabled(REEACT_EVENTS_LOCK))		\
+			break;						\
+		__ret_val = (trylock_call);				\
+		if(__ret_val != EBUSY)					\
+			return __ret_val;				\
+		__start = reeact_events_now();				\
+		reeact_events_emit(REEACT_EVENT_LOCK_CONTENDED, (lock), 0);\
+		__ret_val = (lock_call);				\
+		if(__ret_val == 0)					\
+			reeact_events_emit(REEACT_EVENT_LOCK_ACQUIRED,	\
+					   (lock), reeact_events_now() -\
+					   __start);			\
+		return __ret_val;					\
+	} while(0)
+
+#define REEACT_EVENTS_OBSERVE_WAIT(type, object, wait_call)		\
+	do{								\
+		unsigned long long __start;				\
+		int __ret_val;						\
+		if(!reeact_events_enabled(REEACT_EVENT_MASK(type)))	\
+			break;						\
+		__start = reeact_events_now();				\
+		__ret_val = (wait_call);				\
+		if(__ret_val == 0)					\
+			reeact_events_emit((type), (object), 		\
+					   reeact_events_now() - __start);\
+		return __ret_val;					\
+	} while(0)
+
+#define REEACT_EVENTS_OBSERVE_BARRIER(barrier, wait_call)		\
+	do{								\
+		unsigned long long __arrival;				\
+		int __ret_val;						\
+		if(!reeact_events_enabled(				\
+			   REEACT_EVENT_MASK(REEACT_EVENT_BARRIER_DONE)))\
+			break;						\
+		__arrival = reeact_events_barrier_arrive(barrier);	\
+		__ret_val = (wait_call);				\
+		if(__ret_val == PTHREAD_BARRIER_SERIAL_THREAD)		\
+			reeact_events_barrier_done(barrier, __arrival);	\
+		return __ret_val;					\
+	} while(0)
+
+/*
+ * Record the arrival of the calling thread at a barrier.
+ * Return value:
+ *     the arrival time
+ */
+unsigned long long reeact_events_barrier_arrive(void *barrier);
+
+/*
+ * Report the end of a barrier episode, called by the last thread to arrive.
+ * Input parameters:
+ *     barrier: the barrier
+ *     arrival: the arrival time of the calling thread
+ */
+void reeact_events_barrier_done(void *barrier, unsigned long long arrival);
+
+#endif
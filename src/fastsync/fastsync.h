@@ -13,6 +13,9 @@
 /* Compile Barrier */
 #define gcc_barrier() asm volatile("": : :"memory")
 
+/* Full memory barrier */
+#define mem_barrier() __sync_synchronize()
+
 /* Atomic add, returning the new value after the addition */
 #define atomic_addf(P, V) __sync_add_and_fetch((P), (V))
 
@@ -58,10 +61,236 @@
 #define sys_futex(addr1, op, val1, timeout, addr2, val3) \
 	syscall(SYS_futex, addr1, op, val1, timeout, addr2, val3)
 
+/*
+ * The futex flags of an object: process-private objects use private futexes,
+ * which are faster; process-shared objects must use shared futexes, which the
+ * kernel keys by the physical page instead of the virtual address.
+ */
+#define fastsync_futex_flags(shared) ((shared) ? 0 : FUTEX_PRIVATE_FLAG)
+
+/*
+ * Topology of the machine for the primitives with per-node state. REEact
+ * registers the mapping from cpu ids to node ids at initialization. Without
+ * a mapping, every thread is considered to run on node 0.
+ * Input parameters:
+ *     cpu_nodes: array of node ids indexed by cpu id; kept by reference
+ *     cpu_cnt: the number of entries in cpu_nodes
+ *     node_cnt: the total number of nodes
+ * Return value:
+ *     0: success
+ *     1: invalid mapping
+ */
+int fastsync_set_cpu_node_map(int *cpu_nodes, int cpu_cnt, int node_cnt);
+
+/*
+ * Register a loader that detects the topology and registers the mapping with
+ * fastsync_set_cpu_node_map. The loader is called once, by the first call of
+ * fastsync_load_topology, so a process that never needs the topology does 
+ * not pay for detecting it. The loader reads files and allocates memory, so
+ * the primitives never run it themselves from their lock paths; until it 
+ * has run, every thread is on node 0 and there is one node.
+ * Input parameters:
+ *     loader: the loader, NULL to unregister
+ * Return value:
+ *     0: success
+ */
+int fastsync_set_topology_loader(void (*loader)(void));
+
+/*
+ * Run the registered topology loader if it has not run; threads calling this
+ * while another thread runs the loader wait for it to finish.
+ * Return value:
+ *     0: the topology is loaded, or there is no loader
+ *     1: called by the loader itself, the topology is not known yet
+ */
+int fastsync_load_topology();
+
+/*
+ * Check whether the topology is known, without running the loader.
+ * Return value:
+ *     1: the topology is loaded, or there is no loader
+ *     0: the loader has not run, or is running
+ */
+int fastsync_topology_known();
+
+/*
+ * Get the node of the calling thread. The node is determined at the first
+ * call of each thread after the topology is known, and cached afterwards;
+ * before that, the node is 0.
+ */
+int fastsync_get_node();
+
+/*
+ * Get the total number of nodes; 1 until the topology is known.
+ */
+int fastsync_get_node_cnt();
+
 /*
  * END: Atomic operations and other common definitions
  */
 
+/*
+ * BEGIN: fastsync wait backend declarations
+ */
+
+/*
+ * Operations of a user-level fiber scheduler. A carrier thread that runs
+ * fibers registers these operations; a fiber that blocks on a fastsync object
+ * is then suspended and queued on the object, instead of blocking the carrier
+ * thread in the kernel.
+ *     current: return the handle of the running fiber
+ *     suspend: suspend the running fiber until it is resumed, or until 
+ *              abstime (CLOCK_REALTIME, NULL for no timeout) passes; return
+ *              0 when resumed, ETIMEDOUT on timeout. A resume may arrive 
+ *              before the fiber is actually suspended, in which case suspend
+ *              should return immediately. 
+ *     resume: make a suspended fiber runnable. It may be called from any 
+ *             thread, with a fastsync internal lock held, so it must not
+ *             block or use fastsync objects.
+ *     data: scheduler data passed to the above operations
+ */
+typedef struct _fastsync_fiber_ops{
+	void *(*current)(void *data);
+	int (*suspend)(const struct timespec *abstime, void *data);
+	void (*resume)(void *fiber, void *data);
+	void *data;
+}fastsync_fiber_ops;
+
+/*
+ * Register the fiber scheduler of the calling carrier thread. 
+ * Input parameters:
+ *     ops: the scheduler operations, kept by reference; NULL to unregister
+ * Return value:
+ *     0: success
+ *     EINVAL: some operations are missing
+ */
+int fastsync_fiber_register(const fastsync_fiber_ops *ops);
+
+/*
+ * Wait on a futex word. A fiber of a registered scheduler is suspended; other
+ * threads block in the kernel. Fibers block their carrier thread on 
+ * process-shared objects, as fibers can only be queued within a process.
+ * Input parameters:
+ *     addr: the futex word
+ *     val: the expected value of the futex word
+ *     abstime: CLOCK_REALTIME timeout, NULL for no timeout
+ *     flags: FUTEX_PRIVATE_FLAG for process-private objects, or 0
+ * Return value:
+ *     same as the FUTEX_WAIT system call: 0 on wake-up, -1 with errno set
+ *     to EAGAIN, ETIMEDOUT, EINTR or EINVAL otherwise
+ */
+long fastsync_futex_wait(void *addr, int val, const struct timespec *abstime, 
+			 int flags);
+
+/*
+ * Wake up waiters, fibers and threads, on a futex word.
+ * Input parameters:
+ *     addr: the futex word
+ *     cnt: the maximum number of waiters to wake up
+ *     flags: FUTEX_PRIVATE_FLAG for process-private objects, or 0
+ * Return value:
+ *     the number of waiters woken up, or -1 with errno set
+ */
+long fastsync_futex_wake(void *addr, int cnt, int flags);
+
+/*
+ * Wake up waiters on a futex word, and move the remaining waiters to a 
+ * second futex word.
+ * Input parameters:
+ *     addr: the futex word
+ *     wake_cnt: the maximum number of waiters to wake up
+ *     requeue_cnt: the maximum number of waiters to move
+ *     addr2: the futex word to move the waiters to
+ *     flags: FUTEX_PRIVATE_FLAG for process-private objects, or 0
+ * Return value:
+ *     same as the FUTEX_REQUEUE system call
+ */
+long fastsync_futex_requeue(void *addr, int wake_cnt, int requeue_cnt, 
+			    void *addr2, int flags);
+
+/*
+ * Get the number of fibers parked on futex words, e.g., to skip a wake-up 
+ * when no thread can be waiting and no fiber is parked.
+ * Return value:
+ *     the number of fibers in (or entering) the parking table
+ */
+int fastsync_fiber_parked_cnt();
+
+/*
+ * Convert an absolute CLOCK_MONOTONIC time to CLOCK_REALTIME, the clock of the
+ * timeouts of the wait backend.
+ * Input parameters:
+ *     mono: the CLOCK_MONOTONIC time
+ * Output parameters:
+ *     real: the CLOCK_REALTIME time
+ */
+void fastsync_monotonic_to_realtime(const struct timespec *mono, 
+				    struct timespec *real);
+
+/*
+ * END: fastsync wait backend declarations
+ */
+
+/*
+ * BEGIN: fastsync eventfd binding declarations
+ */
+
+/*
+ * An eventfd binding of a fastsync object, so that an event loop can wait for
+ * the object with epoll together with other file descriptors. A zeroed 
+ * binding is valid and unbound.
+ *
+ * An event loop registers itself with fastsync_evfd_arm, re-checks the object
+ * (e.g., with fastsync_sem_trywait), and then waits for the eventfd to become
+ * readable. After it is woken up, fastsync_evfd_disarm drains the eventfd. 
+ * The object writes to the eventfd only when some event loop is armed.
+ */
+typedef struct _fastsync_evfd{
+	int fd; // the eventfd plus 1; 0 if no eventfd is bound
+	int waiters; // number of armed event loops
+}fastsync_evfd;
+
+/*
+ * Bind an eventfd to a fastsync object. The eventfd is non-blocking and 
+ * created on the first call; later calls return the same eventfd.
+ * Input parameters:
+ *     ev: the eventfd binding of the object, e.g., &(sem->evfd)
+ * Return value:
+ *     the eventfd; -1 with errno set on error
+ */
+int fastsync_evfd_open(fastsync_evfd *ev);
+
+/*
+ * Register (arm) or unregister (disarm) an event loop waiter. Disarming also
+ * drains the eventfd.
+ * Input parameters:
+ *     ev: the eventfd binding of the object
+ * Return value:
+ *     0: success
+ *     EBADF: no eventfd is bound
+ */
+int fastsync_evfd_arm(fastsync_evfd *ev);
+int fastsync_evfd_disarm(fastsync_evfd *ev);
+
+/*
+ * Close the eventfd bound to a fastsync object; used by the destroy functions.
+ */
+void fastsync_evfd_close(fastsync_evfd *ev);
+
+/*
+ * Make the eventfd readable. Objects should use fastsync_evfd_notify, which 
+ * only does so when an event loop is armed. The caller should have changed 
+ * the state of the object with an atomic operation before the notification.
+ */
+void fastsync_evfd_signal(fastsync_evfd *ev);
+
+#define fastsync_evfd_notify(ev)					\
+	do { if(atomic_read((ev)->waiters)) fastsync_evfd_signal(ev); } while (0)
+
+/*
+ * END: fastsync eventfd binding declarations
+ */
+
 /*
  * BEGIN: fastsync barrier declarations
  */
@@ -76,13 +305,20 @@ typedef struct _fastsync_barrier{
 		unsigned long long reset;
 	};
 	unsigned int total_count; // total number of threads using this barrier
+	int shared; // 1 if shared by processes
 	struct _fastsync_barrier *parent_bar; // pointer to the parent barrier,
                                               // used for tree-barrier
-	int padding[11]; // make a barrier occupy a cache line to avoid false sharing
+	/*
+	 * No padding to a cache line here, so that a barrier fits in a 
+	 * pthread_barrier_t. Barriers of a tree should be allocated on 
+	 * separate cache lines to avoid false sharing.
+	 */
 }fastsync_barrier;
 
 typedef struct _fastsync_barrier_attr{
 	int count;
+	int shared; // 1 if shared by processes; a process-shared barrier 
+	            // cannot have a parent barrier
 }fastsync_barrier_attr;
 
 /*
@@ -112,6 +348,17 @@ int fastsync_barrier_init(fastsync_barrier  *barrier,
  *     1: unreachable code executed; major error
  */
 int fastsync_barrier_wait(fastsync_barrier *barrier);
+
+/*
+ * Wait at a fast sync barrier, spinning before blocking.
+ * Input parameters:
+ *     barrier: the barrier to wait at
+ *     spin: the number of spins before blocking; negative to spin without
+ *           ever blocking
+ * Return value:
+ *     same as fastsync_barrier_wait
+ */
+int fastsync_barrier_wait_spin(fastsync_barrier *barrier, int spin);
 /*
  * Inter-processor version of the barrier_wait (with spinning instead of block)
  */
@@ -147,11 +394,13 @@ typedef union _fastsync_mutex{
 		 * means contended or not
 		 */
 		int state;
+		int shared; // 1 if shared by processes
 	};
 }fastsync_mutex;
 
 typedef struct _fastsync_mutex_attr{
 	fastsync_mutex *parent; /* parent mutex */
+	int shared; /* 1 if shared by processes */
 }fastsync_mutex_attr;
 
 
@@ -178,6 +427,32 @@ int fastsync_mutex_init(fastsync_mutex *mutex, const fastsync_mutex_attr *attr);
 int fastsync_mutex_lock(fastsync_mutex *mutex);
 int fastsync_mutex_trylock(fastsync_mutex *mutex);
 
+/*
+ * Lock a fastsync mutex, spinning on the mutex before blocking.
+ * Input parameters:
+ *     mutex: the mutex to lock
+ *     spin: the number of spins before blocking; negative to spin without
+ *           ever blocking
+ * Return value:
+ *     0: success
+ *     1: mutex is NULL
+ */
+int fastsync_mutex_lock_spin(fastsync_mutex *mutex, int spin);
+
+/*
+ * Lock a fastsync mutex; give up at an absolute CLOCK_REALTIME time.
+ * Input parameters:
+ *     mutex: the mutex to lock
+ *     abstime: the timeout
+ * Return value:
+ *     0: success
+ *     1: mutex is NULL
+ *     ETIMEDOUT: unable to lock before abstime
+ *     EINVAL: abstime is invalid
+ */
+int fastsync_mutex_timedlock(fastsync_mutex *mutex, 
+			     const struct timespec *abstime);
+
 /*
  * Unlock a fastsync mutex.
  * Input parameters:
@@ -197,19 +472,31 @@ int fastsync_mutex_unlock(fastsync_mutex *mutex);
  * BEGIN: fastsync conditional variable declarations
  */
 
+/*
+ * A zero-filled conditional variable (e.g., from PTHREAD_COND_INITIALIZER) is
+ * valid. There is no padding to a cache line, so that a conditional variable
+ * fits in a pthread_cond_t.
+ */
 typedef union _fastsync_cond{
-	char padding[64];
 	struct {
 		int use_child;
 		fastsync_mutex *mutex;
 		unsigned long long seq;
 		union _fastsync_cond *parent;
+		fastsync_evfd evfd; // eventfd binding for event loops
+		int shared; // 1 if shared by processes
+		int monotonic; // 1 if timeouts are in CLOCK_MONOTONIC
 	};
 }fastsync_cond;
 
 typedef struct _fastsync_cond_attr{
 	// TODO: add properties here
 	int dummy;
+	int shared; // 1 if shared by processes. A process-shared conditional
+	            // variable does not remember its mutex, whose address 
+	            // differs among processes, so broadcast wakes up all
+	            // waiters instead of moving them to the mutex.
+	int monotonic; // 1 if timeouts are in CLOCK_MONOTONIC
 }fastsync_cond_attr;
 
 /*
@@ -234,6 +521,23 @@ int fastsync_cond_init(fastsync_cond *cond, const fastsync_cond_attr *atrr);
  */
 int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex);
 
+/*
+ * Wait on a conditional variable until an absolute time, which is in 
+ * CLOCK_MONOTONIC if the conditional variable is so initialized, or in 
+ * CLOCK_REALTIME otherwise. The mutex is re-acquired on timeout.
+ *     cond: the conditional variable to wait on
+ *     mutex: the mutex to release while waiting
+ *     abstime: the timeout
+ * Return value:
+ *     0: success
+ *     1: cond is NULL and/or mutex is NULL
+ *     2: mutex does not match previously used mutex
+ *     ETIMEDOUT: abstime has passed
+ *     EINVAL: abstime is invalid
+ */
+int fastsync_cond_timedwait(fastsync_cond *cond, fastsync_mutex *mutex,
+			    const struct timespec *abstime);
+
 /*
  * Let at least one (signal) or all (broadcast) waiter(s) of the conditional 
  * variable to proceed.
@@ -258,11 +562,504 @@ int fastsync_cond_broadcast(fastsync_cond *cond);
  *     0: success
  *     1: cond is NULL
  */
-int fastsync_cond_destory(fastsync_cond *cond);
+int fastsync_cond_destroy(fastsync_cond *cond);
 
 /*
  * END: fastsync conditional variable declarations
  */
 
+/*
+ * BEGIN: fastsync reader-writer lock declarations
+ */
+
+/*
+ * Reader indicator; readers only modify the indicator of their own node, so
+ * read-locking does not bounce a shared cache line across sockets.
+ */
+typedef struct _fastsync_rwlock_indicator{
+	int readers; // number of readers holding the lock on this node
+	int padding[15]; // one indicator per cache line
+}fastsync_rwlock_indicator;
+
+typedef struct _fastsync_rwlock{
+	/*
+	 * state of the writer:
+	 * 0: no writer
+	 * 1: a writer owns the lock and is waiting for the readers to drain
+	 * 2: write-locked, once the writer has checked the readers again
+	 */
+	int writer;
+	int writers_waiting; // writers waiting for the lock; new readers wait
+	                     // until they are done (writer preference)
+	int seq; // bumped at write unlock; threads blocked by a writer wait on it
+	int sleepers; // number of threads blocked on seq
+	int indicator_cnt; // number of reader indicators
+	fastsync_rwlock_indicator *indicators; // reader indicators, allocated
+	                                       // on init or on first use
+	int shared; // 1 if shared by processes
+	int readers; // the only reader indicator of a process-shared lock, as
+	             // allocated indicators are private to a process
+	int owner; // thread id of the writer, set once it has the lock in
+	           // state 2; 0 otherwise
+}fastsync_rwlock;
+
+typedef struct _fastsync_rwlock_attr{
+	int indicator_cnt; // number of reader indicators, 0 for one per node
+	int shared; // 1 if shared by processes
+}fastsync_rwlock_attr;
+
+/*
+ * Initialize a fastsync reader-writer lock. A zero-filled lock (e.g., from
+ * PTHREAD_RWLOCK_INITIALIZER) is also valid; its indicators are allocated
+ * at the first use.
+ * Input parameters:
+ *     rwlock: the lock to initialize
+ *     attr: lock attributes, NULL for default
+ * Return value:
+ *     0: success
+ *     1: rwlock is NULL
+ *     ENOMEM: unable to allocate the reader indicators
+ */
+int fastsync_rwlock_init(fastsync_rwlock *rwlock,
+			 const fastsync_rwlock_attr *attr);
+
+/*
+ * Read-lock or write-lock a fastsync reader-writer lock. Normal versions
+ * block until the lock is acquired; try versions return immediately; timed
+ * versions wait until abstime (CLOCK_REALTIME).
+ * Input parameters:
+ *     rwlock: the lock
+ *     abstime: absolute timeout
+ * Return value:
+ *     0: success
+ *     1: rwlock is NULL
+ *     EBUSY: unable to lock in try versions
+ *     ETIMEDOUT: timeout in timed versions
+ *     EINVAL: invalid abstime in timed versions
+ *     EAGAIN: unable to allocate the reader indicators
+ *     EDEADLK: the calling thread holds the write lock, or, for write-lock,
+ *              the read lock; not returned by the try versions
+ */
+int fastsync_rwlock_rdlock(fastsync_rwlock *rwlock);
+int fastsync_rwlock_tryrdlock(fastsync_rwlock *rwlock);
+int fastsync_rwlock_timedrdlock(fastsync_rwlock *rwlock,
+				const struct timespec *abstime);
+int fastsync_rwlock_wrlock(fastsync_rwlock *rwlock);
+int fastsync_rwlock_trywrlock(fastsync_rwlock *rwlock);
+int fastsync_rwlock_timedwrlock(fastsync_rwlock *rwlock,
+				const struct timespec *abstime);
+
+/*
+ * Unlock a fastsync reader-writer lock, either held by a reader or a writer.
+ * Input parameters:
+ *     rwlock: the lock
+ * Return value:
+ *     0: success
+ *     1: rwlock is NULL
+ */
+int fastsync_rwlock_unlock(fastsync_rwlock *rwlock);
+
+/*
+ * Read-lock, write-lock or unlock a process-private fastsync reader-writer
+ * lock with plain loads and stores, when no other thread can use it, e.g., 
+ * in a single-threaded process. Only the uncontended cases are handled: a 
+ * read-lock without writers, a write-lock without readers and writers, and
+ * an unlock that wakes up no one. Otherwise the lock is left unchanged, and
+ * the normal functions above must be used.
+ * Input parameters:
+ *     rwlock: the lock
+ * Return value:
+ *     0: success
+ *     1: rwlock is NULL
+ *     EBUSY: not an uncontended case; use the normal function
+ */
+int fastsync_rwlock_rdlock_single(fastsync_rwlock *rwlock);
+int fastsync_rwlock_wrlock_single(fastsync_rwlock *rwlock);
+int fastsync_rwlock_unlock_single(fastsync_rwlock *rwlock);
+
+/*
+ * Destroy a fastsync reader-writer lock and free its reader indicators.
+ * Input parameters:
+ *     rwlock: the lock
+ * Return value:
+ *     0: success
+ *     1: rwlock is NULL
+ */
+int fastsync_rwlock_destroy(fastsync_rwlock *rwlock);
+
+/*
+ * END: fastsync reader-writer lock declarations
+ */
+
+/*
+ * BEGIN: fastsync spinlock declarations
+ */
+typedef union _fastsync_spinlock{
+	struct {
+		/*
+		 * state of the spinlock:
+		 * 0: unlocked
+		 * other: locked, the value is the node of the holder plus one
+		 */
+		int lock;
+	};
+}fastsync_spinlock;
+
+/*
+ * Initialize a fastsync spinlock. The spinlock never blocks in the kernel,
+ * so it works across processes without any special treatment.
+ * Input parameters:
+ *     lock: the spinlock to initialize
+ *     pshared: whether the lock is shared among processes (ignored)
+ * Return value:
+ *     0: success
+ *     1: lock is NULL
+ */
+int fastsync_spin_init(fastsync_spinlock *lock, int pshared);
+
+/*
+ * Lock a fastsync spinlock; spin with exponential backoff until the lock is
+ * acquired in the normal version; return immediately in the trylock version.
+ * Input parameters:
+ *     lock: the spinlock to lock
+ * Return value:
+ *     0: success
+ *     1: lock is NULL
+ *     EBUSY: unable to lock in trylock
+ */
+int fastsync_spin_lock(fastsync_spinlock *lock);
+int fastsync_spin_trylock(fastsync_spinlock *lock);
+
+/*
+ * Unlock a fastsync spinlock.
+ * Input parameters:
+ *     lock: the spinlock to unlock
+ * Return value:
+ *     0: success
+ *     1: lock is NULL
+ */
+int fastsync_spin_unlock(fastsync_spinlock *lock);
+
+/*
+ * Destroy a fastsync spinlock.
+ * Input parameters:
+ *     lock: the spinlock to destroy
+ * Return value:
+ *     0: success
+ *     1: lock is NULL
+ */
+int fastsync_spin_destroy(fastsync_spinlock *lock);
+
+/*
+ * END: fastsync spinlock declarations
+ */
+
+/*
+ * BEGIN: fastsync semaphore declarations
+ */
+
+/*
+ * The layout follows glibc's semaphore on 64-bit machines (value in the low 
+ * word, number of waiters in the high word, followed by the futex private 
+ * flag), so that a semaphore created by sem_open is also a valid fastsync
+ * semaphore.
+ */
+typedef struct _fastsync_sem{
+	unsigned int value; // current value of the semaphore
+	unsigned int waiters; // number of threads blocked on the semaphore
+	int private; // FUTEX_PRIVATE_FLAG if process-private, 0 if shared
+	int spins; // adaptive spin count before blocking
+	fastsync_evfd evfd; // eventfd binding for event loops
+}fastsync_sem;
+
+/*
+ * Initialize a fastsync semaphore.
+ * Input parameters:
+ *     sem: the semaphore to initialize
+ *     pshared: whether the semaphore is shared among processes
+ *     value: initial value of the semaphore
+ * Return value:
+ *     0: success
+ *     1: sem is NULL
+ *     EINVAL: value is too large
+ */
+int fastsync_sem_init(fastsync_sem *sem, int pshared, unsigned int value);
+
+/*
+ * Decrement a fastsync semaphore; block while the value is zero in the normal
+ * version; return immediately in the try version; wait until abstime
+ * (CLOCK_REALTIME) in the timed version.
+ * Input parameters:
+ *     sem: the semaphore to decrement
+ *     abstime: absolute timeout
+ * Return value:
+ *     0: success
+ *     1: sem is NULL
+ *     EAGAIN: the value is zero in the try version
+ *     ETIMEDOUT: timeout in the timed version
+ *     EINTR: interrupted by a signal handler
+ */
+int fastsync_sem_wait(fastsync_sem *sem);
+int fastsync_sem_trywait(fastsync_sem *sem);
+int fastsync_sem_timedwait(fastsync_sem *sem, const struct timespec *abstime);
+
+/*
+ * Increment a fastsync semaphore, waking up one waiter if there is any. No
+ * system call is made if no thread is blocked.
+ * Input parameters:
+ *     sem: the semaphore to increment
+ * Return value:
+ *     0: success
+ *     1: sem is NULL
+ *     EOVERFLOW: the value would exceed SEM_VALUE_MAX
+ */
+int fastsync_sem_post(fastsync_sem *sem);
+
+/*
+ * Get the value of a fastsync semaphore.
+ * Input parameters:
+ *     sem: the semaphore
+ * Output parameters:
+ *     value: the current value
+ * Return value:
+ *     0: success
+ *     1: sem or value is NULL
+ */
+int fastsync_sem_getvalue(fastsync_sem *sem, int *value);
+
+/*
+ * Destroy a fastsync semaphore.
+ * Input parameters:
+ *     sem: the semaphore to destroy
+ * Return value:
+ *     0: success
+ *     1: sem is NULL
+ */
+int fastsync_sem_destroy(fastsync_sem *sem);
+
+/*
+ * END: fastsync semaphore declarations
+ */
+
+/*
+ * BEGIN: fastsync latch declarations
+ */
+
+typedef struct _fastsync_latch{
+	int count; // remaining count; the latch is open when it reaches 0
+	int waiters; // number of threads blocked on the latch
+	fastsync_evfd evfd; // eventfd binding for event loops
+}fastsync_latch;
+
+/*
+ * Initialize a fastsync latch, a one-shot count-down synchronization point.
+ * Input parameters:
+ *     latch: the latch to initialize
+ *     count: the number of count-downs to open the latch
+ * Return value:
+ *     0: success
+ *     1: latch is NULL
+ *     EINVAL: count is negative
+ */
+int fastsync_latch_init(fastsync_latch *latch, int count);
+
+/*
+ * Count down a fastsync latch by n; waiters are released when the count
+ * reaches 0. The arrive_and_wait version also waits for the latch to open.
+ * Input parameters:
+ *     latch: the latch to count down
+ *     n: the amount to count down
+ * Return value:
+ *     0: success
+ *     1: latch is NULL
+ *     EINVAL: n is negative, or the count would drop below 0
+ */
+int fastsync_latch_count_down(fastsync_latch *latch, int n);
+int fastsync_latch_arrive_and_wait(fastsync_latch *latch, int n);
+
+/*
+ * Wait for a fastsync latch to open; block in the normal version; return
+ * immediately in the try version.
+ * Input parameters:
+ *     latch: the latch to wait for
+ * Return value:
+ *     0: success, the latch is open
+ *     1: latch is NULL
+ *     EBUSY: the latch is not open in the try version
+ */
+int fastsync_latch_wait(fastsync_latch *latch);
+int fastsync_latch_try_wait(fastsync_latch *latch);
+
+/*
+ * Destroy a fastsync latch.
+ * Input parameters:
+ *     latch: the latch to destroy
+ * Return value:
+ *     0: success
+ *     1: latch is NULL
+ */
+int fastsync_latch_destroy(fastsync_latch *latch);
+
+/*
+ * END: fastsync latch declarations
+ */
+
+/*
+ * BEGIN: fastsync eventcount declarations
+ */
+
+typedef struct _fastsync_eventcount{
+	int seq; // bumped by notifications that find waiters
+	int waiters; // number of threads between prepare_wait and 
+	             // commit_wait/cancel_wait
+}fastsync_eventcount;
+
+/*
+ * Initialize a fastsync eventcount. An eventcount lets a thread block on a 
+ * condition of some lock-free data structure (e.g., a queue is not empty)
+ * without a mutex. A waiter calls prepare_wait, re-checks the condition, and
+ * then calls commit_wait to block, or cancel_wait if the condition is met. A
+ * thread that changes the condition calls notify afterwards.
+ * Input parameters:
+ *     ec: the eventcount to initialize
+ * Return value:
+ *     0: success
+ *     1: ec is NULL
+ */
+int fastsync_eventcount_init(fastsync_eventcount *ec);
+
+/*
+ * Announce a waiter of a fastsync eventcount.
+ * Input parameters:
+ *     ec: the eventcount
+ *     key: output parameter, the key to pass to commit_wait
+ * Return value:
+ *     0: success
+ *     1: ec or key is NULL
+ */
+int fastsync_eventcount_prepare_wait(fastsync_eventcount *ec, int *key);
+
+/*
+ * Block on a fastsync eventcount until a notification since prepare_wait, 
+ * or withdraw the waiter without blocking (cancel_wait). Spurious wake-ups
+ * are possible; the caller should re-check its condition.
+ * Input parameters:
+ *     ec: the eventcount
+ *     key: the key returned by prepare_wait
+ * Return value:
+ *     0: success
+ *     1: ec is NULL
+ */
+int fastsync_eventcount_commit_wait(fastsync_eventcount *ec, int key);
+int fastsync_eventcount_cancel_wait(fastsync_eventcount *ec);
+
+/*
+ * Wake up one (notify) or all (notify_all) waiters of a fastsync eventcount.
+ * If no thread is waiting, a notification is only a memory barrier and a 
+ * read of the eventcount.
+ * Input parameters:
+ *     ec: the eventcount
+ * Return value:
+ *     0: success
+ *     1: ec is NULL
+ */
+int fastsync_eventcount_notify(fastsync_eventcount *ec);
+int fastsync_eventcount_notify_all(fastsync_eventcount *ec);
+
+/*
+ * Destroy a fastsync eventcount.
+ * Input parameters:
+ *     ec: the eventcount to destroy
+ * Return value:
+ *     0: success
+ *     1: ec is NULL
+ */
+int fastsync_eventcount_destroy(fastsync_eventcount *ec);
+
+/*
+ * END: fastsync eventcount declarations
+ */
+
+/*
+ * BEGIN: fastsync queue declarations
+ */
+
+typedef struct _fastsync_queue_cell{
+	unsigned long seq; // the position this cell is ready for
+	void *data; // the item stored in this cell
+}fastsync_queue_cell;
+
+typedef struct _fastsync_queue{
+	unsigned long enq_pos; // next position to enqueue
+	char padding1[64 - sizeof(unsigned long)]; // keep producers and
+	                                           // consumers off each 
+	                                           // other's cache line
+	unsigned long deq_pos; // next position to dequeue
+	char padding2[64 - sizeof(unsigned long)];
+	fastsync_queue_cell *cells; // the ring of cells
+	unsigned long mask; // the number of cells minus 1
+	char padding3[64 - sizeof(fastsync_queue_cell*) - 
+		      sizeof(unsigned long)]; // keep the waiters' writes off
+	                                      // the read-mostly fields
+	fastsync_eventcount not_empty; // consumers block here on empty
+	fastsync_eventcount not_full; // producers block here on full
+}__attribute__((aligned(64))) fastsync_queue;
+
+/*
+ * Initialize a fastsync queue, a bounded lock-free multi-producer 
+ * multi-consumer FIFO of pointers.
+ * Input parameters:
+ *     q: the queue to initialize
+ *     size: the capacity of the queue, rounded up to a power of 2
+ * Return value:
+ *     0: success
+ *     1: q is NULL
+ *     EINVAL: size is smaller than 2
+ *     ENOMEM: unable to allocate the cells
+ */
+int fastsync_queue_init(fastsync_queue *q, unsigned long size);
+
+/*
+ * Enqueue an item into a fastsync queue; block when the queue is full in the
+ * normal version; return immediately in the try version.
+ * Input parameters:
+ *     q: the queue
+ *     data: the item to enqueue
+ * Return value:
+ *     0: success
+ *     1: q is NULL
+ *     EAGAIN: the queue is full in the try version
+ */
+int fastsync_queue_enqueue(fastsync_queue *q, void *data);
+int fastsync_queue_try_enqueue(fastsync_queue *q, void *data);
+
+/*
+ * Dequeue an item from a fastsync queue; block when the queue is empty in 
+ * the normal version; return immediately in the try version.
+ * Input parameters:
+ *     q: the queue
+ *     data: output parameter for the dequeued item
+ * Return value:
+ *     0: success
+ *     1: q or data is NULL
+ *     EAGAIN: the queue is empty in the try version
+ */
+int fastsync_queue_dequeue(fastsync_queue *q, void **data);
+int fastsync_queue_try_dequeue(fastsync_queue *q, void **data);
+
+/*
+ * Destroy a fastsync queue. The queue should be empty and unused.
+ * Input parameters:
+ *     q: the queue to destroy
+ * Return value:
+ *     0: success
+ *     1: q is NULL
+ */
+int fastsync_queue_destroy(fastsync_queue *q);
+
+/*
+ * END: fastsync queue declarations
+ */
+
 
 #endif
@@ -32,6 +32,7 @@ int fastsync_barrier_init(fastsync_barrier *barrier,
 
 	barrier->total_count = count;
 	barrier->reset = 0;
+	barrier->shared = attr ? attr->shared : 0;
 	/* barrier->total_yield = 0; */
 	barrier->parent_bar = NULL;
 
@@ -48,12 +49,21 @@ int fastsync_barrier_init(fastsync_barrier *barrier,
  * barrier call futex to block themselves.
  */
 int fastsync_barrier_wait(fastsync_barrier *barrier)
+{
+	return fastsync_barrier_wait_spin(barrier, 0);
+}
+
+/*
+ * Wait at a barrier, spinning for a while before blocking.
+ */
+int fastsync_barrier_wait_spin(fastsync_barrier *barrier, int spin)
 {
 	/*
 	 * A typical implementation of "pool barrier"
 	 */
 
 	int ret_val = 1;
+	int i;
 
 
 	int cur_seq = atomic_read(barrier->seq);
@@ -76,8 +86,8 @@ int fastsync_barrier_wait(fastsync_barrier *barrier)
 #ifdef _FUTEX_BARRIER_
 		// wake up other threads waiting at this barrier
 		if(barrier->total_count > 1)
-			sys_futex(&barrier->seq, FUTEX_WAKE_PRIVATE,
-				  INT_MAX, NULL, NULL, 0);
+			fastsync_futex_wake(&barrier->seq, INT_MAX,
+				fastsync_futex_flags(barrier->shared));
 #endif
 		ret_val = PTHREAD_BARRIER_SERIAL_THREAD;
 		//break;
@@ -85,14 +95,20 @@ int fastsync_barrier_wait(fastsync_barrier *barrier)
 	}
 
 	if(count < barrier->total_count){
+		// spin before blocking, or forever if spin is negative
+		for(i = 0; spin < 0 || i < spin; i++){
+			if(cur_seq != atomic_read(barrier->seq))
+				return 0;
+			spinlock_hint();
+		}
 		while (cur_seq == atomic_read(barrier->seq)) {
 			/* barrier->total_yield++; */
 #ifndef _FUTEX_BARRIER_
 			sched_yield(); // give up processor
 #else
 			// block thread itself
-			sys_futex(&barrier->seq, FUTEX_WAIT_PRIVATE,
-				  cur_seq, NULL, NULL, 0);
+			fastsync_futex_wait(&barrier->seq, cur_seq, NULL,
+				fastsync_futex_flags(barrier->shared));
 #endif
 		}
 		// normal wait success
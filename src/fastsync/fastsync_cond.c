@@ -26,6 +26,7 @@
 #include <sched.h>
 #include <limits.h>
 #include <linux/futex.h>
+#include <errno.h>
 
 #define _GNU_SOURCE
 #include <unistd.h>
@@ -35,6 +36,23 @@
 #include "fastsync.h"
 #include "../utils/reeact_utils.h"
 
+/*
+ * Release one waiter and move the rest to the wait queue of the mutex. The
+ * requeue only works when both futexes are private, so the waiters of 
+ * process-shared objects (or of a conditional variable whose mutex is 
+ * unknown) are all woken up instead.
+ */
+static inline void fastsync_cond_requeue(fastsync_cond *cond, 
+					 fastsync_mutex *mutex)
+{
+	if(mutex == NULL || cond->shared || mutex->shared)
+		fastsync_futex_wake(&(cond->seq), INT_MAX, 
+				    fastsync_futex_flags(cond->shared));
+	else
+		fastsync_futex_requeue(&(cond->seq), 1, INT_MAX, 
+				       &(mutex->state), FUTEX_PRIVATE_FLAG);
+}
+
 /*
  * Initialize a fastsync conditional variable object
  */
@@ -45,6 +63,12 @@ int fastsync_cond_init(fastsync_cond *cond, const fastsync_cond_attr *atrr)
 
 	cond->seq = 0;
 	cond->mutex = NULL;
+	cond->shared = atrr ? atrr->shared : 0;
+	cond->monotonic = atrr ? atrr->monotonic : 0;
+	cond->use_child = 0;
+	cond->parent = NULL;
+	cond->evfd.fd = 0;
+	cond->evfd.waiters = 0;
 	
 	return 0;
 }
@@ -60,22 +84,41 @@ int fastsync_cond_destroy(fastsync_cond *cond)
 
 	cond->seq = 0;
 	cond->mutex = NULL;
+	fastsync_evfd_close(&(cond->evfd));
 	
 	return 0;
 }
 
 /*
- * wait on a conditional variable
+ * Generic wait on a conditional variable; abstime is NULL for waiting 
+ * forever.
  */
-int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex)
+static int fastsync_cond_wait_common(fastsync_cond *cond, 
+				     fastsync_mutex *mutex,
+				     const struct timespec *abstime)
 {
 	int cur_seq;
 	fastsync_mutex *old;
+	struct timespec realtime;
+	int ret_val = 0;
 	
 	if(cond == NULL || mutex == NULL)
 		return 1;
 
-	if(cond->mutex != mutex){
+	if(abstime != NULL){
+		if(abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000)
+			return EINVAL;
+		if(cond->monotonic){
+			fastsync_monotonic_to_realtime(abstime, &realtime);
+			abstime = &realtime;
+		}
+	}
+
+	/* 
+	 * the address of a process-shared mutex differs among processes, so it 
+	 * is not remembered
+	 */
+	if(!cond->shared && !mutex->shared && cond->mutex != mutex){
 		if(cond->mutex != NULL){
 			/* mutex is different the previously used mutex */
 			LOGERR("cond->mutex is %p, input mutex is %p\n", 
@@ -93,14 +136,15 @@ int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex)
 		}
 	}
 
-	if(!cond->use_child && cond->parent){
+	if(!cond->use_child && cond->parent && !cond->shared){
 		/* use parent conditional variable */
 		/* 
 		 * there is no need to do atomic checks and updates as a mutex
 		 * should be acquired at this point.
 		 */
 		cond->use_child = 1;
-		fastsync_cond_wait(cond->parent, mutex);
+		ret_val = fastsync_cond_wait_common(cond->parent, mutex, 
+						    abstime);
 		/* release conditional variable on this node */
 		/* 
 		 * again, no need for atomic operations as the mutex is acquired
@@ -111,10 +155,9 @@ int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex)
 		 * may delay thread re-queue to even after the mutex is 
 		 * released.
 		 */
-		sys_futex(&(cond->seq), FUTEX_REQUEUE_PRIVATE, 1,
-			  (void*)INT_MAX, mutex, 0);
+		fastsync_cond_requeue(cond, mutex);
 		cond->use_child = 0;
-		return 0;
+		return ret_val;
 	}
 
 	/* acquired current sequence number */
@@ -123,18 +166,35 @@ int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex)
 	/* release mutex */
 	fastsync_mutex_unlock(mutex);
 	/* wait on the conditional variable */
-	sys_futex(&(cond->seq), FUTEX_WAIT_PRIVATE, cur_seq, NULL, NULL, 0);
+	if(fastsync_futex_wait(&(cond->seq), cur_seq, abstime, 
+			       fastsync_futex_flags(cond->shared)) == -1 &&
+	   errno == ETIMEDOUT)
+		ret_val = ETIMEDOUT;
 
 	/*
 	 * suspend if the mutex is lock
 	 */
 	while((atomic_xchg(&(mutex->state), 3) & 1)){
-		sys_futex(&(mutex->state), FUTEX_WAIT_PRIVATE, 3, NULL, 
-			  NULL, 0);
+		fastsync_futex_wait(&(mutex->state), 3, NULL, 
+				    fastsync_futex_flags(mutex->shared));
 	}
 
 	/* mutex acquired */
-	return 0;
+	return ret_val;
+}
+
+/*
+ * wait on a conditional variable
+ */
+int fastsync_cond_wait(fastsync_cond *cond, fastsync_mutex *mutex)
+{
+	return fastsync_cond_wait_common(cond, mutex, NULL);
+}
+
+int fastsync_cond_timedwait(fastsync_cond *cond, fastsync_mutex *mutex,
+			    const struct timespec *abstime)
+{
+	return fastsync_cond_wait_common(cond, mutex, abstime);
 }
 
 /* 
@@ -149,7 +209,9 @@ int fastsync_cond_signal(fastsync_cond *cond)
 	atomic_addf(&(cond->seq), 1);
 	
 	/* release on waiter */
-	sys_futex(&(cond->seq), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	fastsync_futex_wake(&(cond->seq), 1, 
+			    fastsync_futex_flags(cond->shared));
+	fastsync_evfd_notify(&(cond->evfd));
 
 	return 0;
 }
@@ -164,8 +226,9 @@ int fastsync_cond_signal_count(fastsync_cond *cond, int *count)
 	atomic_addf(&(cond->seq), 1);
 	
 	/* release one waiter */
-	*count = sys_futex(&(cond->seq), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 
-			   0);
+	*count = fastsync_futex_wake(&(cond->seq), 1, 
+				     fastsync_futex_flags(cond->shared));
+	fastsync_evfd_notify(&(cond->evfd));
 
 	return 0;
 }
@@ -184,9 +247,8 @@ int fastsync_cond_broadcast(fastsync_cond *cond)
 	/* 
 	 * release one waiter and put the rest on the mutex wait queue
 	 */
-	if(cond->mutex)
-		sys_futex(&(cond->seq), FUTEX_REQUEUE_PRIVATE, 1, 
-			  (void*)INT_MAX, cond->mutex, 0);
+	fastsync_cond_requeue(cond, cond->mutex);
+	fastsync_evfd_notify(&(cond->evfd));
 
 	return 0;
 }
@@ -0,0 +1,138 @@
+/*
+ * Implementation of the eventcount of the fast synchronization primitives. 
+ * An eventcount is the blocking part of a condition variable without the 
+ * mutex: lock-free data structures use it to put a consumer to sleep when,
+ * e.g., a queue is empty.
+ *
+ * The protocol is:
+ *     waiter:                          notifier:
+ *         prepare_wait(ec, &key)           change the condition
+ *         if(condition is met)             notify(ec)
+ *             cancel_wait(ec)
+ *         else
+ *             commit_wait(ec, key)
+ *
+ * prepare_wait announces the waiter with an atomic increment (a full 
+ * barrier) before the waiter re-checks its condition, and notify issues a
+ * full barrier after the condition is changed and before it checks for 
+ * waiters. So either the notifier sees the waiter, or the waiter sees the
+ * changed condition. When nobody waits, notify is only the barrier and a 
+ * load of the waiter count.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * initialize a fastsync eventcount
+ */
+int fastsync_eventcount_init(fastsync_eventcount *ec)
+{
+	if(ec == NULL)
+		return 1;
+
+	ec->seq = 0;
+	ec->waiters = 0;
+
+	return 0;
+}
+
+/*
+ * destroy a fastsync eventcount
+ */
+int fastsync_eventcount_destroy(fastsync_eventcount *ec)
+{
+	if(ec == NULL)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * announce a waiter
+ */
+int fastsync_eventcount_prepare_wait(fastsync_eventcount *ec, int *key)
+{
+	if(ec == NULL || key == NULL)
+		return 1;
+
+	atomic_addf(&(ec->waiters), 1);
+	*key = atomic_read(ec->seq);
+
+	return 0;
+}
+
+/*
+ * block until a notification since prepare_wait
+ */
+int fastsync_eventcount_commit_wait(fastsync_eventcount *ec, int key)
+{
+	if(ec == NULL)
+		return 1;
+
+	if(atomic_read(ec->seq) == key)
+		fastsync_futex_wait(&(ec->seq), key, NULL, FUTEX_PRIVATE_FLAG);
+	atomic_subf(&(ec->waiters), 1);
+
+	return 0;
+}
+
+/*
+ * withdraw a waiter
+ */
+int fastsync_eventcount_cancel_wait(fastsync_eventcount *ec)
+{
+	if(ec == NULL)
+		return 1;
+
+	atomic_subf(&(ec->waiters), 1);
+
+	return 0;
+}
+
+/*
+ * Generic notify, waking up at most count waiters
+ */
+static inline int fastsync_eventcount_notify_count(fastsync_eventcount *ec,
+						   int count)
+{
+	if(ec == NULL)
+		return 1;
+
+	/* order the change of the condition before the check for waiters */
+	mem_barrier();
+	if(atomic_read(ec->waiters) == 0)
+		return 0;
+
+	atomic_addf(&(ec->seq), 1);
+	fastsync_futex_wake(&(ec->seq), count, FUTEX_PRIVATE_FLAG);
+
+	return 0;
+}
+
+/*
+ * wake up waiters
+ */
+int fastsync_eventcount_notify(fastsync_eventcount *ec)
+{
+	return fastsync_eventcount_notify_count(ec, 1);
+}
+
+int fastsync_eventcount_notify_all(fastsync_eventcount *ec)
+{
+	return fastsync_eventcount_notify_count(ec, INT_MAX);
+}
@@ -0,0 +1,112 @@
+/*
+ * Implementation of the eventfd binding of the fast synchronization 
+ * primitives. See fastsync.h for the protocol between the event loops and 
+ * the objects.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * bind an eventfd to an object
+ */
+int fastsync_evfd_open(fastsync_evfd *ev)
+{
+	int fd, old;
+
+	if(ev == NULL){
+		errno = EINVAL;
+		return -1;
+	}
+
+	old = atomic_read(ev->fd);
+	if(old)
+		return old - 1;
+
+	fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(fd == -1)
+		return -1;
+
+	/* multiple threads may race to bind; only one eventfd is kept */
+	old = atomic_cmpxchg(&(ev->fd), 0, fd + 1);
+	if(old){
+		close(fd);
+		return old - 1;
+	}
+
+	return fd;
+}
+
+/*
+ * close the eventfd of an object
+ */
+void fastsync_evfd_close(fastsync_evfd *ev)
+{
+	int fd = atomic_xchg(&(ev->fd), 0);
+
+	if(fd)
+		close(fd - 1);
+	ev->waiters = 0;
+
+	return;
+}
+
+/*
+ * register an event loop
+ */
+int fastsync_evfd_arm(fastsync_evfd *ev)
+{
+	if(ev == NULL || atomic_read(ev->fd) == 0)
+		return EBADF;
+
+	/* a full barrier; the caller re-checks the object after this */
+	atomic_addf(&(ev->waiters), 1);
+
+	return 0;
+}
+
+/*
+ * unregister an event loop and drain the eventfd
+ */
+int fastsync_evfd_disarm(fastsync_evfd *ev)
+{
+	uint64_t cnt;
+	int fd;
+
+	if(ev == NULL || (fd = atomic_read(ev->fd)) == 0)
+		return EBADF;
+
+	atomic_subf(&(ev->waiters), 1);
+	while(read(fd - 1, &cnt, sizeof(cnt)) == -1 && errno == EINTR);
+
+	return 0;
+}
+
+/*
+ * make the eventfd readable
+ */
+void fastsync_evfd_signal(fastsync_evfd *ev)
+{
+	uint64_t one = 1;
+	int fd = atomic_read(ev->fd);
+
+	/* EAGAIN means the counter is saturated, which is readable anyway */
+	if(fd)
+		while(write(fd - 1, &one, sizeof(one)) == -1 && 
+		      errno == EINTR);
+
+	return;
+}
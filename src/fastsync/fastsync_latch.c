@@ -0,0 +1,146 @@
+/*
+ * Implementation of the latch of the fast synchronization primitives. A latch
+ * is a one-shot count-down: threads wait until the count reaches 0, and the
+ * latch then stays open. Unlike a barrier, the threads that count down do
+ * not have to wait.
+ *
+ * The count is the futex word. Counting down only makes a system call if it
+ * opens the latch and some thread is blocked on it.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * the number of spins before blocking on a latch
+ */
+#define FASTSYNC_LATCH_SPIN_LOOPS 100
+
+/*
+ * initialize a fastsync latch
+ */
+int fastsync_latch_init(fastsync_latch *latch, int count)
+{
+	if(latch == NULL)
+		return 1;
+
+	if(count < 0)
+		return EINVAL;
+
+	latch->count = count;
+	latch->waiters = 0;
+	latch->evfd.fd = 0;
+	latch->evfd.waiters = 0;
+
+	return 0;
+}
+
+/*
+ * destroy a fastsync latch
+ */
+int fastsync_latch_destroy(fastsync_latch *latch)
+{
+	if(latch == NULL)
+		return 1;
+
+	fastsync_evfd_close(&(latch->evfd));
+
+	return 0;
+}
+
+/*
+ * count down a fastsync latch
+ */
+int fastsync_latch_count_down(fastsync_latch *latch, int n)
+{
+	int count, old;
+
+	if(latch == NULL)
+		return 1;
+	if(n < 0)
+		return EINVAL;
+
+	count = atomic_read(latch->count);
+	do{
+		if(count < n)
+			return EINVAL;
+		old = count;
+		count = atomic_cmpxchg(&(latch->count), old, old - n);
+	}while(count != old);
+
+	/* the latch is opened, release the waiters if there are any */
+	if(old == n){
+		if(atomic_read(latch->waiters))
+			fastsync_futex_wake(&(latch->count), INT_MAX, 
+					    FUTEX_PRIVATE_FLAG);
+		fastsync_evfd_notify(&(latch->evfd));
+	}
+
+	return 0;
+}
+
+/*
+ * wait for a fastsync latch to open
+ */
+int fastsync_latch_wait(fastsync_latch *latch)
+{
+	int count;
+	int i;
+
+	if(latch == NULL)
+		return 1;
+
+	for(i = 0; i < FASTSYNC_LATCH_SPIN_LOOPS; i++){
+		if(atomic_read(latch->count) == 0)
+			return 0;
+		spinlock_hint();
+	}
+
+	/* announce the waiter before the last check, then block */
+	atomic_addf(&(latch->waiters), 1);
+	while((count = atomic_read(latch->count)) != 0)
+		fastsync_futex_wait(&(latch->count), count, NULL, 
+				    FUTEX_PRIVATE_FLAG);
+	atomic_subf(&(latch->waiters), 1);
+
+	return 0;
+}
+
+int fastsync_latch_try_wait(fastsync_latch *latch)
+{
+	if(latch == NULL)
+		return 1;
+
+	if(atomic_read(latch->count) == 0)
+		return 0;
+
+	return EBUSY;
+}
+
+/*
+ * count down a fastsync latch, then wait for it to open
+ */
+int fastsync_latch_arrive_and_wait(fastsync_latch *latch, int n)
+{
+	int ret_val;
+
+	ret_val = fastsync_latch_count_down(latch, n);
+	if(ret_val)
+		return ret_val;
+
+	return fastsync_latch_wait(latch);
+}
@@ -59,6 +59,7 @@ int fastsync_mutex_init(fastsync_mutex *m, const fastsync_mutex_attr *attr)
 		return 1;
 
 	m->state = 0;
+	m->shared = attr ? attr->shared : 0;
 
 	return 0;
 }
@@ -89,8 +90,56 @@ int fastsync_mutex_lock(fastsync_mutex *mutex)
 	 * set the lock stated to contended and suspend 
 	 */
 	while((atomic_xchg(&(mutex->state), 3) & 1)){
-		sys_futex(&(mutex->state), FUTEX_WAIT_PRIVATE, 3, NULL, 
-			  NULL, 0);
+		fastsync_futex_wait(&(mutex->state), 3, NULL, 
+				    fastsync_futex_flags(mutex->shared));
+	}
+
+	return 0;
+}
+
+/*
+ * Lock a fastsync mutex, spinning before blocking
+ */
+int fastsync_mutex_lock_spin(fastsync_mutex *mutex, int spin)
+{
+	int i;
+
+	if(mutex == NULL)
+		return 1;
+
+	/* only try the atomic operation when the mutex looks unlocked */
+	for(i = 0; spin < 0 || i < spin; i++){
+		if(!(atomic_read(mutex->state) & 1) &&
+		   !(atomic_for(&(mutex->state), 1) & 1))
+			return 0;
+		spinlock_hint();
+	}
+
+	return fastsync_mutex_lock(mutex);
+}
+
+/*
+ * Lock a fastsync mutex with a timeout
+ */
+int fastsync_mutex_timedlock(fastsync_mutex *mutex, 
+			     const struct timespec *abstime)
+{
+	if(mutex == NULL)
+		return 1;
+
+	/* the timeout is not checked if the mutex can be locked right away */
+	if(!(atomic_for(&(mutex->state), 1) & 1))
+		return 0;
+
+	if(abstime == NULL || abstime->tv_nsec < 0 || 
+	   abstime->tv_nsec >= 1000000000)
+		return EINVAL;
+
+	while((atomic_xchg(&(mutex->state), 3) & 1)){
+		if(fastsync_futex_wait(&(mutex->state), 3, abstime,
+				       fastsync_futex_flags(mutex->shared)) 
+		   == -1 && (errno == ETIMEDOUT || errno == EINVAL))
+			return errno;
 	}
 
 	return 0;
@@ -127,7 +176,8 @@ int fastsync_mutex_unlock(fastsync_mutex *mutex)
 	atomic_fand(&(mutex->state), 0xFFFFFFFD); // will be set by newly
                                                  // waken thread from futex
 	
-	sys_futex(&(mutex->state), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	fastsync_futex_wake(&(mutex->state), 1, 
+			    fastsync_futex_flags(mutex->shared));
 
 	return 0;
 }
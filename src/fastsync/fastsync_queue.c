@@ -0,0 +1,254 @@
+/*
+ * Implementation of the bounded queue of the fast synchronization primitives.
+ *
+ * The queue is the array-based multi-producer multi-consumer ring by Dmitry
+ * Vyukov. Every cell carries a sequence number telling which position it is
+ * ready for: a producer at position pos may fill a cell whose seq is pos, and
+ * then sets seq to pos + 1; a consumer at position pos may empty a cell whose
+ * seq is pos + 1, and then sets seq to pos + size, i.e., the position of the
+ * next round of producers. Producers and consumers only contend on the
+ * enqueue and dequeue positions, which are on separate cache lines, and a 
+ * single compare-and-exchange claims a cell.
+ *
+ * When the queue is empty (full), consumers (producers) block on the 
+ * not_empty (not_full) eventcount. An operation only notifies the other side
+ * with a system call if some thread is actually blocked.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * the number of retries before blocking on an empty or full queue
+ */
+#define FASTSYNC_QUEUE_SPIN_LOOPS 100
+
+/*
+ * initialize a fastsync queue
+ */
+int fastsync_queue_init(fastsync_queue *q, unsigned long size)
+{
+	unsigned long cnt = 2;
+	unsigned long i;
+
+	if(q == NULL)
+		return 1;
+
+	if(size < 2)
+		return EINVAL;
+
+	/* round the size up to a power of 2 */
+	while(cnt < size)
+		cnt <<= 1;
+
+	if(posix_memalign((void**)&(q->cells), 64, 
+			  cnt * sizeof(fastsync_queue_cell)))
+		return ENOMEM;
+
+	for(i = 0; i < cnt; i++){
+		q->cells[i].seq = i;
+		q->cells[i].data = NULL;
+	}
+	q->mask = cnt - 1;
+	q->enq_pos = 0;
+	q->deq_pos = 0;
+	fastsync_eventcount_init(&(q->not_empty));
+	fastsync_eventcount_init(&(q->not_full));
+
+	return 0;
+}
+
+/*
+ * destroy a fastsync queue
+ */
+int fastsync_queue_destroy(fastsync_queue *q)
+{
+	if(q == NULL)
+		return 1;
+
+	if(q->cells)
+		free(q->cells);
+	q->cells = NULL;
+	fastsync_eventcount_destroy(&(q->not_empty));
+	fastsync_eventcount_destroy(&(q->not_full));
+
+	return 0;
+}
+
+/*
+ * Enqueue without blocking and without notifying the consumers.
+ */
+static inline int fastsync_queue_put(fastsync_queue *q, void *data)
+{
+	fastsync_queue_cell *cell;
+	unsigned long pos = atomic_read(q->enq_pos);
+	unsigned long old;
+	long dif;
+
+	while(1){
+		cell = &(q->cells[pos & q->mask]);
+		dif = (long)atomic_read(cell->seq) - (long)pos;
+		if(dif == 0){
+			/* the cell is free for this position, claim it */
+			old = atomic_cmpxchg(&(q->enq_pos), pos, pos + 1);
+			if(old == pos)
+				break;
+			pos = old;
+		}
+		else if(dif < 0)
+			/* the cell is still in the previous round: full */
+			return EAGAIN;
+		else
+			/* another producer took this position */
+			pos = atomic_read(q->enq_pos);
+	}
+
+	cell->data = data;
+	/* publish the data before the sequence number */
+	gcc_barrier();
+	atomic_read(cell->seq) = pos + 1;
+
+	return 0;
+}
+
+/*
+ * Dequeue without blocking and without notifying the producers.
+ */
+static inline int fastsync_queue_get(fastsync_queue *q, void **data)
+{
+	fastsync_queue_cell *cell;
+	unsigned long pos = atomic_read(q->deq_pos);
+	unsigned long old;
+	long dif;
+
+	while(1){
+		cell = &(q->cells[pos & q->mask]);
+		dif = (long)atomic_read(cell->seq) - (long)(pos + 1);
+		if(dif == 0){
+			/* the cell is filled for this position, claim it */
+			old = atomic_cmpxchg(&(q->deq_pos), pos, pos + 1);
+			if(old == pos)
+				break;
+			pos = old;
+		}
+		else if(dif < 0)
+			/* the cell is not filled yet: empty */
+			return EAGAIN;
+		else
+			/* another consumer took this position */
+			pos = atomic_read(q->deq_pos);
+	}
+
+	*data = cell->data;
+	/* read the data before handing the cell to the next round */
+	gcc_barrier();
+	atomic_read(cell->seq) = pos + q->mask + 1;
+
+	return 0;
+}
+
+/*
+ * enqueue an item
+ */
+int fastsync_queue_try_enqueue(fastsync_queue *q, void *data)
+{
+	if(q == NULL)
+		return 1;
+
+	if(fastsync_queue_put(q, data))
+		return EAGAIN;
+
+	fastsync_eventcount_notify(&(q->not_empty));
+
+	return 0;
+}
+
+int fastsync_queue_enqueue(fastsync_queue *q, void *data)
+{
+	int key;
+	int i;
+
+	if(q == NULL)
+		return 1;
+
+	while(1){
+		for(i = 0; i < FASTSYNC_QUEUE_SPIN_LOOPS; i++){
+			if(fastsync_queue_put(q, data) == 0)
+				goto done;
+			spinlock_hint();
+		}
+
+		/* the queue is full, wait for a consumer */
+		fastsync_eventcount_prepare_wait(&(q->not_full), &key);
+		if(fastsync_queue_put(q, data) == 0){
+			fastsync_eventcount_cancel_wait(&(q->not_full));
+			goto done;
+		}
+		fastsync_eventcount_commit_wait(&(q->not_full), key);
+	}
+
+ done:
+	fastsync_eventcount_notify(&(q->not_empty));
+
+	return 0;
+}
+
+/*
+ * dequeue an item
+ */
+int fastsync_queue_try_dequeue(fastsync_queue *q, void **data)
+{
+	if(q == NULL || data == NULL)
+		return 1;
+
+	if(fastsync_queue_get(q, data))
+		return EAGAIN;
+
+	fastsync_eventcount_notify(&(q->not_full));
+
+	return 0;
+}
+
+int fastsync_queue_dequeue(fastsync_queue *q, void **data)
+{
+	int key;
+	int i;
+
+	if(q == NULL || data == NULL)
+		return 1;
+
+	while(1){
+		for(i = 0; i < FASTSYNC_QUEUE_SPIN_LOOPS; i++){
+			if(fastsync_queue_get(q, data) == 0)
+				goto done;
+			spinlock_hint();
+		}
+
+		/* the queue is empty, wait for a producer */
+		fastsync_eventcount_prepare_wait(&(q->not_empty), &key);
+		if(fastsync_queue_get(q, data) == 0){
+			fastsync_eventcount_cancel_wait(&(q->not_empty));
+			goto done;
+		}
+		fastsync_eventcount_commit_wait(&(q->not_empty), key);
+	}
+
+ done:
+	fastsync_eventcount_notify(&(q->not_full));
+
+	return 0;
+}
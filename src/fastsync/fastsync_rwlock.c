@@ -0,0 +1,679 @@
+/*
+ * Implementation of the reader-writer lock of the fast synchronization
+ * primitives.
+ *
+ * A single-word reader-writer lock (like the one in glibc) makes every reader
+ * update the same cache line, which then bounces across the sockets even if
+ * the readers never conflict with each other. Here the reader count is split
+ * into per-node reader indicators, each on its own cache line. A reader only
+ * touches the indicator of its own node and reads the writer state, which
+ * stays in the readers' caches as long as there is no writer.
+ *
+ * A writer first acquires the writer state, which stops new readers, and then
+ * waits for the indicators to drain. Writers are preferred: a reader does not
+ * enter while some writer is waiting. This is the right choice for the
+ * read-mostly workloads this lock is meant for, but readers may starve under
+ * a constant stream of writers. With writer preference, a thread read-locking
+ * a lock it already holds for reading would wait for a queued writer, which
+ * waits for that thread; so each thread remembers the locks it holds for
+ * reading, and such a recursive read-lock enters without checking the writers.
+ * Once a thread holds more read locks than it can remember, it may hold any
+ * lock it does not remember, so it only waits for a writer that has taken the
+ * lock, and enters while a writer waits for the readers to drain; a writer 
+ * checks the readers again after taking the lock for such readers. 
+ * Write-locking a lock held by the calling thread returns EDEADLK.
+ *
+ * The indicators of a process-private lock are allocated outside the lock.
+ * A process-shared lock cannot point to memory of one process, so it uses a
+ * single reader count embedded in the lock instead.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * the number of spins before blocking on a writer or on the readers
+ */
+#define FASTSYNC_RWLOCK_SPIN_LOOPS 100
+
+/*
+ * the reader indicator used by this thread, -1 if not determined yet. The
+ * indicator is fixed once chosen, so that a reader always leaves from the
+ * indicator it entered, even if it has migrated to another node.
+ */
+static __thread int fastsync_rwlock_slot = -1;
+
+/*
+ * the thread id of this thread, 0 if not determined yet
+ */
+static __thread int fastsync_rwlock_tid = 0;
+
+/*
+ * The locks this thread holds for reading, once per read-lock, the most 
+ * recent last, so that unlocking in the reverse order finds the lock at the
+ * top. Read-locks beyond FASTSYNC_RWLOCK_MAX_HELD are not remembered, only 
+ * counted in fastsync_rwlock_unremembered; while it is not 0, the thread may
+ * hold any lock it does not remember. The table is only searched when a 
+ * writer is around.
+ */
+#define FASTSYNC_RWLOCK_MAX_HELD 8
+static __thread fastsync_rwlock *fastsync_rwlock_held[FASTSYNC_RWLOCK_MAX_HELD];
+static __thread int fastsync_rwlock_held_cnt = 0;
+static __thread int fastsync_rwlock_unremembered = 0;
+
+/*
+ * what a thread blocked by a writer waits for
+ */
+#define FASTSYNC_RWLOCK_WAIT_WRITER 0 // no writer in any state
+#define FASTSYNC_RWLOCK_WAIT_WRITERS 1 // neither a writer nor waiting writers
+#define FASTSYNC_RWLOCK_WAIT_UNLOCK 2 // no writer holding the lock (state 2)
+
+/*
+ * Allocate the reader indicators of a lock. Multiple threads may race to
+ * initialize a statically initialized lock; only one allocation is kept.
+ */
+static fastsync_rwlock_indicator *fastsync_rwlock_alloc(fastsync_rwlock *rw,
+							int cnt)
+{
+	fastsync_rwlock_indicator *ind, *old;
+
+	if(cnt <= 0)
+		cnt = fastsync_get_node_cnt();
+
+	if(posix_memalign((void**)&ind, 64,
+			  cnt * sizeof(fastsync_rwlock_indicator)))
+		return NULL;
+	memset(ind, 0, cnt * sizeof(fastsync_rwlock_indicator));
+
+	/* racing initializers use the same count */
+	rw->indicator_cnt = cnt;
+	old = atomic_cmpxchg(&(rw->indicators), NULL, ind);
+	if(old != NULL){
+		/* some one else has initialized the lock */
+		free(ind);
+		return old;
+	}
+
+	return ind;
+}
+
+/*
+ * get the reader indicators of a lock, allocating them for a statically
+ * initialized lock
+ */
+static inline fastsync_rwlock_indicator *fastsync_rwlock_get_ind(
+	fastsync_rwlock *rw)
+{
+	fastsync_rwlock_indicator *ind = atomic_read(rw->indicators);
+
+	if(ind == NULL)
+		ind = fastsync_rwlock_alloc(rw, 0);
+	gcc_barrier();
+
+	return ind;
+}
+
+/*
+ * get the reader count of the calling thread's indicator; NULL if the 
+ * indicators cannot be allocated
+ */
+static inline int *fastsync_rwlock_my_readers(fastsync_rwlock *rw)
+{
+	fastsync_rwlock_indicator *ind;
+	int slot;
+
+	if(rw->shared)
+		return &(rw->readers);
+
+	ind = fastsync_rwlock_get_ind(rw);
+	if(ind == NULL)
+		return NULL;
+
+	slot = fastsync_rwlock_slot;
+	if(slot == -1)
+		slot = fastsync_rwlock_slot = fastsync_get_node();
+	/* the slot is the node, which is almost always below the count */
+	if(slot >= rw->indicator_cnt)
+		slot %= rw->indicator_cnt;
+
+	return &(ind[slot].readers);
+}
+
+/*
+ * get the thread id of the calling thread
+ */
+static inline int fastsync_rwlock_my_tid(void)
+{
+	if(fastsync_rwlock_tid == 0)
+		fastsync_rwlock_tid = syscall(SYS_gettid);
+
+	return fastsync_rwlock_tid;
+}
+
+/*
+ * Check whether the calling thread holds a lock for reading; returns 0 if it
+ * does not hold the lock, or the lock is not remembered (see 
+ * fastsync_rwlock_unremembered).
+ */
+static inline int fastsync_rwlock_holds(fastsync_rwlock *rw)
+{
+	int i;
+
+	for(i = fastsync_rwlock_held_cnt - 1; i >= 0; i--)
+		if(fastsync_rwlock_held[i] == rw)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * remember that the calling thread has read-locked a lock; only count it if
+ * the table is full
+ */
+static inline void fastsync_rwlock_hold(fastsync_rwlock *rw)
+{
+	if(fastsync_rwlock_held_cnt < FASTSYNC_RWLOCK_MAX_HELD)
+		fastsync_rwlock_held[fastsync_rwlock_held_cnt++] = rw;
+	else
+		fastsync_rwlock_unremembered++;
+}
+
+/*
+ * forget one read-lock of a lock by the calling thread
+ */
+static inline void fastsync_rwlock_release(fastsync_rwlock *rw)
+{
+	int i;
+
+	for(i = fastsync_rwlock_held_cnt - 1; i >= 0; i--){
+		if(fastsync_rwlock_held[i] == rw){
+			/* keep the order of the others */
+			for(fastsync_rwlock_held_cnt--; 
+			    i < fastsync_rwlock_held_cnt; i++)
+				fastsync_rwlock_held[i] = 
+					fastsync_rwlock_held[i + 1];
+			return;
+		}
+	}
+
+	/* not remembered */
+	if(fastsync_rwlock_unremembered > 0)
+		fastsync_rwlock_unremembered--;
+}
+
+/*
+ * Leave a reader indicator; wake up the writer if it is waiting for the last
+ * reader on this indicator.
+ */
+static inline void fastsync_rwlock_leave(fastsync_rwlock *rw, int *readers)
+{
+	if(atomic_subf(readers, 1) == 0 && atomic_read(rw->writer) == 1)
+		fastsync_futex_wake(readers, 1, 
+				    fastsync_futex_flags(rw->shared));
+}
+
+/*
+ * Wake up the threads blocked by a writer
+ */
+static inline void fastsync_rwlock_wake(fastsync_rwlock *rw)
+{
+	atomic_addf(&(rw->seq), 1);
+	if(atomic_read(rw->sleepers))
+		fastsync_futex_wake(&(rw->seq), INT_MAX, 
+				    fastsync_futex_flags(rw->shared));
+}
+
+/*
+ * Block until the current writer releases the lock, or, for until being
+ * FASTSYNC_RWLOCK_WAIT_WRITERS, also until the waiting writers are done.
+ */
+static int fastsync_rwlock_block(fastsync_rwlock *rw, int until,
+				 const struct timespec *abstime)
+{
+	int seq = atomic_read(rw->seq);
+	int ret_val = 0;
+	int writer;
+
+	atomic_addf(&(rw->sleepers), 1);
+	writer = atomic_read(rw->writer);
+	if(until == FASTSYNC_RWLOCK_WAIT_UNLOCK ? writer == 2 :
+	   (writer || (until == FASTSYNC_RWLOCK_WAIT_WRITERS &&
+		       atomic_read(rw->writers_waiting)))){
+		if(fastsync_futex_wait(&(rw->seq), seq, abstime, 
+				       fastsync_futex_flags(rw->shared)) == -1 &&
+		   (errno == ETIMEDOUT || errno == EINVAL))
+			ret_val = errno;
+	}
+	atomic_subf(&(rw->sleepers), 1);
+
+	return ret_val;
+}
+
+/*
+ * initialize a reader-writer lock
+ */
+int fastsync_rwlock_init(fastsync_rwlock *rw, const fastsync_rwlock_attr *attr)
+{
+	if(rw == NULL)
+		return 1;
+
+	rw->writer = 0;
+	rw->writers_waiting = 0;
+	rw->seq = 0;
+	rw->sleepers = 0;
+	rw->indicator_cnt = 0;
+	rw->indicators = NULL;
+	rw->shared = attr ? attr->shared : 0;
+	rw->readers = 0;
+	rw->owner = 0;
+
+	if(rw->shared){
+		rw->indicator_cnt = 1;
+		return 0;
+	}
+
+	if(fastsync_rwlock_alloc(rw, attr ? attr->indicator_cnt : 0) == NULL)
+		return ENOMEM;
+
+	return 0;
+}
+
+/*
+ * destroy a reader-writer lock
+ */
+int fastsync_rwlock_destroy(fastsync_rwlock *rw)
+{
+	if(rw == NULL)
+		return 1;
+
+	if(rw->indicators && !rw->shared)
+		free(rw->indicators);
+	rw->indicators = NULL;
+	rw->indicator_cnt = 0;
+
+	return 0;
+}
+
+/*
+ * Generic read-lock: try is non-zero for tryrdlock; abstime is NULL for
+ * waiting forever.
+ */
+static int fastsync_rwlock_rdlock_common(fastsync_rwlock *rw, int try,
+					 const struct timespec *abstime)
+{
+	int *readers;
+	int maybe_held;
+	int ret_val;
+	int i;
+
+	if(rw == NULL)
+		return 1;
+
+	readers = fastsync_rwlock_my_readers(rw);
+	if(readers == NULL)
+		return EAGAIN;
+
+	/* 
+	 * without writers, whether this thread already holds the lock does
+	 * not matter
+	 */
+	if(atomic_read(rw->writer) == 0 && 
+	   atomic_read(rw->writers_waiting) == 0){
+		atomic_addf(readers, 1);
+		if(atomic_read(rw->writer) == 0){
+			fastsync_rwlock_hold(rw);
+			return 0;
+		}
+		fastsync_rwlock_leave(rw, readers);
+	}
+
+	if(fastsync_rwlock_holds(rw)){
+		/*
+		 * a recursive read-lock; a writer cannot get past this
+		 * thread's reader, so do not wait for the writers
+		 */
+		atomic_addf(readers, 1);
+		fastsync_rwlock_hold(rw);
+		return 0;
+	}
+
+	if(!try && atomic_read(rw->writer) == 2 &&
+	   atomic_read(rw->owner) == fastsync_rwlock_my_tid())
+		return EDEADLK;
+
+	/* 
+	 * Holding read locks that are not remembered, the thread may hold 
+	 * this one, and a writer may be waiting for it to leave; as no writer
+	 * can take the lock from it, it only waits for a writer in state 2.
+	 */
+	maybe_held = fastsync_rwlock_unremembered > 0;
+
+	while(1){
+		for(i = 0; i < FASTSYNC_RWLOCK_SPIN_LOOPS; i++){
+			if(maybe_held ? atomic_read(rw->writer) != 2 :
+			   (atomic_read(rw->writer) == 0 &&
+			    atomic_read(rw->writers_waiting) == 0)){
+				/* announce the reader, then re-check writer */
+				atomic_addf(readers, 1);
+				if(maybe_held ? atomic_read(rw->writer) != 2 :
+				   atomic_read(rw->writer) == 0){
+					fastsync_rwlock_hold(rw);
+					return 0;
+				}
+				/* a writer came in between, back off */
+				fastsync_rwlock_leave(rw, readers);
+			}
+			if(try)
+				return EBUSY;
+			spinlock_hint();
+		}
+
+		/* wait for the writers to finish */
+		ret_val = fastsync_rwlock_block(rw, maybe_held ? 
+						FASTSYNC_RWLOCK_WAIT_UNLOCK :
+						FASTSYNC_RWLOCK_WAIT_WRITERS,
+						abstime);
+		if(ret_val)
+			return ret_val;
+	}
+
+	/* should be unreachable */
+	return 0;
+}
+
+/*
+ * Get the reader count of the i-th indicator; used by writers, which have
+ * made sure the indicators are allocated
+ */
+static inline int *fastsync_rwlock_readers(fastsync_rwlock *rw, int i)
+{
+	if(rw->shared)
+		return &(rw->readers);
+
+	return &(rw->indicators[i].readers);
+}
+
+/*
+ * check that there is no reader on any indicator
+ */
+static inline int fastsync_rwlock_no_readers(fastsync_rwlock *rw)
+{
+	int i;
+
+	for(i = 0; i < rw->indicator_cnt; i++)
+		if(atomic_read(*fastsync_rwlock_readers(rw, i)) != 0)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * Wait for the readers on an indicator to leave. Called by a writer in
+ * state 1 (draining).
+ */
+static int fastsync_rwlock_drain(fastsync_rwlock *rw, int *readers,
+				 const struct timespec *abstime)
+{
+	int cnt;
+	int i = 0;
+
+	while((cnt = atomic_read(*readers)) != 0){
+		if(i < FASTSYNC_RWLOCK_SPIN_LOOPS){
+			i++;
+			spinlock_hint();
+			continue;
+		}
+		if(fastsync_futex_wait(readers, cnt, abstime,
+				       fastsync_futex_flags(rw->shared)) == -1 && 
+		   (errno == ETIMEDOUT || errno == EINVAL))
+			return errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Generic write-lock: try is non-zero for trywrlock; abstime is NULL for
+ * waiting forever.
+ */
+static int fastsync_rwlock_wrlock_common(fastsync_rwlock *rw, int try,
+					 const struct timespec *abstime)
+{
+	int ret_val;
+	int i;
+
+	if(rw == NULL)
+		return 1;
+
+	if(!rw->shared && fastsync_rwlock_get_ind(rw) == NULL)
+		return EAGAIN;
+
+	if(!try && (fastsync_rwlock_holds(rw) ||
+		    (atomic_read(rw->writer) == 2 &&
+		     atomic_read(rw->owner) == fastsync_rwlock_my_tid())))
+		return EDEADLK;
+
+	if(try){
+		/* take the lock, then check for readers, as below */
+		if(atomic_cmpxchg(&(rw->writer), 0, 2) != 0)
+			return EBUSY;
+		if(!fastsync_rwlock_no_readers(rw)){
+			/* there are readers, give up */
+			atomic_xchg(&(rw->writer), 0);
+			fastsync_rwlock_wake(rw);
+			return EBUSY;
+		}
+		atomic_read(rw->owner) = fastsync_rwlock_my_tid();
+		return 0;
+	}
+
+	/* stop new readers from entering */
+	atomic_addf(&(rw->writers_waiting), 1);
+
+	/* acquire the writer state */
+	i = 0;
+	while(atomic_cmpxchg(&(rw->writer), 0, 1) != 0){
+		if(i < FASTSYNC_RWLOCK_SPIN_LOOPS){
+			i++;
+			spinlock_hint();
+			continue;
+		}
+		ret_val = fastsync_rwlock_block(rw, 
+						FASTSYNC_RWLOCK_WAIT_WRITER,
+						abstime);
+		if(ret_val){
+			/* timeout, let the blocked readers re-check */
+			atomic_subf(&(rw->writers_waiting), 1);
+			fastsync_rwlock_wake(rw);
+			return ret_val;
+		}
+	}
+	atomic_subf(&(rw->writers_waiting), 1);
+
+	while(1){
+		/* wait for the readers to leave */
+		for(i = 0; i < rw->indicator_cnt; i++){
+			ret_val = fastsync_rwlock_drain(rw, 
+				fastsync_rwlock_readers(rw, i), abstime);
+			if(ret_val){
+				/* timeout, release the writer state */
+				atomic_xchg(&(rw->writer), 0);
+				fastsync_rwlock_wake(rw);
+				return ret_val;
+			}
+		}
+
+		/*
+		 * Take the lock, then check the readers again: a reader that 
+		 * may already hold the lock enters in state 1, possibly on an
+		 * indicator drained before. Such a reader checks the state 
+		 * after announcing itself, so it either sees state 2 and backs
+		 * off, or is seen here.
+		 */
+		atomic_xchg(&(rw->writer), 2);
+		if(fastsync_rwlock_no_readers(rw))
+			break;
+		/* let the readers blocked on state 2 re-check */
+		atomic_xchg(&(rw->writer), 1);
+		fastsync_rwlock_wake(rw);
+	}
+
+	/* write-locked */
+	atomic_read(rw->owner) = fastsync_rwlock_my_tid();
+
+	return 0;
+}
+
+/*
+ * read-lock a reader-writer lock
+ */
+int fastsync_rwlock_rdlock(fastsync_rwlock *rw)
+{
+	return fastsync_rwlock_rdlock_common(rw, 0, NULL);
+}
+
+int fastsync_rwlock_tryrdlock(fastsync_rwlock *rw)
+{
+	return fastsync_rwlock_rdlock_common(rw, 1, NULL);
+}
+
+int fastsync_rwlock_timedrdlock(fastsync_rwlock *rw,
+				const struct timespec *abstime)
+{
+	return fastsync_rwlock_rdlock_common(rw, 0, abstime);
+}
+
+/*
+ * write-lock a reader-writer lock
+ */
+int fastsync_rwlock_wrlock(fastsync_rwlock *rw)
+{
+	return fastsync_rwlock_wrlock_common(rw, 0, NULL);
+}
+
+int fastsync_rwlock_trywrlock(fastsync_rwlock *rw)
+{
+	return fastsync_rwlock_wrlock_common(rw, 1, NULL);
+}
+
+int fastsync_rwlock_timedwrlock(fastsync_rwlock *rw,
+				const struct timespec *abstime)
+{
+	return fastsync_rwlock_wrlock_common(rw, 0, abstime);
+}
+
+/*
+ * unlock a reader-writer lock
+ */
+int fastsync_rwlock_unlock(fastsync_rwlock *rw)
+{
+	if(rw == NULL)
+		return 1;
+
+	/*
+	 * no reader can hold the lock in state 2 once the writer has checked
+	 * the readers and set the owner, so this must be the writer
+	 */
+	if(atomic_read(rw->writer) == 2 &&
+	   atomic_read(rw->owner) == fastsync_rwlock_my_tid()){
+		atomic_read(rw->owner) = 0;
+		atomic_xchg(&(rw->writer), 0);
+		fastsync_rwlock_wake(rw);
+		return 0;
+	}
+
+	/* a reader */
+	fastsync_rwlock_release(rw);
+	fastsync_rwlock_leave(rw, fastsync_rwlock_my_readers(rw));
+
+	return 0;
+}
+
+/*
+ * Read-lock a lock that no other thread uses, with plain loads and stores.
+ */
+int fastsync_rwlock_rdlock_single(fastsync_rwlock *rw)
+{
+	int *readers;
+
+	if(rw == NULL)
+		return 1;
+
+	if(rw->writer != 0 || rw->writers_waiting != 0)
+		return EBUSY;
+	readers = fastsync_rwlock_my_readers(rw);
+	if(readers == NULL)
+		return EBUSY;
+
+	(*readers)++;
+	fastsync_rwlock_hold(rw);
+
+	return 0;
+}
+
+/*
+ * Write-lock a lock that no other thread uses, with plain loads and stores.
+ */
+int fastsync_rwlock_wrlock_single(fastsync_rwlock *rw)
+{
+	if(rw == NULL)
+		return 1;
+
+	if(rw->writer != 0 || rw->writers_waiting != 0 ||
+	   (!rw->shared && fastsync_rwlock_get_ind(rw) == NULL) ||
+	   !fastsync_rwlock_no_readers(rw))
+		return EBUSY;
+
+	rw->owner = fastsync_rwlock_my_tid();
+	rw->writer = 2;
+
+	return 0;
+}
+
+/*
+ * Unlock a lock that no other thread uses, with plain loads and stores.
+ */
+int fastsync_rwlock_unlock_single(fastsync_rwlock *rw)
+{
+	int *readers;
+
+	if(rw == NULL)
+		return 1;
+
+	if(rw->writer == 2){
+		/* blocked fibers need to be woken up */
+		if(rw->owner != fastsync_rwlock_my_tid() || rw->sleepers != 0)
+			return EBUSY;
+		rw->owner = 0;
+		rw->writer = 0;
+		rw->seq++;
+		return 0;
+	}
+
+	/* a reader; a writer in state 1 waits for the readers to leave */
+	if(rw->writer != 0)
+		return EBUSY;
+	readers = fastsync_rwlock_my_readers(rw);
+	if(readers == NULL)
+		return EBUSY;
+
+	fastsync_rwlock_release(rw);
+	(*readers)--;
+
+	return 0;
+}
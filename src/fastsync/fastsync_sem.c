@@ -0,0 +1,203 @@
+/*
+ * Implementation of the semaphore of the fast synchronization primitives.
+ *
+ * The semaphore is a futex-backed counter. sem_post only makes a system call
+ * when some thread is blocked on the semaphore, and sem_wait spins for a 
+ * while before blocking. The spin count adapts to how long the semaphore 
+ * has recently been taking to become available, in the same way as glibc's
+ * adaptive mutex: spinning is extended if it used to succeed and shortened
+ * if it used to fail.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * the upper limit of the adaptive spin count
+ */
+#define FASTSYNC_SEM_SPIN_MAX 1000
+
+/*
+ * Take one unit from the semaphore if it is available. Return 1 on success.
+ */
+static inline int fastsync_sem_take(fastsync_sem *sem)
+{
+	unsigned int val, old;
+
+	val = atomic_read(sem->value);
+	while(val > 0){
+		old = atomic_cmpxchg(&(sem->value), val, val - 1);
+		if(old == val)
+			return 1;
+		val = old;
+	}
+
+	return 0;
+}
+
+/*
+ * Block while the value is zero; abstime is NULL for waiting forever.
+ */
+static inline int fastsync_sem_block(fastsync_sem *sem,
+				     const struct timespec *abstime)
+{
+	int ret_val;
+
+	ret_val = fastsync_futex_wait(&(sem->value), 0, abstime, 
+				      sem->private);
+	/* EAGAIN only means the value has changed */
+	if(ret_val == -1 && errno != EAGAIN)
+		return errno;
+
+	return 0;
+}
+
+/*
+ * initialize a fastsync semaphore
+ */
+int fastsync_sem_init(fastsync_sem *sem, int pshared, unsigned int value)
+{
+	if(sem == NULL)
+		return 1;
+
+	if(value > SEM_VALUE_MAX)
+		return EINVAL;
+
+	sem->value = value;
+	sem->waiters = 0;
+	sem->private = pshared ? 0 : FUTEX_PRIVATE_FLAG;
+	sem->spins = 0;
+	sem->evfd.fd = 0;
+	sem->evfd.waiters = 0;
+
+	return 0;
+}
+
+/*
+ * destroy a fastsync semaphore
+ */
+int fastsync_sem_destroy(fastsync_sem *sem)
+{
+	if(sem == NULL)
+		return 1;
+
+	fastsync_evfd_close(&(sem->evfd));
+
+	return 0;
+}
+
+/*
+ * Generic wait: try is non-zero for trywait; abstime is NULL for waiting 
+ * forever.
+ */
+static int fastsync_sem_wait_common(fastsync_sem *sem, int try,
+				    const struct timespec *abstime)
+{
+	int max_spins;
+	int ret_val = 0;
+	int i;
+
+	if(sem == NULL)
+		return 1;
+
+	if(fastsync_sem_take(sem))
+		return 0;
+	if(try)
+		return EAGAIN;
+
+	/* adaptive spinning */
+	max_spins = sem->spins * 2 + 10;
+	if(max_spins > FASTSYNC_SEM_SPIN_MAX)
+		max_spins = FASTSYNC_SEM_SPIN_MAX;
+	for(i = 0; i < max_spins; i++){
+		spinlock_hint();
+		if(fastsync_sem_take(sem)){
+			sem->spins += (i - sem->spins) / 8;
+			return 0;
+		}
+	}
+	sem->spins += (max_spins - sem->spins) / 8;
+
+	/* announce the waiter before the last check, then block */
+	atomic_addf(&(sem->waiters), 1);
+	while(!fastsync_sem_take(sem)){
+		ret_val = fastsync_sem_block(sem, abstime);
+		if(ret_val)
+			break;
+	}
+	atomic_subf(&(sem->waiters), 1);
+
+	return ret_val;
+}
+
+/*
+ * decrement a fastsync semaphore
+ */
+int fastsync_sem_wait(fastsync_sem *sem)
+{
+	return fastsync_sem_wait_common(sem, 0, NULL);
+}
+
+int fastsync_sem_trywait(fastsync_sem *sem)
+{
+	return fastsync_sem_wait_common(sem, 1, NULL);
+}
+
+int fastsync_sem_timedwait(fastsync_sem *sem, const struct timespec *abstime)
+{
+	return fastsync_sem_wait_common(sem, 0, abstime);
+}
+
+/*
+ * increment a fastsync semaphore
+ */
+int fastsync_sem_post(fastsync_sem *sem)
+{
+	unsigned int val, old;
+
+	if(sem == NULL)
+		return 1;
+
+	val = atomic_read(sem->value);
+	do{
+		if(val >= SEM_VALUE_MAX)
+			return EOVERFLOW;
+		old = val;
+		val = atomic_cmpxchg(&(sem->value), old, old + 1);
+	}while(val != old);
+
+	/* only wake up some one if there are waiters */
+	if(atomic_read(sem->waiters))
+		fastsync_futex_wake(&(sem->value), 1, sem->private);
+	fastsync_evfd_notify(&(sem->evfd));
+
+	return 0;
+}
+
+/*
+ * get the value of a fastsync semaphore
+ */
+int fastsync_sem_getvalue(fastsync_sem *sem, int *value)
+{
+	if(sem == NULL || value == NULL)
+		return 1;
+
+	*value = atomic_read(sem->value);
+
+	return 0;
+}
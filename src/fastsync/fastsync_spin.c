@@ -0,0 +1,139 @@
+/*
+ * Implementation of the spinlock of the fast synchronization primitives.
+ *
+ * glibc's spinlock retries the atomic operation without any delay. On a large
+ * machine, the waiters keep pulling the lock's cache line away from the 
+ * holder and from each other, and the throughput of the lock collapses as the
+ * number of waiters grows. Here a waiter backs off exponentially after each
+ * failed attempt.
+ *
+ * The backoff is also topology-aware, following the idea of the hierarchical
+ * backoff lock (Radovic and Hagersten, HPCA 2003): the lock word records the
+ * node of the holder, and a waiter on the same node as the holder uses a 
+ * smaller backoff limit than a waiter on a remote node. A released lock is 
+ * therefore more likely to be taken over by a thread on the same node, where
+ * the lock and the data it protects are already cached.
+ *
+ * With _FASTSYNC_SPIN_LOCAL_ defined, a waiter also spins locally on its 
+ * cached copy of the lock word after backing off, and only retries the atomic
+ * operation once it sees the lock released. This generates less coherence 
+ * traffic when the critical sections are long.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * Backoff limits (in spin loops). The backoff starts with the minimum and is
+ * doubled after each failed attempt up to the limit of the holder's node.
+ */
+#define FASTSYNC_SPIN_BACKOFF_MIN 4
+#define FASTSYNC_SPIN_BACKOFF_LOCAL_MAX 256
+#define FASTSYNC_SPIN_BACKOFF_REMOTE_MAX 4096
+
+/*
+ * initialize a fastsync spinlock
+ */
+int fastsync_spin_init(fastsync_spinlock *lock, int pshared)
+{
+	if(lock == NULL)
+		return 1;
+
+	lock->lock = 0;
+
+	return 0;
+}
+
+/*
+ * destroy a fastsync spinlock
+ */
+int fastsync_spin_destroy(fastsync_spinlock *lock)
+{
+	if(lock == NULL)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * lock a fastsync spinlock
+ */
+int fastsync_spin_lock(fastsync_spinlock *lock)
+{
+	int me, holder;
+	int backoff = FASTSYNC_SPIN_BACKOFF_MIN;
+	int limit;
+	int i;
+
+	if(lock == NULL)
+		return 1;
+
+	me = fastsync_get_node() + 1;
+
+	while(1){
+		holder = atomic_cmpxchg(&(lock->lock), 0, me);
+		if(holder == 0)
+			return 0;
+
+		/* back off; shorter if the holder is on our node */
+		for(i = 0; i < backoff; i++)
+			spinlock_hint();
+		limit = (holder == me) ? FASTSYNC_SPIN_BACKOFF_LOCAL_MAX : 
+			FASTSYNC_SPIN_BACKOFF_REMOTE_MAX;
+		backoff <<= 1;
+		if(backoff > limit)
+			backoff = limit;
+
+#ifdef _FASTSYNC_SPIN_LOCAL_
+		/* spin on the cached lock word until it is released */
+		while(atomic_read(lock->lock) != 0)
+			spinlock_hint();
+#endif
+	}
+
+	/* should be unreachable */
+	return 0;
+}
+
+/*
+ * try to lock a fastsync spinlock
+ */
+int fastsync_spin_trylock(fastsync_spinlock *lock)
+{
+	if(lock == NULL)
+		return 1;
+
+	if(atomic_read(lock->lock) == 0 &&
+	   atomic_cmpxchg(&(lock->lock), 0, fastsync_get_node() + 1) == 0)
+		return 0;
+
+	return EBUSY;
+}
+
+/*
+ * unlock a fastsync spinlock
+ */
+int fastsync_spin_unlock(fastsync_spinlock *lock)
+{
+	if(lock == NULL)
+		return 1;
+
+	gcc_barrier();
+	lock->lock = 0;
+
+	return 0;
+}
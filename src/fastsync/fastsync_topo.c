@@ -0,0 +1,145 @@
+/*
+ * Topology helpers of the fast synchronization primitives. REEact registers
+ * the cpu-to-node mapping here, so that primitives with per-node state can 
+ * find the node of a thread without depending on the rest of REEact. The
+ * mapping is registered at initialization, or by a loader that REEact runs
+ * where it is safe to block, e.g., in the first pthread_create; until then, 
+ * every thread is on node 0.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "fastsync.h"
+
+/*
+ * cpu-to-node mapping registered by REEact
+ */
+static int *fastsync_cpu_nodes = NULL;
+static int fastsync_cpu_cnt = 0;
+static int fastsync_node_cnt = 1;
+
+/*
+ * node of the current thread, -1 if unknown yet
+ */
+static __thread int fastsync_my_node = -1;
+
+/*
+ * the topology loader registered by REEact, and whether it has run
+ */
+#define FASTSYNC_TOPO_NONE 0
+#define FASTSYNC_TOPO_LOADING 1
+#define FASTSYNC_TOPO_LOADED 2
+static void (*fastsync_topo_loader)(void) = NULL;
+static int fastsync_topo_state = FASTSYNC_TOPO_NONE;
+static __thread int fastsync_topo_loading = 0;
+
+/*
+ * register the cpu-to-node mapping
+ */
+int fastsync_set_cpu_node_map(int *cpu_nodes, int cpu_cnt, int node_cnt)
+{
+	if(cpu_nodes == NULL || cpu_cnt <= 0 || node_cnt <= 0)
+		return 1;
+
+	fastsync_cpu_nodes = cpu_nodes;
+	fastsync_cpu_cnt = cpu_cnt;
+	fastsync_node_cnt = node_cnt;
+
+	return 0;
+}
+
+/*
+ * register the topology loader
+ */
+int fastsync_set_topology_loader(void (*loader)(void))
+{
+	fastsync_topo_loader = loader;
+
+	return 0;
+}
+
+/*
+ * run the topology loader, once
+ */
+int fastsync_load_topology()
+{
+	if(atomic_read(fastsync_topo_state) == FASTSYNC_TOPO_LOADED ||
+	   fastsync_topo_loader == NULL)
+		return 0;
+
+	/* 
+	 * the loader may come back here, e.g., through a lock it takes; the
+	 * topology is not known until it returns
+	 */
+	if(fastsync_topo_loading)
+		return 1;
+
+	if(atomic_cmpxchg(&fastsync_topo_state, FASTSYNC_TOPO_NONE,
+			  FASTSYNC_TOPO_LOADING) == FASTSYNC_TOPO_NONE){
+		fastsync_topo_loading = 1;
+		fastsync_topo_loader();
+		fastsync_topo_loading = 0;
+		mem_barrier();
+		fastsync_topo_state = FASTSYNC_TOPO_LOADED;
+		return 0;
+	}
+
+	/* another thread is loading; it does not take long */
+	while(atomic_read(fastsync_topo_state) != FASTSYNC_TOPO_LOADED)
+		sched_yield();
+
+	return 0;
+}
+
+/*
+ * check whether the topology is known, without loading it
+ */
+int fastsync_topology_known()
+{
+	return atomic_read(fastsync_topo_state) == FASTSYNC_TOPO_LOADED ||
+		fastsync_topo_loader == NULL;
+}
+
+/*
+ * get the node of the calling thread
+ */
+int fastsync_get_node()
+{
+	int cpu;
+
+	if(fastsync_my_node != -1)
+		return fastsync_my_node;
+
+	/* 
+	 * called on the lock paths, which must not block on the loader; not
+	 * cached until the topology is known
+	 */
+	if(!fastsync_topology_known())
+		return 0;
+
+	cpu = sched_getcpu();
+	if(fastsync_cpu_nodes == NULL || cpu < 0 || cpu >= fastsync_cpu_cnt ||
+	   fastsync_cpu_nodes[cpu] < 0)
+		fastsync_my_node = 0;
+	else
+		fastsync_my_node = fastsync_cpu_nodes[cpu];
+
+	return fastsync_my_node;
+}
+
+/*
+ * get the total number of nodes
+ */
+int fastsync_get_node_cnt()
+{
+	return fastsync_node_cnt;
+}
@@ -0,0 +1,330 @@
+/*
+ * The wait backend of the fast synchronization primitives. All primitives
+ * block and wake up through the functions here instead of calling futex
+ * directly, so that a user-level fiber scheduler can take over blocking.
+ *
+ * For plain threads, the functions are thin wrappers of the futex system
+ * call. For fibers, there is a parking table of FASTSYNC_PARK_BUCKETS
+ * buckets, hashed by the address of the futex word. A blocking fiber queues
+ * itself in the bucket of the address and asks its scheduler to suspend it;
+ * a waker resumes the fibers queued on the address before waking up threads
+ * in the kernel. The waker only looks at the table when some fiber is
+ * parked, so without fibers a wake-up costs one extra read and a barrier.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "fastsync.h"
+#include "../utils/reeact_utils.h"
+
+/*
+ * the number of buckets of the parking table, must be a power of 2
+ */
+#define FASTSYNC_PARK_BUCKETS 256
+
+/*
+ * a fiber parked on a futex word, lives on the stack of the fiber
+ */
+typedef struct _fastsync_parked{
+	void *addr; // the futex word
+	void *fiber; // the fiber handle
+	const fastsync_fiber_ops *ops; // the scheduler of the fiber
+	int woken; // set when removed from the table by a waker
+	struct _fastsync_parked *next;
+}fastsync_parked;
+
+/*
+ * a bucket of the parking table, one per cache line
+ */
+typedef struct _fastsync_park_bucket{
+	fastsync_spinlock lock;
+	fastsync_parked *head;
+	fastsync_parked *tail;
+	char padding[64 - sizeof(fastsync_spinlock) -
+		     2 * sizeof(fastsync_parked*)];
+}fastsync_park_bucket;
+
+static fastsync_park_bucket fastsync_park_table[FASTSYNC_PARK_BUCKETS]
+	__attribute__((aligned(64)));
+
+/*
+ * the number of fibers in (or entering) the parking table
+ */
+static int fastsync_parked_cnt = 0;
+
+/*
+ * the fiber scheduler of current thread
+ */
+static __thread const fastsync_fiber_ops *fastsync_my_fiber_ops = NULL;
+
+/*
+ * get the bucket of a futex word
+ */
+static inline fastsync_park_bucket *fastsync_park_bucket_of(void *addr)
+{
+	unsigned long a = (unsigned long)addr;
+
+	a = (a >> 2) ^ (a >> 10);
+
+	return &(fastsync_park_table[a & (FASTSYNC_PARK_BUCKETS - 1)]);
+}
+
+/*
+ * register the fiber scheduler of current thread
+ */
+int fastsync_fiber_register(const fastsync_fiber_ops *ops)
+{
+	if(ops != NULL && (ops->current == NULL || ops->suspend == NULL ||
+			   ops->resume == NULL))
+		return EINVAL;
+
+	fastsync_my_fiber_ops = ops;
+
+	return 0;
+}
+
+/*
+ * get the number of parked fibers
+ */
+int fastsync_fiber_parked_cnt()
+{
+	return atomic_read(fastsync_parked_cnt);
+}
+
+/*
+ * Suspend current fiber on a futex word.
+ */
+static long fastsync_fiber_wait(const fastsync_fiber_ops *ops, void *addr,
+				int val, const struct timespec *abstime)
+{
+	fastsync_park_bucket *b = fastsync_park_bucket_of(addr);
+	fastsync_parked me, **prev;
+
+	me.addr = addr;
+	me.fiber = ops->current(ops->data);
+	me.ops = ops;
+	me.woken = 0;
+	me.next = NULL;
+
+	/* announce the fiber before checking the value (see the waker) */
+	atomic_addf(&fastsync_parked_cnt, 1);
+
+	fastsync_spin_lock(&(b->lock));
+	if(atomic_read(*(int*)addr) != val){
+		fastsync_spin_unlock(&(b->lock));
+		atomic_subf(&fastsync_parked_cnt, 1);
+		errno = EAGAIN;
+		return -1;
+	}
+	if(b->tail)
+		b->tail->next = &me;
+	else
+		b->head = &me;
+	b->tail = &me;
+	fastsync_spin_unlock(&(b->lock));
+
+	if(ops->suspend(abstime, ops->data) != ETIMEDOUT)
+		return 0;
+
+	/* timed out, leave the queue unless a waker has removed the fiber */
+	fastsync_spin_lock(&(b->lock));
+	if(me.woken){
+		/* woken up at the same time, the wake-up is consumed here */
+		fastsync_spin_unlock(&(b->lock));
+		return 0;
+	}
+	prev = &(b->head);
+	b->tail = NULL;
+	while(*prev != NULL){
+		if(*prev == &me){
+			*prev = me.next;
+			continue;
+		}
+		b->tail = *prev;
+		prev = &((*prev)->next);
+	}
+	fastsync_spin_unlock(&(b->lock));
+	atomic_subf(&fastsync_parked_cnt, 1);
+
+	errno = ETIMEDOUT;
+	return -1;
+}
+
+/*
+ * Remove up to cnt fibers parked on addr from a locked bucket, and return
+ * them as a list in their queuing order.
+ */
+static fastsync_parked *fastsync_fiber_unlink(fastsync_park_bucket *b, 
+					      void *addr, int cnt)
+{
+	fastsync_parked *p, **prev;
+	fastsync_parked *head = NULL, *tail = NULL;
+	int n = 0;
+
+	prev = &(b->head);
+	b->tail = NULL;
+	while((p = *prev) != NULL){
+		if(p->addr != addr || n >= cnt){
+			b->tail = p;
+			prev = &(p->next);
+			continue;
+		}
+		*prev = p->next;
+		p->next = NULL;
+		if(tail)
+			tail->next = p;
+		else
+			head = p;
+		tail = p;
+		n++;
+	}
+
+	return head;
+}
+
+/*
+ * Resume a list of fibers removed from the table. Return the number of 
+ * fibers resumed.
+ */
+static int fastsync_fiber_resume(fastsync_parked *p)
+{
+	fastsync_parked *next;
+	int n = 0;
+
+	for(; p != NULL; p = next){
+		next = p->next;
+		atomic_subf(&fastsync_parked_cnt, 1);
+		/* p may be gone once woken is set and the bucket unlocked */
+		p->woken = 1;
+		p->ops->resume(p->fiber, p->ops->data);
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * convert a CLOCK_MONOTONIC time to CLOCK_REALTIME
+ */
+void fastsync_monotonic_to_realtime(const struct timespec *mono, 
+				    struct timespec *real)
+{
+	struct timespec now_mono, now_real;
+	long long ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &now_mono);
+	clock_gettime(CLOCK_REALTIME, &now_real);
+	ns = (mono->tv_sec - now_mono.tv_sec) * 1000000000LL + 
+		(mono->tv_nsec - now_mono.tv_nsec) + 
+		now_real.tv_sec * 1000000000LL + now_real.tv_nsec;
+	real->tv_sec = ns / 1000000000LL;
+	real->tv_nsec = ns % 1000000000LL;
+
+	return;
+}
+
+/*
+ * wait on a futex word
+ */
+long fastsync_futex_wait(void *addr, int val, const struct timespec *abstime,
+			 int flags)
+{
+	const fastsync_fiber_ops *ops = fastsync_my_fiber_ops;
+
+	if(ops != NULL && (flags & FUTEX_PRIVATE_FLAG))
+		return fastsync_fiber_wait(ops, addr, val, abstime);
+
+	if(abstime == NULL)
+		return sys_futex(addr, FUTEX_WAIT | flags, val, NULL, NULL, 0);
+
+	return sys_futex(addr, FUTEX_WAIT_BITSET | FUTEX_CLOCK_REALTIME | flags,
+			 val, abstime, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/*
+ * wake up waiters on a futex word
+ */
+long fastsync_futex_wake(void *addr, int cnt, int flags)
+{
+	fastsync_park_bucket *b;
+	long n = 0, ret_val;
+
+	/* order the change of the futex word before the check for fibers */
+	mem_barrier();
+	if((flags & FUTEX_PRIVATE_FLAG) && atomic_read(fastsync_parked_cnt)){
+		b = fastsync_park_bucket_of(addr);
+		fastsync_spin_lock(&(b->lock));
+		n = fastsync_fiber_resume(fastsync_fiber_unlink(b, addr, cnt));
+		fastsync_spin_unlock(&(b->lock));
+		if(n >= cnt)
+			return n;
+	}
+
+	ret_val = sys_futex(addr, FUTEX_WAKE | flags, cnt - n, NULL, NULL, 0);
+	if(ret_val == -1)
+		return n ? n : -1;
+
+	return n + ret_val;
+}
+
+/*
+ * wake up waiters on a futex word, and move the rest to another futex word
+ */
+long fastsync_futex_requeue(void *addr, int wake_cnt, int requeue_cnt,
+			    void *addr2, int flags)
+{
+	fastsync_park_bucket *b, *b2;
+	fastsync_parked *p, *next;
+	long n = 0, moved = 0, ret_val;
+
+	mem_barrier();
+	if((flags & FUTEX_PRIVATE_FLAG) && atomic_read(fastsync_parked_cnt)){
+		b = fastsync_park_bucket_of(addr);
+		b2 = fastsync_park_bucket_of(addr2);
+		/* lock the buckets in address order to avoid deadlocks */
+		if(b2 < b)
+			fastsync_spin_lock(&(b2->lock));
+		fastsync_spin_lock(&(b->lock));
+		if(b2 > b)
+			fastsync_spin_lock(&(b2->lock));
+
+		n = fastsync_fiber_resume(fastsync_fiber_unlink(b, addr, 
+								 wake_cnt));
+		p = fastsync_fiber_unlink(b, addr, requeue_cnt);
+		for(; p != NULL; p = next){
+			next = p->next;
+			p->next = NULL;
+			p->addr = addr2;
+			if(b2->tail)
+				b2->tail->next = p;
+			else
+				b2->head = p;
+			b2->tail = p;
+			moved++;
+		}
+
+		if(b2 != b)
+			fastsync_spin_unlock(&(b2->lock));
+		fastsync_spin_unlock(&(b->lock));
+	}
+
+	ret_val = sys_futex(addr, FUTEX_REQUEUE | flags, wake_cnt - n,
+			   (void*)(long)(requeue_cnt - moved), addr2, 0);
+	if(ret_val == -1)
+		return (n + moved) ? (n + moved) : -1;
+
+	return n + moved + ret_val;
+}
@@ -1,433 +1,493 @@
 /*
- * Skeleton implementation (and a dummy default policy) of user-specified REEact
- * management policy.
+ * The REEact policy dispatcher. The pthread hooks call the hooks of the active
+ * policy through reeact_active_policy (see reeact_policy.h). This file selects
+ * the active policy at initialization: one of the built-in policies, or a 
+ * policy plugin loaded from a shared library.
  *
  * Author: Wei Wang <wwang@virginia.edu>
- *
  */
 
 #define _GNU_SOURCE
 #include <stdio.h>
-#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <dlfcn.h>
 
 #include "../reeact.h"
 #include "../utils/reeact_utils.h"
-#include "../pthread_hooks/pthread_hooks_originals.h"
-#include "../hooks/gomp_hooks/gomp_hooks.h"
-#include "../hooks/gomp_hooks/gomp_hooks_originals.h"
+#include "reeact_policy.h"
+#include "../fastsync/fastsync.h"
 
 /*
- * user policy initialization
+ * the active policy; hooks called before reeact_policy_init, e.g., from the
+ * constructors of other libraries, use the built-in policy activated by
+ * reeact_policy_preinit, or the built-in default policy before that
  */
-
-int reeact_policy_init(void *data)
-{
-#ifdef _REEACT_DEFAULT_POLICY
-	struct reeact_data *d = (struct reeact_data*)data;
-	d->policy_data = NULL;
-
-	return 0;
+#ifdef _REEACT_DEFAULT_POLICY_
+const struct reeact_policy_ops *reeact_active_policy = 
+	&reeact_policy_passthrough;
 #else
-	// TODO: add user-policy here
-	return 0;
+const struct reeact_policy_ops *reeact_active_policy = 
+	&reeact_policy_fastsync;
 #endif
-}
 
 /*
- * user policy cleanup
+ * set by the pthread_create hook before the first thread is created
  */
-int reeact_policy_cleanup(void *data)
-{
-#ifdef _REEACT_DEFAULT_POLICY
-	return 0;
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif
-}
+int reeact_multithreaded = 0;
 
-/* 
- * pthread_create hook 
+#ifndef _REEACT_WRAP_
+/*
+ * the hooks of the loaded plugin, with the missing hooks filled in
  */
-int reeact_policy_pthread_create(void *thread, void *attr, 
-				void *(*start_routine) (void *), void *arg)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_create((pthread_t*)thread, (pthread_attr_t*)attr,
-				   start_routine, arg);
-#else
-	// TODO: add user-policy here
-	return 0;
+static struct reeact_policy_ops reeact_policy_plugin_ops;
 #endif
-}
 
-/* 
- * pthread_barrier hooks 
+/*
+ * fill a missing pthread hook with the passthrough hook
  */
-int reeact_policy_pthread_barrier_init(void *barrier, void *attr, 
-				       unsigned count)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_barrier_init((pthread_barrier_t*)barrier,
-					 (pthread_barrierattr_t*)attr,
-					 count);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif
-}
+#define REEACT_POLICY_FILL(p, hook)					\
+	do{								\
+		if((p)->hook == NULL)					\
+			(p)->hook = reeact_policy_passthrough.hook;	\
+	} while(0);
 
-int reeact_policy_pthread_barrier_wait(void *barrier)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_barrier_wait((pthread_barrier_t*)barrier);
-#else
-	// TODO: add user-policy here
-	return 0;
+/*
+ * Load a policy plugin.
+ * Input parameters:
+ *     path: the path of the shared library of the plugin
+ * Return value:
+ *     the hooks of the plugin; NULL if the plugin cannot be loaded
+ */
+static const struct reeact_policy_ops *reeact_policy_load(const char *path)
+{
+#ifdef _REEACT_WRAP_
+	/* the static build does not use the dynamic linker */
+	LOGERR("Unable to load policy plugin %s: plugins are not supported by "
+	       "the static REEact library\n", path);
+	return NULL;
+#else
+	struct reeact_policy_ops *p = &reeact_policy_plugin_ops;
+	const struct reeact_policy_ops *ops;
+	void *handle;
+
+	/* 
+	 * the plugin is never unloaded, its hooks may be running in other 
+	 * threads until the process exits
+	 */
+	handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if(handle == NULL){
+		LOGERR("Unable to load policy plugin %s: %s\n", path, 
+		       dlerror());
+		return NULL;
+	}
+
+	ops = (const struct reeact_policy_ops*)
+		dlsym(handle, REEACT_POLICY_PLUGIN_SYMBOL);
+	if(ops == NULL){
+		LOGERR("Policy plugin %s has no %s\n", path, 
+		       REEACT_POLICY_PLUGIN_SYMBOL);
+		dlclose(handle);
+		return NULL;
+	}
+	if(ops->abi_version != REEACT_POLICY_ABI_VERSION &&
+	   ops->abi_version != 1){
+		LOGERR("Policy plugin %s has ABI version %d, expecting %d\n",
+		       path, ops->abi_version, REEACT_POLICY_ABI_VERSION);
+		dlclose(handle);
+		return NULL;
+	}
+
+	if(ops->abi_version == 1){
+		/* the table of version 1 ends before the affinity hooks */
+		memset(p, 0, sizeof(*p));
+		memcpy(p, ops, offsetof(struct reeact_policy_ops,
+					pthread_setaffinity_np));
+	}
+	else
+		*p = *ops;
+	if(p->name == NULL)
+		p->name = path;
+	REEACT_POLICY_FILL(p, pthread_create);
+	REEACT_POLICY_FILL(p, pthread_barrier_init);
+	REEACT_POLICY_FILL(p, pthread_barrier_wait);
+	REEACT_POLICY_FILL(p, pthread_barrier_destroy);
+	REEACT_POLICY_FILL(p, pthread_mutex_init);
+	REEACT_POLICY_FILL(p, pthread_mutex_lock);
+	REEACT_POLICY_FILL(p, pthread_mutex_trylock);
+	REEACT_POLICY_FILL(p, pthread_mutex_timedlock);
+	REEACT_POLICY_FILL(p, pthread_mutex_unlock);
+	REEACT_POLICY_FILL(p, pthread_mutex_consistent);
+	REEACT_POLICY_FILL(p, pthread_mutex_destroy);
+	REEACT_POLICY_FILL(p, pthread_cond_init);
+	REEACT_POLICY_FILL(p, pthread_cond_signal);
+	REEACT_POLICY_FILL(p, pthread_cond_broadcast);
+	REEACT_POLICY_FILL(p, pthread_cond_destroy);
+	REEACT_POLICY_FILL(p, pthread_cond_wait);
+	REEACT_POLICY_FILL(p, pthread_cond_timedwait);
+	REEACT_POLICY_FILL(p, pthread_rwlock_init);
+	REEACT_POLICY_FILL(p, pthread_rwlock_destroy);
+	REEACT_POLICY_FILL(p, pthread_rwlock_rdlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_tryrdlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_timedrdlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_wrlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_trywrlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_timedwrlock);
+	REEACT_POLICY_FILL(p, pthread_rwlock_unlock);
+	REEACT_POLICY_FILL(p, pthread_spin_init);
+	REEACT_POLICY_FILL(p, pthread_spin_destroy);
+	REEACT_POLICY_FILL(p, pthread_spin_lock);
+	REEACT_POLICY_FILL(p, pthread_spin_trylock);
+	REEACT_POLICY_FILL(p, pthread_spin_unlock);
+	REEACT_POLICY_FILL(p, sem_init);
+	REEACT_POLICY_FILL(p, sem_destroy);
+	REEACT_POLICY_FILL(p, sem_wait);
+	REEACT_POLICY_FILL(p, sem_trywait);
+	REEACT_POLICY_FILL(p, sem_timedwait);
+	REEACT_POLICY_FILL(p, sem_post);
+	REEACT_POLICY_FILL(p, sem_getvalue);
+	REEACT_POLICY_FILL(p, pthread_setaffinity_np);
+	REEACT_POLICY_FILL(p, sched_setaffinity);
+	REEACT_POLICY_FILL(p, pthread_attr_setaffinity_np);
+
+	return p;
 #endif
 }
 
-int reeact_policy_pthread_barrier_destroy(void *barrier)
+/*
+ * Find the built-in policy reeact_policy_init will activate, before libc is
+ * initialized.
+ */
+const struct reeact_policy_ops *reeact_policy_preselect(void)
 {
+	const char *name = reeact_getenv_early(REEACT_POLICY_ENV);
+
+	if(!reeact_proc_selected())
+		return &reeact_policy_passthrough;
+
+	if(name == NULL || name[0] == '\0'){
 #ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_barrier_destroy((pthread_barrier_t*)barrier);
+		return &reeact_policy_passthrough;
 #else
-	// TODO: add user-policy here
-	return 0;
+		return &reeact_policy_fastsync;
 #endif
+	}
+	if(reeact_streq_early(name, "passthrough"))
+		return &reeact_policy_passthrough;
+	if(reeact_streq_early(name, "fastsync"))
+		return &reeact_policy_fastsync;
+
+	/* a plugin, not loaded until reeact_policy_init */
+	return NULL;
 }
 
 /*
- * pthread_mutex hooks
+ * activate the built-in policy before other libraries' constructors call 
+ * the hooks
  */
-
-int reeact_policy_pthread_mutex_init(void *mutex, void *attr)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_mutex_init((pthread_mutex_t*)mutex,
-				       (pthread_mutexattr_t*)attr);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
-
-int reeact_policy_pthread_mutex_lock(void *mutex)
+__attribute__((constructor(101)))
+static void reeact_policy_preinit(void)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	if(real_pthread_mutex_lock == NULL)
-		real_pthread_mutex_lock = dlsym(RTLD_NEXT, 
-						"pthread_mutex_lock");
-	return real_pthread_mutex_lock((pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+	const struct reeact_policy_ops *ops = reeact_policy_preselect();
 
-int reeact_policy_pthread_mutex_trylock(void *mutex)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_mutex_trylock((pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
+	if(ops != NULL)
+		reeact_active_policy = ops;
 }
 
-int reeact_policy_pthread_mutex_timedlock(void *mutex, void *abs_timeout)
+/*
+ * user policy initialization
+ */
+int reeact_policy_init(void *data)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_mutex_timedlock((pthread_mutex_t*)mutex,
-					    (struct timespec*)abs_timeout);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+	struct reeact_data *d = (struct reeact_data*)data;
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+	char *name = getenv(REEACT_POLICY_ENV);
+
+	if(d != NULL)
+		d->policy_data = NULL;
+
+	if(name != NULL && name[0] != '\0'){
+		if(strcmp(name, reeact_policy_passthrough.name) == 0)
+			ops = &reeact_policy_passthrough;
+		else if(strcmp(name, reeact_policy_fastsync.name) == 0)
+			ops = &reeact_policy_fastsync;
+		else{
+			ops = reeact_policy_load(name);
+			if(ops == NULL){
+				LOGERR("Falling back to the passthrough "
+				       "policy\n");
+				ops = &reeact_policy_passthrough;
+			}
+		}
+	}
+
+	DPRINTF("using policy %s\n", ops->name);
+	reeact_active_policy = ops;
+
+	if(ops->init)
+		return ops->init(data);
 
-int reeact_policy_pthread_mutex_unlock(void *mutex)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	if(real_pthread_mutex_unlock == NULL)
-		real_pthread_mutex_unlock = dlsym(RTLD_NEXT, 
-						  "pthread_mutex_unlock");
-	return real_pthread_mutex_unlock((pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
 	return 0;
-#endif	
 }
 
-int reeact_policy_pthread_mutex_consistent(void *mutex)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_mutex_consistent((pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+/*
+ * The layout of the objects of a type under a policy, told by one of its
+ * hooks: a hook of a built-in policy, including the passthrough hooks a 
+ * plugin is filled with, keeps the objects in the layout of that policy; a
+ * plugin's own hook is expected to handle objects of any layout.
+ */
+#define REEACT_POLICY_LAYOUT_ANY 0
+#define REEACT_POLICY_LAYOUT_GLIBC 1
+#define REEACT_POLICY_LAYOUT_FASTSYNC 2
+#define REEACT_POLICY_LAYOUT(ops, hook)					\
+	((ops)->hook == reeact_policy_passthrough.hook ?		\
+	 REEACT_POLICY_LAYOUT_GLIBC :					\
+	 ((ops)->hook == reeact_policy_fastsync.hook ?			\
+	  REEACT_POLICY_LAYOUT_FASTSYNC : REEACT_POLICY_LAYOUT_ANY))
 
-int reeact_policy_pthread_mutex_destroy(void *mutex)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_mutex_destroy((pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+/*
+ * check that the objects of a type keep their layout from one policy to
+ * another
+ */
+#define REEACT_POLICY_SAME_LAYOUT(a, b, hook)				\
+	(REEACT_POLICY_LAYOUT(a, hook) == REEACT_POLICY_LAYOUT_ANY ||	\
+	 REEACT_POLICY_LAYOUT(b, hook) == REEACT_POLICY_LAYOUT_ANY ||	\
+	 REEACT_POLICY_LAYOUT(a, hook) == REEACT_POLICY_LAYOUT(b, hook))
 
-int reeact_policy_pthread_cond_init(void *cond, void *attr)
+/*
+ * Check if the objects in use under a policy can be handled by another.
+ * Return value:
+ *     1: the objects of every type keep their layout
+ *     0: otherwise
+ */
+static int reeact_policy_compatible(const struct reeact_policy_ops *a,
+				    const struct reeact_policy_ops *b)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_init((pthread_cond_t*)cond, 
-				      (pthread_condattr_t*)attr);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
+	return REEACT_POLICY_SAME_LAYOUT(a, b, pthread_barrier_wait) &&
+		REEACT_POLICY_SAME_LAYOUT(a, b, pthread_mutex_lock) &&
+		REEACT_POLICY_SAME_LAYOUT(a, b, pthread_cond_wait) &&
+		REEACT_POLICY_SAME_LAYOUT(a, b, pthread_rwlock_rdlock) &&
+		REEACT_POLICY_SAME_LAYOUT(a, b, pthread_spin_lock) &&
+		REEACT_POLICY_SAME_LAYOUT(a, b, sem_wait);
 }
 
-int reeact_policy_pthread_cond_signal(void *cond)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_signal((pthread_cond_t*)cond);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+/*
+ * switch the active policy at run-time
+ */
+int reeact_policy_switch(const char *name)
+{
+	const struct reeact_policy_ops *old_ops = reeact_active_policy;
+	const struct reeact_policy_ops *ops;
+
+	if(strcmp(name, reeact_policy_passthrough.name) == 0)
+		ops = &reeact_policy_passthrough;
+	else if(strcmp(name, reeact_policy_fastsync.name) == 0)
+		ops = &reeact_policy_fastsync;
+#ifndef _REEACT_WRAP_
+	else if(reeact_policy_plugin_ops.abi_version != 0){
+		/* the plugin loaded before, by its name */
+		if(strcmp(name, reeact_policy_plugin_ops.name) != 0)
+			return EBUSY;
+		ops = &reeact_policy_plugin_ops;
+	}
+#endif
+	else{
+		ops = reeact_policy_load(name);
+		if(ops == NULL)
+			return ENOENT;
+	}
+
+	if(ops == old_ops)
+		return 0;
+	/* the objects in use must keep their layout */
+	if(!reeact_policy_compatible(old_ops, ops))
+		return EBUSY;
+
+	DPRINTF("switching from policy %s to %s\n", old_ops->name, ops->name);
+	if(ops->init){
+		int ret_val = ops->init((void*)reeact_handle);
+		if(ret_val)
+			return ret_val;
+	}
+	atomic_read(reeact_active_policy) = ops;
 
-int reeact_policy_pthread_cond_broadcast(void *cond)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_broadcast((pthread_cond_t*)cond);
-#else
-	// TODO: add user-policy here
 	return 0;
-#endif	
 }
 
-int reeact_policy_pthread_cond_destroy(void *cond)
+/*
+ * user policy cleanup
+ */
+int reeact_policy_cleanup(void *data)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_destroy((pthread_cond_t*)cond);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+	const struct reeact_policy_ops *ops = reeact_active_policy;
 
-int reeact_policy_pthread_cond_wait(void *cond, void *mutex)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_wait((pthread_cond_t*)cond,
-				      (pthread_mutex_t*)mutex);
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
-}
+	if(ops->cleanup)
+		return ops->cleanup(data);
 
-int reeact_policy_pthread_cond_timedwait(void *cond, void *mutex, void *abstime)
-{
-#ifdef _REEACT_DEFAULT_POLICY_
-	return real_pthread_cond_timedwait((pthread_cond_t*)cond,
-					   (pthread_mutex_t*)mutex,
-					   (struct timespec*)abstime);
-#else
-	// TODO: add user-policy here
 	return 0;
-#endif	
 }
 
-/* void reeact_policy_GOMP_barrier() */
-/* { */
-/* #ifdef _REEACT_DEFAULT_POLICY_ */
-/* 	return real_GOMP_barrier(); */
-/* #else */
-/* 	// TODO: add user-policy here */
-/* 	return; */
-/* #endif	 */
-/* } */
+/*
+ * gomp barrier hooks; a policy without a gomp hook lets libgomp proceed with
+ * its own implementation
+ */
 int reeact_gomp_barrier_init(void *bar, unsigned count)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p, count %u\n", __FUNCTION__, bar, count);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_init == NULL)
+		return 1;
+
+	return ops->gomp_barrier_init(bar, count);
 }
 
 int reeact_gomp_barrier_reinit(void *bar, unsigned count)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p, count %u\n", __FUNCTION__, bar, count);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_reinit == NULL)
+		return 1;
+
+	return ops->gomp_barrier_reinit(bar, count);
 }
 
 int reeact_gomp_barrier_destroy(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_destroy == NULL)
+		return 1;
+
+	return ops->gomp_barrier_destroy(bar);
 }
 
 int reeact_gomp_barrier_wait(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_wait == NULL)
+		return 1;
+
+	return ops->gomp_barrier_wait(bar);
 }
 
 int reeact_gomp_barrier_wait_last(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_wait_last == NULL)
+		return 1;
+
+	return ops->gomp_barrier_wait_last(bar);
 }
 
 int reeact_gomp_barrier_wait_end(void *bar, unsigned int state)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
-		state);	
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_wait_end == NULL)
+		return 1;
+
+	return ops->gomp_barrier_wait_end(bar, state);
 }
 
 int reeact_gomp_team_barrier_wait(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_wait == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_wait(bar);
 }
 
 int reeact_gomp_team_barrier_wait_end(void *bar, unsigned int state)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
-		state);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_wait_end == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_wait_end(bar, state);
 }
 
 int reeact_gomp_team_barrier_wake(void *bar, int count)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p and count %d\n", __FUNCTION__, bar, count);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_wake == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_wake(bar, count);
 }
 
 int reeact_gomp_team_barrier_set_task_pending(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_set_task_pending == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_set_task_pending(bar);
 }
 
 int reeact_gomp_team_barrier_clear_task_pending(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_clear_task_pending == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_clear_task_pending(bar);
 }
 
 int reeact_gomp_team_barrier_set_waiting_for_tasks(void *bar)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_set_waiting_for_tasks == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_set_waiting_for_tasks(bar);
 }
 
 int reeact_gomp_team_barrier_done(void *bar, unsigned int state)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
-		state);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_done == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_done(bar, state);
 }
 
 int reeact_gomp_team_barrier_waiting_for_tasks(void *bar, int *ret_val)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_team_barrier_waiting_for_tasks == NULL)
+		return 1;
+
+	return ops->gomp_team_barrier_waiting_for_tasks(bar, ret_val);
 }
 
 int reeact_gomp_barrier_last_thread(unsigned int state, int *ret_val)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with state %d\n", __FUNCTION__, state);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif	
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_last_thread == NULL)
+		return 1;
+
+	return ops->gomp_barrier_last_thread(state, ret_val);
 }
 
 int reeact_gomp_barrier_wait_start(void *bar, unsigned int *ret_val)
 {
-#ifdef _REEACT_DEFAULT_POLICY_
-	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
-	return 1;
-#else
-	// TODO: add user-policy here
-	return 0;
-#endif		
+	const struct reeact_policy_ops *ops = reeact_active_policy;
+
+	if(ops->gomp_barrier_wait_start == NULL)
+		return 1;
+
+	return ops->gomp_barrier_wait_start(bar, ret_val);
 }
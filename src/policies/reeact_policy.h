@@ -2,7 +2,8 @@
  * Header file for the user-specified REEact management policies. This file 
  * contains the declaration of functions that are used by other modules of
  * REEact, such as user-policy initialization function and user-defined 
- * pthread hooks. Feel free to add your own functions.
+ * pthread hooks. The pthread hooks dispatch to the active policy, see struct
+ * reeact_policy_ops.
  *
  * Author: Wei Wang <wwang@virginia.edu>
  */
@@ -10,6 +11,9 @@
 #ifndef __REEACT_USER_POLICY_H__
 #define __REEACT_USER_POLICY_H__
 
+#include <stddef.h>
+#include <pthread.h>
+
 /*
  * User policy initialization function. This function is called as part of 
  * REEact initialization process. Note that this function may be called before 
@@ -38,6 +42,209 @@ int reeact_policy_init(void *data);
  */
 int reeact_policy_cleanup(void *data);
 
+/*
+ * The policy ABI. A policy is a table of hook functions; the pthread hooks call
+ * the functions of the active policy through the table, one indirect call per
+ * hook. REEact has two built-in policies:
+ *     passthrough: calls the original pthread functions
+ *     fastsync: uses the fastsync primitives, kept in place in the pthread 
+ *               objects
+ * The built-in policy that is active from the start is passthrough if REEact 
+ * is built with _REEACT_DEFAULT_POLICY_, or fastsync otherwise. 
+ *
+ * At initialization, REEact switches to the policy named by the REEACT_POLICY
+ * environment variable, which is either the name of a built-in policy or the
+ * path of a shared library (a policy plugin) that defines a 
+ * "struct reeact_policy_ops reeact_policy_plugin" with abi_version set to 
+ * REEACT_POLICY_ABI_VERSION. NULL pthread hooks of a plugin are filled with
+ * the passthrough hooks, so a plugin only needs to define the hooks it 
+ * changes. A plugin that fails to load is replaced by the passthrough policy.
+ * Plugins built for ABI version 1, which ends before the affinity hooks, are
+ * still accepted, with the passthrough affinity hooks.
+ *
+ * A plugin is loaded into the process after libreeact.so, so it can call the
+ * real_* functions of pthread_hooks_originals.h, the fastsync primitives and
+ * the built-in policy tables below. Note that objects may be initialized, 
+ * statically or by other libraries' constructors, before the plugin is 
+ * loaded; a plugin should handle (or pass to the original functions) objects
+ * it has not initialized.
+ *
+ * A policy that only needs to watch the application, e.g., to adapt its 
+ * parameters, can subscribe to the events reported by the built-in hooks 
+ * from its init function (see events/reeact_events.h) instead of 
+ * implementing hooks.
+ *
+ *     abi_version: REEACT_POLICY_ABI_VERSION
+ *     name: the name of the policy, for logging
+ *     init: called when the policy is activated, with the same data as 
+ *           reeact_policy_init; may be NULL
+ *     cleanup: called when REEact is unloaded; may be NULL
+ */
+#define REEACT_POLICY_ABI_VERSION 2
+#define REEACT_POLICY_ENV "REEACT_POLICY"
+#define REEACT_POLICY_PLUGIN_SYMBOL "reeact_policy_plugin"
+
+struct reeact_policy_ops{
+	int abi_version;
+	const char *name;
+	int (*init)(void *data);
+	int (*cleanup)(void *data);
+
+	/* thread creation hook */
+	int (*pthread_create)(void *thread, void *attr,
+			      void *(*start_routine) (void *), void *arg);
+
+	/* barrier hooks */
+	int (*pthread_barrier_init)(void *barrier, void *attr, unsigned count);
+	int (*pthread_barrier_wait)(void *barrier);
+	int (*pthread_barrier_destroy)(void *barrier);
+
+	/* mutex hooks */
+	int (*pthread_mutex_init)(void *mutex, void *attr);
+	int (*pthread_mutex_lock)(void *mutex);
+	int (*pthread_mutex_trylock)(void *mutex);
+	int (*pthread_mutex_timedlock)(void *mutex, void *abs_timeout);
+	int (*pthread_mutex_unlock)(void *mutex);
+	int (*pthread_mutex_consistent)(void *mutex);
+	int (*pthread_mutex_destroy)(void *mutex);
+
+	/* cond hooks */
+	int (*pthread_cond_init)(void *cond, void *attr);
+	int (*pthread_cond_signal)(void *cond);
+	int (*pthread_cond_broadcast)(void *cond);
+	int (*pthread_cond_destroy)(void *cond);
+	int (*pthread_cond_wait)(void *cond, void *mutex);
+	int (*pthread_cond_timedwait)(void *cond, void *mutex, void *abstime);
+
+	/* rwlock hooks */
+	int (*pthread_rwlock_init)(void *rwlock, void *attr);
+	int (*pthread_rwlock_destroy)(void *rwlock);
+	int (*pthread_rwlock_rdlock)(void *rwlock);
+	int (*pthread_rwlock_tryrdlock)(void *rwlock);
+	int (*pthread_rwlock_timedrdlock)(void *rwlock, void *abstime);
+	int (*pthread_rwlock_wrlock)(void *rwlock);
+	int (*pthread_rwlock_trywrlock)(void *rwlock);
+	int (*pthread_rwlock_timedwrlock)(void *rwlock, void *abstime);
+	int (*pthread_rwlock_unlock)(void *rwlock);
+
+	/* spin hooks */
+	int (*pthread_spin_init)(void *lock, int pshared);
+	int (*pthread_spin_destroy)(void *lock);
+	int (*pthread_spin_lock)(void *lock);
+	int (*pthread_spin_trylock)(void *lock);
+	int (*pthread_spin_unlock)(void *lock);
+
+	/* sem hooks */
+	int (*sem_init)(void *sem, int pshared, unsigned int value);
+	int (*sem_destroy)(void *sem);
+	int (*sem_wait)(void *sem);
+	int (*sem_trywait)(void *sem);
+	int (*sem_timedwait)(void *sem, void *abstime);
+	int (*sem_post)(void *sem);
+	int (*sem_getvalue)(void *sem, int *sval);
+
+	/*
+	 * gomp barrier hooks, NULL to let libgomp use its own implementation
+	 */
+	int (*gomp_barrier_init)(void *bar, unsigned count);
+	int (*gomp_barrier_reinit)(void *bar, unsigned count);
+	int (*gomp_barrier_destroy)(void *bar);
+	int (*gomp_barrier_wait)(void *bar);
+	int (*gomp_barrier_wait_last)(void *bar);
+	int (*gomp_barrier_wait_end)(void *bar, unsigned int state);
+	int (*gomp_team_barrier_wait)(void *bar);
+	int (*gomp_team_barrier_wait_end)(void *bar, unsigned int state);
+	int (*gomp_team_barrier_wake)(void *bar, int count);
+	int (*gomp_team_barrier_set_task_pending)(void *bar);
+	int (*gomp_team_barrier_clear_task_pending)(void *bar);
+	int (*gomp_team_barrier_set_waiting_for_tasks)(void *bar);
+	int (*gomp_team_barrier_done)(void *bar, unsigned int state);
+	int (*gomp_team_barrier_waiting_for_tasks)(void *bar, int *ret_val);
+	int (*gomp_barrier_last_thread)(unsigned int state, int *ret_val);
+	int (*gomp_barrier_wait_start)(void *bar, unsigned int *ret_val);
+
+	/* 
+	 * affinity hooks (ABI version 2), see threads/reeact_threads.h; the
+	 * cpuset is a "cpu_set_t*"
+	 */
+	int (*pthread_setaffinity_np)(pthread_t thread, size_t size,
+				      const void *cpuset);
+	int (*sched_setaffinity)(int pid, size_t size, const void *cpuset);
+	int (*pthread_attr_setaffinity_np)(void *attr, size_t size,
+					   const void *cpuset);
+};
+
+/*
+ * the built-in policies, and the active policy
+ */
+extern const struct reeact_policy_ops reeact_policy_passthrough;
+extern const struct reeact_policy_ops reeact_policy_fastsync;
+extern const struct reeact_policy_ops *reeact_active_policy;
+
+/*
+ * Switch the active policy at run-time, e.g., from the control socket. The
+ * init function of the new policy is called; the cleanup function of the old
+ * one is not, as its hooks may still be running in other threads.
+ *
+ * The objects the application is using are handed to the new policy as they
+ * are, so the switch is only allowed when the new policy can handle them: a
+ * plugin is expected to handle objects it has not initialized (see above), 
+ * and so are the built-in policies after a plugin built on them, but the 
+ * passthrough and fastsync policies keep their objects differently. So the
+ * switch is refused if, for some type of objects, one policy uses the 
+ * passthrough hooks and the other the fastsync hooks; the passthrough hooks
+ * a plugin is filled with count as its own. Only one plugin can be loaded in
+ * a process.
+ * Input parameters:
+ *     name: the name of a built-in policy or of the loaded plugin, or the
+ *           path of a plugin to load
+ * Return value:
+ *     0: success, including when the policy is already active
+ *     EBUSY: the objects in use are not compatible with the new policy, or
+ *            another plugin is loaded
+ *     ENOENT: the plugin cannot be loaded
+ *     other: the error returned by the init function of the new policy
+ */
+int reeact_policy_switch(const char *name);
+
+/*
+ * Find the policy that reeact_policy_init will activate, from the initial
+ * environment of the process. Unlike reeact_policy_init, this function calls
+ * no libc function, so it can activate the policy before libc is initialized.
+ * Return value:
+ *     the built-in policy to activate, passthrough in a process that is not
+ *     selected (see reeact_proc_selected); NULL if REEACT_POLICY names a 
+ *     plugin
+ */
+const struct reeact_policy_ops *reeact_policy_preselect(void);
+
+/*
+ * The single-threaded fast path. reeact_multithreaded is set by the 
+ * pthread_create hook before the process creates its first thread, and is
+ * never cleared. Until then, there is no other thread to synchronize with, so
+ * a policy may use plain loads and stores instead of atomic instructions, and
+ * skip wake-ups, on objects that are not shared by processes, like glibc's 
+ * SINGLE_THREAD_P. Switching is safe: the stores of the single-threaded path
+ * are ordered before the new thread by its creation. glibc's 
+ * __libc_single_threaded, where available, is also checked for the threads 
+ * glibc creates internally (e.g., for SIGEV_THREAD timers), which do not go
+ * through the hook. Threads created by calling clone directly are not seen.
+ * Note that fibers may still interleave on the only thread (see 
+ * fastsync_fiber_register); a policy must not skip wake-ups that a parked 
+ * fiber may be waiting for.
+ * Return value:
+ *     1: the process has only one thread
+ *     0: the process may have more than one thread
+ */
+extern int reeact_multithreaded;
+extern char __libc_single_threaded __attribute__((weak));
+
+static inline int reeact_single_threaded(void)
+{
+	return !reeact_multithreaded && 
+		(&__libc_single_threaded == NULL || __libc_single_threaded);
+}
+
 /*
  * pthread_create hook of the user policy.
  *
@@ -49,8 +256,13 @@ int reeact_policy_cleanup(void *data);
  * Return values:
  *     same as pthread_create or by user definition
  */
-int reeact_policy_pthread_create(void *thread, void *attr, 
-				 void *(*start_routine) (void *), void *arg);
+static inline int reeact_policy_pthread_create(void *thread, void *attr,
+					       void *(*start_routine) (void *),
+					       void *arg)
+{
+	return reeact_active_policy->pthread_create(thread, attr, start_routine,
+						    arg);
+}
 
 /*
  * pthread_barrier hooks of the user policy.
@@ -62,10 +274,21 @@ int reeact_policy_pthread_create(void *thread, void *attr,
  * Return values:
  *     same as corresponding pthread_barrier functions or by user definition
  */
-int reeact_policy_pthread_barrier_init(void *barrier, void *attr, 
-				       unsigned count);
-int reeact_policy_pthread_barrier_wait(void *barrier);
-int reeact_policy_pthread_barrier_destroy(void *barrier);
+static inline int reeact_policy_pthread_barrier_init(void *barrier, void *attr,
+						     unsigned count)
+{
+	return reeact_active_policy->pthread_barrier_init(barrier, attr, count);
+}
+
+static inline int reeact_policy_pthread_barrier_wait(void *barrier)
+{
+	return reeact_active_policy->pthread_barrier_wait(barrier);
+}
+
+static inline int reeact_policy_pthread_barrier_destroy(void *barrier)
+{
+	return reeact_active_policy->pthread_barrier_destroy(barrier);
+}
 
 /*
  * pthread mutex hooks of the user policy.
@@ -77,13 +300,42 @@ int reeact_policy_pthread_barrier_destroy(void *barrier);
  * Return values:
  *     same as corresponding pthread_mutex functions or by user definition
  */
-int reeact_policy_pthread_mutex_init(void *mutex, void *attr);
-int reeact_policy_pthread_mutex_lock(void *mutex);
-int reeact_policy_pthread_mutex_trylock(void *mutex);
-int reeact_policy_pthread_mutex_timedlock(void *mutex, void *abs_timeout);
-int reeact_policy_pthread_mutex_unlock(void *mutex);
-int reeact_policy_pthread_mutex_consistent(void *mutex);
-int reeact_policy_pthread_mutex_destroy(void *mutex);
+static inline int reeact_policy_pthread_mutex_init(void *mutex, void *attr)
+{
+	return reeact_active_policy->pthread_mutex_init(mutex, attr);
+}
+
+static inline int reeact_policy_pthread_mutex_lock(void *mutex)
+{
+	return reeact_active_policy->pthread_mutex_lock(mutex);
+}
+
+static inline int reeact_policy_pthread_mutex_trylock(void *mutex)
+{
+	return reeact_active_policy->pthread_mutex_trylock(mutex);
+}
+
+static inline int reeact_policy_pthread_mutex_timedlock(void *mutex,
+							void *abs_timeout)
+{
+	return reeact_active_policy->pthread_mutex_timedlock(mutex,
+							     abs_timeout);
+}
+
+static inline int reeact_policy_pthread_mutex_unlock(void *mutex)
+{
+	return reeact_active_policy->pthread_mutex_unlock(mutex);
+}
+
+static inline int reeact_policy_pthread_mutex_consistent(void *mutex)
+{
+	return reeact_active_policy->pthread_mutex_consistent(mutex);
+}
+
+static inline int reeact_policy_pthread_mutex_destroy(void *mutex)
+{
+	return reeact_active_policy->pthread_mutex_destroy(mutex);
+}
 
 
 /*
@@ -96,12 +348,213 @@ int reeact_policy_pthread_mutex_destroy(void *mutex);
  * Return values:
  *     same as corresponding pthread_mutex functions or by user definition
  */
-int reeact_policy_pthread_cond_init(void *cond, void *attr);
-int reeact_policy_pthread_cond_signal(void *cond);
-int reeact_policy_pthread_cond_broadcast(void *cond);
-int reeact_policy_pthread_cond_destroy(void *cond);
-int reeact_policy_pthread_cond_wait(void *cond, void *mutex);
-int reeact_policy_pthread_cond_timedwait(void *cond, void *mutex, void *abstime);
+static inline int reeact_policy_pthread_cond_init(void *cond, void *attr)
+{
+	return reeact_active_policy->pthread_cond_init(cond, attr);
+}
+
+static inline int reeact_policy_pthread_cond_signal(void *cond)
+{
+	return reeact_active_policy->pthread_cond_signal(cond);
+}
+
+static inline int reeact_policy_pthread_cond_broadcast(void *cond)
+{
+	return reeact_active_policy->pthread_cond_broadcast(cond);
+}
+
+static inline int reeact_policy_pthread_cond_destroy(void *cond)
+{
+	return reeact_active_policy->pthread_cond_destroy(cond);
+}
+
+static inline int reeact_policy_pthread_cond_wait(void *cond, void *mutex)
+{
+	return reeact_active_policy->pthread_cond_wait(cond, mutex);
+}
+
+static inline int reeact_policy_pthread_cond_timedwait(void *cond, void *mutex,
+						       void *abstime)
+{
+	return reeact_active_policy->pthread_cond_timedwait(cond, mutex,
+							    abstime);
+}
+
+/*
+ * pthread reader-writer lock hooks of the user policy.
+ * 
+ * Input parameters (see the pthread_rwlock manuals for more info):
+ *     rwlock: by default a "pthread_rwlock_t*" type
+ *     attr: by default a "pthread_rwlockattr_t*" type
+ *     abstime: by default a "struct timespec*) type
+ * Return values:
+ *     same as corresponding pthread_rwlock functions or by user definition
+ */
+static inline int reeact_policy_pthread_rwlock_init(void *rwlock, void *attr)
+{
+	return reeact_active_policy->pthread_rwlock_init(rwlock, attr);
+}
+
+static inline int reeact_policy_pthread_rwlock_destroy(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_destroy(rwlock);
+}
+
+static inline int reeact_policy_pthread_rwlock_rdlock(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_rdlock(rwlock);
+}
+
+static inline int reeact_policy_pthread_rwlock_tryrdlock(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_tryrdlock(rwlock);
+}
+
+static inline int reeact_policy_pthread_rwlock_timedrdlock(void *rwlock,
+							   void *abstime)
+{
+	return reeact_active_policy->pthread_rwlock_timedrdlock(rwlock,
+								abstime);
+}
+
+static inline int reeact_policy_pthread_rwlock_wrlock(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_wrlock(rwlock);
+}
+
+static inline int reeact_policy_pthread_rwlock_trywrlock(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_trywrlock(rwlock);
+}
+
+static inline int reeact_policy_pthread_rwlock_timedwrlock(void *rwlock,
+							   void *abstime)
+{
+	return reeact_active_policy->pthread_rwlock_timedwrlock(rwlock,
+								abstime);
+}
+
+static inline int reeact_policy_pthread_rwlock_unlock(void *rwlock)
+{
+	return reeact_active_policy->pthread_rwlock_unlock(rwlock);
+}
+
+/*
+ * pthread spinlock hooks of the user policy.
+ * 
+ * Input parameters (see the pthread_spin manuals for more info):
+ *     lock: by default a "pthread_spinlock_t*" type
+ *     pshared: whether the spinlock is shared among processes
+ * Return values:
+ *     same as corresponding pthread_spin functions or by user definition
+ */
+static inline int reeact_policy_pthread_spin_init(void *lock, int pshared)
+{
+	return reeact_active_policy->pthread_spin_init(lock, pshared);
+}
+
+static inline int reeact_policy_pthread_spin_destroy(void *lock)
+{
+	return reeact_active_policy->pthread_spin_destroy(lock);
+}
+
+static inline int reeact_policy_pthread_spin_lock(void *lock)
+{
+	return reeact_active_policy->pthread_spin_lock(lock);
+}
+
+static inline int reeact_policy_pthread_spin_trylock(void *lock)
+{
+	return reeact_active_policy->pthread_spin_trylock(lock);
+}
+
+static inline int reeact_policy_pthread_spin_unlock(void *lock)
+{
+	return reeact_active_policy->pthread_spin_unlock(lock);
+}
+
+/*
+ * POSIX semaphore hooks of the user policy.
+ * 
+ * Input parameters (see the sem_* manuals for more info):
+ *     sem: by default a "sem_t*" type
+ *     pshared: whether the semaphore is shared among processes
+ *     value: initial value of the semaphore
+ *     abstime: by default a "struct timespec*" type
+ *     sval: output of the semaphore value
+ * Return values:
+ *     same as corresponding sem functions (-1 with errno set on error) or by
+ *     user definition
+ */
+static inline int reeact_policy_sem_init(void *sem, int pshared,
+					 unsigned int value)
+{
+	return reeact_active_policy->sem_init(sem, pshared, value);
+}
+
+static inline int reeact_policy_sem_destroy(void *sem)
+{
+	return reeact_active_policy->sem_destroy(sem);
+}
+
+static inline int reeact_policy_sem_wait(void *sem)
+{
+	return reeact_active_policy->sem_wait(sem);
+}
+
+static inline int reeact_policy_sem_trywait(void *sem)
+{
+	return reeact_active_policy->sem_trywait(sem);
+}
+
+static inline int reeact_policy_sem_timedwait(void *sem, void *abstime)
+{
+	return reeact_active_policy->sem_timedwait(sem, abstime);
+}
+
+static inline int reeact_policy_sem_post(void *sem)
+{
+	return reeact_active_policy->sem_post(sem);
+}
+
+static inline int reeact_policy_sem_getvalue(void *sem, int *sval)
+{
+	return reeact_active_policy->sem_getvalue(sem, sval);
+}
+
+/*
+ * affinity hooks of the user policy.
+ *
+ * Input parameters (see the pthread_setaffinity_np, sched_setaffinity and
+ * pthread_attr_setaffinity_np manuals for more info):
+ *     thread: the thread
+ *     pid: the thread id, 0 for the calling thread
+ *     attr: by default a "pthread_attr_t*" type
+ *     size, cpuset: the size of the cpu set, and a "cpu_set_t*"
+ * Return values:
+ *     same as corresponding functions or by user definition
+ */
+static inline int reeact_policy_pthread_setaffinity_np(pthread_t thread,
+						       size_t size,
+						       const void *cpuset)
+{
+	return reeact_active_policy->pthread_setaffinity_np(thread, size,
+							    cpuset);
+}
+
+static inline int reeact_policy_sched_setaffinity(int pid, size_t size,
+						  const void *cpuset)
+{
+	return reeact_active_policy->sched_setaffinity(pid, size, cpuset);
+}
+
+static inline int reeact_policy_pthread_attr_setaffinity_np(void *attr,
+							    size_t size,
+							    const void *cpuset)
+{
+	return reeact_active_policy->pthread_attr_setaffinity_np(attr, size,
+								 cpuset);
+}
 
 
 /*
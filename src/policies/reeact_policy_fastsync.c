@@ -0,0 +1,822 @@
+/*
+ * The fastsync policy: the pthread objects are replaced by the fastsync 
+ * primitives, which are kept in place inside the storage of the pthread 
+ * objects. Mutex types that fastsync does not support are passed to the 
+ * original pthread functions. The gomp barrier hooks are left to libgomp.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <linux/futex.h>
+
+#include "reeact_policy.h"
+#include "../utils/reeact_utils.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+#include "../fastsync/fastsync.h"
+#include "../events/reeact_events.h"
+#include "../threads/reeact_threads.h"
+#include "../threads/reeact_placement.h"
+#include "../threads/reeact_throttle.h"
+#include "reeact_rules.h"
+
+/*
+ * In-place layouts of the fastsync policy: the fastsync objects are kept
+ * inside the storage of the pthread objects, so that the hooks need no lookup
+ * or allocation. Zero-filled fastsync mutexes and conditional variables are 
+ * valid, so objects from PTHREAD_MUTEX_INITIALIZER and 
+ * PTHREAD_COND_INITIALIZER work without init. Barriers have no static 
+ * initializer.
+ */
+_Static_assert(sizeof(fastsync_mutex) <= sizeof(pthread_mutex_t),
+	       "fastsync mutex does not fit in pthread_mutex_t");
+_Static_assert(sizeof(fastsync_cond) <= sizeof(pthread_cond_t),
+	       "fastsync cond does not fit in pthread_cond_t");
+_Static_assert(sizeof(fastsync_barrier) <= sizeof(pthread_barrier_t),
+	       "fastsync barrier does not fit in pthread_barrier_t");
+_Static_assert(sizeof(fastsync_rwlock) <= sizeof(pthread_rwlock_t),
+	       "fastsync rwlock does not fit in pthread_rwlock_t");
+
+/*
+ * The cached rule decisions (see reeact_rules.h) follow the fastsync mutex 
+ * and barrier in the spare bytes of the pthread objects; for a mutex, it is 
+ * glibc's __owner, which normal mutexes do not use, so __kind is untouched.
+ * Objects shared by processes are not matched, and their decisions are not
+ * used.
+ */
+typedef struct _reeact_fastsync_mutex{
+	fastsync_mutex mutex;
+	int rule;
+}reeact_fastsync_mutex;
+
+typedef struct _reeact_fastsync_barrier{
+	fastsync_barrier barrier;
+	int rule;
+}reeact_fastsync_barrier;
+
+_Static_assert(offsetof(reeact_fastsync_mutex, rule) + sizeof(int) <=
+	       offsetof(pthread_mutex_t, __data.__kind),
+	       "mutex rule decision overlaps __kind");
+_Static_assert(sizeof(reeact_fastsync_barrier) <= sizeof(pthread_barrier_t),
+	       "barrier rule decision does not fit in pthread_barrier_t");
+
+/*
+ * The fastsync mutex only overlays the lock word and the count of glibc's 
+ * mutex. glibc keeps the type, robustness and protocol of a mutex in __kind,
+ * which fastsync leaves untouched; it is zero for normal mutexes, including 
+ * PTHREAD_MUTEX_INITIALIZER, and non-zero for recursive, error-checking, 
+ * adaptive, robust and priority mutexes (including their static initializers),
+ * which are passed to glibc.
+ */
+#define REEACT_MUTEX_KIND_MASK 0x7f
+#define reeact_mutex_is_fastsync(m)					\
+	((((pthread_mutex_t*)(m))->__data.__kind & REEACT_MUTEX_KIND_MASK) == 0)
+
+/*
+ * The single-threaded fast path (see reeact_single_threaded), for objects 
+ * that are not shared by processes: an uncontended mutex or rwlock is locked
+ * and unlocked with plain loads and stores, a conditional variable is 
+ * signaled without a wake-up unless a fiber is parked, and a barrier of one
+ * thread only moves its sequence count. Anything else, e.g., a mutex that is
+ * already locked, takes the normal path.
+ */
+#define reeact_fastsync_single_threaded(obj)				\
+	(reeact_single_threaded() && !(obj)->shared)
+
+/*
+ * Wait on a fastsync conditional variable with a mutex handled by glibc; 
+ * abstime is NULL for waiting forever.
+ */
+static int reeact_fastsync_cond_wait_foreign(fastsync_cond *cond, 
+					     pthread_mutex_t *mutex,
+					     const struct timespec *abstime)
+{
+	struct timespec realtime;
+	int seq, ret_val = 0, lock_ret;
+
+	if(abstime != NULL){
+		if(abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000)
+			return EINVAL;
+		if(cond->monotonic){
+			fastsync_monotonic_to_realtime(abstime, &realtime);
+			abstime = &realtime;
+		}
+	}
+
+	seq = (int)atomic_read(cond->seq);
+	ret_val = real_pthread_mutex_unlock(mutex);
+	if(ret_val)
+		return ret_val;
+
+	if(fastsync_futex_wait(&(cond->seq), seq, abstime,
+			       fastsync_futex_flags(cond->shared)) == -1 &&
+	   errno == ETIMEDOUT)
+		ret_val = ETIMEDOUT;
+
+	/* e.g., EOWNERDEAD of a robust mutex overrides the timeout */
+	lock_ret = real_pthread_mutex_lock(mutex);
+
+	return lock_ret ? lock_ret : ret_val;
+}
+
+/*
+ * how affinity requests of the application are treated
+ */
+static int reeact_fastsync_affinity = REEACT_AFFINITY_HONOR;
+
+/*
+ * policy initialization: read the per-object rules and the affinity mode
+ */
+static int reeact_fastsync_init(void *data)
+{
+	int ret_val = reeact_rules_load();
+
+	reeact_fastsync_affinity = reeact_threads_affinity_mode();
+
+	if(ret_val)
+		LOGERR("Some rules of %s are not used\n",
+		       getenv(REEACT_USER_RULES_CONFIG));
+
+	/* the policy works without the rules */
+	return 0;
+}
+
+/* 
+ * pthread_create hook 
+ */
+static int reeact_fastsync_pthread_create(void *thread, void *attr,
+					  void *(*start_routine) (void *),
+					  void *arg)
+{
+	return reeact_placement_pthread_create(reeact_fastsync_affinity,
+					       (pthread_t*)thread,
+					       (pthread_attr_t*)attr,
+					       start_routine, arg);
+}
+
+/* 
+ * pthread_barrier hooks 
+ */
+static int reeact_fastsync_pthread_barrier_init(void *barrier, void *attr, 
+						unsigned count)
+{
+	fastsync_barrier_attr fs_attr = {0, 0};
+	int pshared;
+
+	if(count == 0)
+		return EINVAL;
+
+	if(attr != NULL &&
+	   pthread_barrierattr_getpshared((pthread_barrierattr_t*)attr,
+					  &pshared) == 0)
+		fs_attr.shared = (pshared == PTHREAD_PROCESS_SHARED);
+
+	((reeact_fastsync_barrier*)barrier)->rule = REEACT_RULE_UNMATCHED;
+
+	return fastsync_barrier_init((fastsync_barrier*)barrier, &fs_attr, 
+				     count);
+}
+
+/*
+ * The waits and the acquisitions of the hooks are counted, and the calling
+ * thread may be parked, while the threads are throttled (see
+ * threads/reeact_throttle.h). The call site the rules match is taken by the
+ * hook itself, as the call of the helper is not always a tail call.
+ */
+static int reeact_fastsync_barrier_wait(void *barrier, void *site)
+{
+	fastsync_barrier *b = (fastsync_barrier*)barrier;
+	int spin;
+
+	if(reeact_fastsync_single_threaded(b) && b->total_count == 1 &&
+	   b->parent_bar == NULL){
+		b->seq++;
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+	}
+
+	spin = reeact_rules_spin(b->shared ? NULL :
+				 &(((reeact_fastsync_barrier*)barrier)->rule),
+				 REEACT_RULE_BARRIER, barrier, site);
+
+	REEACT_EVENTS_OBSERVE_BARRIER(barrier, 
+				      fastsync_barrier_wait_spin(b, spin));
+	return fastsync_barrier_wait_spin(b, spin);
+}
+
+static int reeact_fastsync_pthread_barrier_wait(void *barrier)
+{
+	void *site = __builtin_return_address(0);
+
+	REEACT_THROTTLE_WAIT(REEACT_THROTTLE_BARRIER,
+			     reeact_fastsync_barrier_wait(barrier, site));
+	return reeact_fastsync_barrier_wait(barrier, site);
+}
+
+static int reeact_fastsync_pthread_barrier_destroy(void *barrier)
+{
+	return fastsync_barrier_destroy((fastsync_barrier*)barrier);
+}
+
+/*
+ * pthread_mutex hooks
+ */
+
+static int reeact_fastsync_pthread_mutex_init(void *mutex, void *attr)
+{
+	fastsync_mutex_attr fs_attr = {NULL, 0};
+	int type, protocol, robust, pshared;
+
+	if(attr != NULL){
+		if(pthread_mutexattr_gettype((pthread_mutexattr_t*)attr, 
+					     &type) ||
+		   pthread_mutexattr_getprotocol((pthread_mutexattr_t*)attr,
+						 &protocol) ||
+		   pthread_mutexattr_getrobust((pthread_mutexattr_t*)attr,
+					       &robust) ||
+		   pthread_mutexattr_getpshared((pthread_mutexattr_t*)attr,
+						&pshared))
+			return EINVAL;
+		/* only normal mutexes are handled by fastsync */
+		if(type != PTHREAD_MUTEX_NORMAL || 
+		   protocol != PTHREAD_PRIO_NONE ||
+		   robust != PTHREAD_MUTEX_STALLED)
+			return real_pthread_mutex_init(
+				(pthread_mutex_t*)mutex, 
+				(pthread_mutexattr_t*)attr);
+		fs_attr.shared = (pshared == PTHREAD_PROCESS_SHARED);
+	}
+
+	/* also clears __kind, which may be left by a previous type */
+	memset(mutex, 0, sizeof(pthread_mutex_t));
+
+	return fastsync_mutex_init((fastsync_mutex*)mutex, &fs_attr);
+}
+
+static int reeact_fastsync_mutex_lock(void *mutex, void *site)
+{
+	fastsync_mutex *m = (fastsync_mutex*)mutex;
+	int spin;
+
+	if(reeact_mutex_is_fastsync(mutex)){
+		if(reeact_fastsync_single_threaded(m) && m->state == 0){
+			m->state = 1;
+			return 0;
+		}
+		spin = reeact_rules_spin(m->shared ? NULL :
+			&(((reeact_fastsync_mutex*)mutex)->rule),
+			REEACT_RULE_MUTEX, mutex, site);
+		REEACT_EVENTS_OBSERVE_LOCK(mutex, fastsync_mutex_trylock(m),
+					   fastsync_mutex_lock_spin(m, spin));
+		return fastsync_mutex_lock_spin(m, spin);
+	}
+
+	REEACT_EVENTS_OBSERVE_LOCK(mutex, 
+		real_pthread_mutex_trylock((pthread_mutex_t*)mutex),
+		real_pthread_mutex_lock((pthread_mutex_t*)mutex));
+	return real_pthread_mutex_lock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_fastsync_pthread_mutex_lock(void *mutex)
+{
+	void *site = __builtin_return_address(0);
+
+	REEACT_THROTTLE_LOCK(1, reeact_fastsync_mutex_lock(mutex, site));
+	return reeact_fastsync_mutex_lock(mutex, site);
+}
+
+static int reeact_fastsync_mutex_trylock(void *mutex)
+{
+	fastsync_mutex *m = (fastsync_mutex*)mutex;
+
+	if(reeact_mutex_is_fastsync(mutex)){
+		if(reeact_fastsync_single_threaded(m) && m->state == 0){
+			m->state = 1;
+			return 0;
+		}
+		return fastsync_mutex_trylock(m);
+	}
+
+	return real_pthread_mutex_trylock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_fastsync_pthread_mutex_trylock(void *mutex)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_mutex_trylock(mutex));
+	return reeact_fastsync_mutex_trylock(mutex);
+}
+
+static int reeact_fastsync_mutex_timedlock(void *mutex, void *abs_timeout)
+{
+	fastsync_mutex *m = (fastsync_mutex*)mutex;
+
+	if(reeact_mutex_is_fastsync(mutex)){
+		if(reeact_fastsync_single_threaded(m) && m->state == 0){
+			m->state = 1;
+			return 0;
+		}
+		return fastsync_mutex_timedlock(m, 
+						(struct timespec*)abs_timeout);
+	}
+
+	return real_pthread_mutex_timedlock((pthread_mutex_t*)mutex,
+					    (struct timespec*)abs_timeout);
+}
+
+static int reeact_fastsync_pthread_mutex_timedlock(void *mutex,
+						   void *abs_timeout)
+{
+	/* parking could outlast the timeout of a free mutex */
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_mutex_timedlock(mutex,
+								abs_timeout));
+	return reeact_fastsync_mutex_timedlock(mutex, abs_timeout);
+}
+
+static int reeact_fastsync_mutex_unlock(void *mutex)
+{
+	fastsync_mutex *m = (fastsync_mutex*)mutex;
+
+	if(reeact_mutex_is_fastsync(mutex)){
+		if(reeact_fastsync_single_threaded(m) && m->state == 1){
+			m->state = 0;
+			return 0;
+		}
+		return fastsync_mutex_unlock(m);
+	}
+
+	return real_pthread_mutex_unlock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_fastsync_pthread_mutex_unlock(void *mutex)
+{
+	REEACT_THROTTLE_UNLOCK(reeact_fastsync_mutex_unlock(mutex));
+	return reeact_fastsync_mutex_unlock(mutex);
+}
+
+static int reeact_fastsync_pthread_mutex_consistent(void *mutex)
+{
+	/* fastsync mutexes are never robust */
+	if(reeact_mutex_is_fastsync(mutex))
+		return EINVAL;
+
+	return real_pthread_mutex_consistent((pthread_mutex_t*)mutex);
+}
+
+static int reeact_fastsync_pthread_mutex_destroy(void *mutex)
+{
+	if(reeact_mutex_is_fastsync(mutex))
+		return (((fastsync_mutex*)mutex)->state & 1) ? EBUSY : 0;
+
+	return real_pthread_mutex_destroy((pthread_mutex_t*)mutex);
+}
+
+static int reeact_fastsync_pthread_cond_init(void *cond, void *attr)
+{
+	fastsync_cond_attr fs_attr = {0, 0, 0};
+	clockid_t clock;
+	int pshared;
+
+	if(attr != NULL){
+		if(pthread_condattr_getpshared((pthread_condattr_t*)attr,
+					       &pshared) ||
+		   pthread_condattr_getclock((pthread_condattr_t*)attr, 
+					     &clock))
+			return EINVAL;
+		fs_attr.shared = (pshared == PTHREAD_PROCESS_SHARED);
+		fs_attr.monotonic = (clock == CLOCK_MONOTONIC);
+	}
+
+	memset(cond, 0, sizeof(pthread_cond_t));
+
+	return fastsync_cond_init((fastsync_cond*)cond, &fs_attr);
+}
+
+static int reeact_fastsync_pthread_cond_signal(void *cond)
+{
+	fastsync_cond *c = (fastsync_cond*)cond;
+
+	if(reeact_fastsync_single_threaded(c) && !fastsync_fiber_parked_cnt()){
+		c->seq++;
+		fastsync_evfd_notify(&(c->evfd));
+		return 0;
+	}
+
+	return fastsync_cond_signal(c);
+}
+
+static int reeact_fastsync_pthread_cond_broadcast(void *cond)
+{
+	fastsync_cond *c = (fastsync_cond*)cond;
+
+	if(reeact_fastsync_single_threaded(c) && !fastsync_fiber_parked_cnt()){
+		c->seq++;
+		fastsync_evfd_notify(&(c->evfd));
+		return 0;
+	}
+
+	return fastsync_cond_broadcast(c);
+}
+
+static int reeact_fastsync_pthread_cond_destroy(void *cond)
+{
+	return fastsync_cond_destroy((fastsync_cond*)cond);
+}
+
+static int reeact_fastsync_cond_wait(void *cond, void *mutex)
+{
+	fastsync_cond *c = (fastsync_cond*)cond;
+
+	if(!reeact_mutex_is_fastsync(mutex)){
+		REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+			reeact_fastsync_cond_wait_foreign(
+				c, (pthread_mutex_t*)mutex, NULL));
+		return reeact_fastsync_cond_wait_foreign(
+			c, (pthread_mutex_t*)mutex, NULL);
+	}
+
+	REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+		fastsync_cond_wait(c, (fastsync_mutex*)mutex));
+	return fastsync_cond_wait(c, (fastsync_mutex*)mutex);
+}
+
+static int reeact_fastsync_pthread_cond_wait(void *cond, void *mutex)
+{
+	REEACT_THROTTLE_WAIT(REEACT_THROTTLE_COND,
+			     reeact_fastsync_cond_wait(cond, mutex));
+	return reeact_fastsync_cond_wait(cond, mutex);
+}
+
+static int reeact_fastsync_cond_timedwait(void *cond, void *mutex,
+					  void *abstime)
+{
+	fastsync_cond *c = (fastsync_cond*)cond;
+	struct timespec *ts = (struct timespec*)abstime;
+
+	if(!reeact_mutex_is_fastsync(mutex)){
+		REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+			reeact_fastsync_cond_wait_foreign(
+				c, (pthread_mutex_t*)mutex, ts));
+		return reeact_fastsync_cond_wait_foreign(
+			c, (pthread_mutex_t*)mutex, ts);
+	}
+
+	REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+		fastsync_cond_timedwait(c, (fastsync_mutex*)mutex, ts));
+	return fastsync_cond_timedwait(c, (fastsync_mutex*)mutex, ts);
+}
+
+static int reeact_fastsync_pthread_cond_timedwait(void *cond, void *mutex,
+						  void *abstime)
+{
+	REEACT_THROTTLE_WAIT(REEACT_THROTTLE_COND,
+			     reeact_fastsync_cond_timedwait(cond, mutex,
+							    abstime));
+	return reeact_fastsync_cond_timedwait(cond, mutex, abstime);
+}
+
+/*
+ * pthread_rwlock hooks; the fastsync policy uses the fastsync rwlock, which
+ * fits in a pthread_rwlock_t, with per-node reader indicators; process-shared
+ * locks keep all their state in the pthread_rwlock_t
+ */
+static int reeact_fastsync_pthread_rwlock_init(void *rwlock, void *attr)
+{
+	fastsync_rwlock_attr fs_attr = {0, 0};
+	int pshared;
+
+	if(attr != NULL &&
+	   pthread_rwlockattr_getpshared((pthread_rwlockattr_t*)attr, 
+					 &pshared) == 0)
+		fs_attr.shared = (pshared == PTHREAD_PROCESS_SHARED);
+
+	return fastsync_rwlock_init((fastsync_rwlock*)rwlock, &fs_attr);
+}
+
+static int reeact_fastsync_pthread_rwlock_destroy(void *rwlock)
+{
+	return fastsync_rwlock_destroy((fastsync_rwlock*)rwlock);
+}
+
+static int reeact_fastsync_rwlock_rdlock(void *rwlock)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_rdlock_single(rw) == 0)
+		return 0;
+	REEACT_EVENTS_OBSERVE_LOCK(rwlock, fastsync_rwlock_tryrdlock(rw),
+				   fastsync_rwlock_rdlock(rw));
+	return fastsync_rwlock_rdlock(rw);
+}
+
+static int reeact_fastsync_pthread_rwlock_rdlock(void *rwlock)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_rdlock(rwlock));
+	return reeact_fastsync_rwlock_rdlock(rwlock);
+}
+
+static int reeact_fastsync_rwlock_tryrdlock(void *rwlock)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_rdlock_single(rw) == 0)
+		return 0;
+	return fastsync_rwlock_tryrdlock(rw);
+}
+
+static int reeact_fastsync_pthread_rwlock_tryrdlock(void *rwlock)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_tryrdlock(rwlock));
+	return reeact_fastsync_rwlock_tryrdlock(rwlock);
+}
+
+static int reeact_fastsync_rwlock_timedrdlock(void *rwlock, void *abstime)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_rdlock_single(rw) == 0)
+		return 0;
+	return fastsync_rwlock_timedrdlock(rw, (struct timespec*)abstime);
+}
+
+static int reeact_fastsync_pthread_rwlock_timedrdlock(void *rwlock,
+						      void *abstime)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_timedrdlock(rwlock,
+								   abstime));
+	return reeact_fastsync_rwlock_timedrdlock(rwlock, abstime);
+}
+
+static int reeact_fastsync_rwlock_wrlock(void *rwlock)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_wrlock_single(rw) == 0)
+		return 0;
+	REEACT_EVENTS_OBSERVE_LOCK(rwlock, fastsync_rwlock_trywrlock(rw),
+				   fastsync_rwlock_wrlock(rw));
+	return fastsync_rwlock_wrlock(rw);
+}
+
+static int reeact_fastsync_pthread_rwlock_wrlock(void *rwlock)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_wrlock(rwlock));
+	return reeact_fastsync_rwlock_wrlock(rwlock);
+}
+
+static int reeact_fastsync_rwlock_trywrlock(void *rwlock)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_wrlock_single(rw) == 0)
+		return 0;
+	return fastsync_rwlock_trywrlock(rw);
+}
+
+static int reeact_fastsync_pthread_rwlock_trywrlock(void *rwlock)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_trywrlock(rwlock));
+	return reeact_fastsync_rwlock_trywrlock(rwlock);
+}
+
+static int reeact_fastsync_rwlock_timedwrlock(void *rwlock, void *abstime)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_wrlock_single(rw) == 0)
+		return 0;
+	return fastsync_rwlock_timedwrlock(rw, (struct timespec*)abstime);
+}
+
+static int reeact_fastsync_pthread_rwlock_timedwrlock(void *rwlock,
+						      void *abstime)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_rwlock_timedwrlock(rwlock,
+								   abstime));
+	return reeact_fastsync_rwlock_timedwrlock(rwlock, abstime);
+}
+
+static int reeact_fastsync_rwlock_unlock(void *rwlock)
+{
+	fastsync_rwlock *rw = (fastsync_rwlock*)rwlock;
+
+	if(reeact_fastsync_single_threaded(rw) &&
+	   fastsync_rwlock_unlock_single(rw) == 0)
+		return 0;
+	return fastsync_rwlock_unlock(rw);
+}
+
+static int reeact_fastsync_pthread_rwlock_unlock(void *rwlock)
+{
+	REEACT_THROTTLE_UNLOCK(reeact_fastsync_rwlock_unlock(rwlock));
+	return reeact_fastsync_rwlock_unlock(rwlock);
+}
+
+/*
+ * pthread_spin hooks; the fastsync policy uses the fastsync spinlock with
+ * topology-aware backoff, which has the same size as a pthread_spinlock_t
+ */
+static int reeact_fastsync_pthread_spin_init(void *lock, int pshared)
+{
+	return fastsync_spin_init((fastsync_spinlock*)lock, pshared);
+}
+
+static int reeact_fastsync_pthread_spin_destroy(void *lock)
+{
+	return fastsync_spin_destroy((fastsync_spinlock*)lock);
+}
+
+static int reeact_fastsync_spin_lock(void *lock)
+{
+	REEACT_EVENTS_OBSERVE_LOCK(lock, 
+		fastsync_spin_trylock((fastsync_spinlock*)lock),
+		fastsync_spin_lock((fastsync_spinlock*)lock));
+	return fastsync_spin_lock((fastsync_spinlock*)lock);
+}
+
+/*
+ * A thread holding a spinlock is not parked while the threads are
+ * throttled, as the others would spin until it is released.
+ */
+static int reeact_fastsync_pthread_spin_lock(void *lock)
+{
+	REEACT_THROTTLE_LOCK(0, reeact_fastsync_spin_lock(lock));
+	return reeact_fastsync_spin_lock(lock);
+}
+
+static int reeact_fastsync_pthread_spin_trylock(void *lock)
+{
+	REEACT_THROTTLE_LOCK(0, fastsync_spin_trylock(
+				     (fastsync_spinlock*)lock));
+	return fastsync_spin_trylock((fastsync_spinlock*)lock);
+}
+
+static int reeact_fastsync_pthread_spin_unlock(void *lock)
+{
+	REEACT_THROTTLE_UNLOCK(fastsync_spin_unlock((fastsync_spinlock*)lock));
+	return fastsync_spin_unlock((fastsync_spinlock*)lock);
+}
+
+/*
+ * semaphore hooks; the fastsync policy uses the fastsync semaphore, which
+ * has the same layout as glibc's semaphore. fastsync returns error numbers,
+ * which are converted to the -1/errno convention of the sem functions.
+ */
+#define REEACT_SEM_RETURN(ret_val)			\
+	do{						\
+		if((ret_val) == 0)			\
+			return 0;			\
+		errno = ((ret_val) == 1) ? EINVAL : (ret_val);	\
+		return -1;				\
+	} while(0)
+
+static int reeact_fastsync_sem_init(void *sem, int pshared, unsigned int value)
+{
+	int ret_val = fastsync_sem_init((fastsync_sem*)sem, pshared, value);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+static int reeact_fastsync_sem_destroy(void *sem)
+{
+	int ret_val = fastsync_sem_destroy((fastsync_sem*)sem);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+/*
+ * wait on a semaphore, abstime is NULL for waiting forever
+ */
+static int reeact_fastsync_sem_block(void *sem, void *abstime)
+{
+	int ret_val;
+
+	if(abstime == NULL)
+		ret_val = fastsync_sem_wait((fastsync_sem*)sem);
+	else
+		ret_val = fastsync_sem_timedwait((fastsync_sem*)sem,
+						 (struct timespec*)abstime);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+static int reeact_fastsync_sem_wait(void *sem)
+{
+	REEACT_THROTTLE_WAIT(REEACT_THROTTLE_SEM,
+			     reeact_fastsync_sem_block(sem, NULL));
+	return reeact_fastsync_sem_block(sem, NULL);
+}
+
+static int reeact_fastsync_sem_trywait(void *sem)
+{
+	int ret_val = fastsync_sem_trywait((fastsync_sem*)sem);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+static int reeact_fastsync_sem_timedwait(void *sem, void *abstime)
+{
+	REEACT_THROTTLE_WAIT(REEACT_THROTTLE_SEM,
+			     reeact_fastsync_sem_block(sem, abstime));
+	return reeact_fastsync_sem_block(sem, abstime);
+}
+
+static int reeact_fastsync_sem_post(void *sem)
+{
+	int ret_val = fastsync_sem_post((fastsync_sem*)sem);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+static int reeact_fastsync_sem_getvalue(void *sem, int *sval)
+{
+	int ret_val = fastsync_sem_getvalue((fastsync_sem*)sem, sval);
+	REEACT_SEM_RETURN(ret_val);
+}
+
+/*
+ * affinity hooks: requests are treated as REEACT_AFFINITY says (see
+ * threads/reeact_threads.h); the affinity of an attribute is used when the
+ * thread is created, and recorded as the thread's request when it starts
+ */
+static int reeact_fastsync_pthread_setaffinity_np(pthread_t thread,
+						  size_t size,
+						  const void *cpuset)
+{
+	return reeact_threads_pthread_setaffinity_np(reeact_fastsync_affinity,
+						     thread, size,
+						     (const cpu_set_t*)cpuset);
+}
+
+static int reeact_fastsync_sched_setaffinity(int pid, size_t size,
+					     const void *cpuset)
+{
+	return reeact_threads_sched_setaffinity(reeact_fastsync_affinity, pid,
+						size, (const cpu_set_t*)cpuset);
+}
+
+static int reeact_fastsync_pthread_attr_setaffinity_np(void *attr,
+						       size_t size,
+						       const void *cpuset)
+{
+	return real_pthread_attr_setaffinity_np((pthread_attr_t*)attr, size,
+						(const cpu_set_t*)cpuset);
+}
+
+/*
+ * the fastsync policy
+ */
+const struct reeact_policy_ops reeact_policy_fastsync = {
+	.abi_version = REEACT_POLICY_ABI_VERSION,
+	.name = "fastsync",
+	.init = reeact_fastsync_init,
+	.cleanup = NULL,
+	.pthread_create = reeact_fastsync_pthread_create,
+	.pthread_barrier_init = reeact_fastsync_pthread_barrier_init,
+	.pthread_barrier_wait = reeact_fastsync_pthread_barrier_wait,
+	.pthread_barrier_destroy = reeact_fastsync_pthread_barrier_destroy,
+	.pthread_mutex_init = reeact_fastsync_pthread_mutex_init,
+	.pthread_mutex_lock = reeact_fastsync_pthread_mutex_lock,
+	.pthread_mutex_trylock = reeact_fastsync_pthread_mutex_trylock,
+	.pthread_mutex_timedlock = reeact_fastsync_pthread_mutex_timedlock,
+	.pthread_mutex_unlock = reeact_fastsync_pthread_mutex_unlock,
+	.pthread_mutex_consistent = reeact_fastsync_pthread_mutex_consistent,
+	.pthread_mutex_destroy = reeact_fastsync_pthread_mutex_destroy,
+	.pthread_cond_init = reeact_fastsync_pthread_cond_init,
+	.pthread_cond_signal = reeact_fastsync_pthread_cond_signal,
+	.pthread_cond_broadcast = reeact_fastsync_pthread_cond_broadcast,
+	.pthread_cond_destroy = reeact_fastsync_pthread_cond_destroy,
+	.pthread_cond_wait = reeact_fastsync_pthread_cond_wait,
+	.pthread_cond_timedwait = reeact_fastsync_pthread_cond_timedwait,
+	.pthread_rwlock_init = reeact_fastsync_pthread_rwlock_init,
+	.pthread_rwlock_destroy = reeact_fastsync_pthread_rwlock_destroy,
+	.pthread_rwlock_rdlock = reeact_fastsync_pthread_rwlock_rdlock,
+	.pthread_rwlock_tryrdlock = reeact_fastsync_pthread_rwlock_tryrdlock,
+	.pthread_rwlock_timedrdlock = reeact_fastsync_pthread_rwlock_timedrdlock,
+	.pthread_rwlock_wrlock = reeact_fastsync_pthread_rwlock_wrlock,
+	.pthread_rwlock_trywrlock = reeact_fastsync_pthread_rwlock_trywrlock,
+	.pthread_rwlock_timedwrlock = reeact_fastsync_pthread_rwlock_timedwrlock,
+	.pthread_rwlock_unlock = reeact_fastsync_pthread_rwlock_unlock,
+	.pthread_spin_init = reeact_fastsync_pthread_spin_init,
+	.pthread_spin_destroy = reeact_fastsync_pthread_spin_destroy,
+	.pthread_spin_lock = reeact_fastsync_pthread_spin_lock,
+	.pthread_spin_trylock = reeact_fastsync_pthread_spin_trylock,
+	.pthread_spin_unlock = reeact_fastsync_pthread_spin_unlock,
+	.sem_init = reeact_fastsync_sem_init,
+	.sem_destroy = reeact_fastsync_sem_destroy,
+	.sem_wait = reeact_fastsync_sem_wait,
+	.sem_trywait = reeact_fastsync_sem_trywait,
+	.sem_timedwait = reeact_fastsync_sem_timedwait,
+	.sem_post = reeact_fastsync_sem_post,
+	.sem_getvalue = reeact_fastsync_sem_getvalue,
+	.pthread_setaffinity_np = reeact_fastsync_pthread_setaffinity_np,
+	.sched_setaffinity = reeact_fastsync_sched_setaffinity,
+	.pthread_attr_setaffinity_np =
+		reeact_fastsync_pthread_attr_setaffinity_np,
+};
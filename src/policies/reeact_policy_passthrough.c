@@ -0,0 +1,477 @@
+/*
+ * The passthrough policy: every hook calls the original pthread function, and
+ * the gomp barrier hooks let libgomp use its own barriers.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "reeact_policy.h"
+#include "../utils/reeact_utils.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+#include "../events/reeact_events.h"
+#include "../threads/reeact_threads.h"
+#include "../threads/reeact_placement.h"
+
+/* 
+ * pthread_create hook 
+ */
+static int reeact_passthrough_pthread_create(void *thread, void *attr,
+					     void *(*start_routine) (void *),
+					     void *arg)
+{
+	return reeact_placement_pthread_create(REEACT_AFFINITY_HONOR,
+					       (pthread_t*)thread,
+					       (pthread_attr_t*)attr,
+					       start_routine, arg);
+}
+
+/* 
+ * pthread_barrier hooks 
+ */
+static int reeact_passthrough_pthread_barrier_init(void *barrier, void *attr, 
+						   unsigned count)
+{
+	return real_pthread_barrier_init((pthread_barrier_t*)barrier,
+					 (pthread_barrierattr_t*)attr,
+					 count);
+}
+
+static int reeact_passthrough_pthread_barrier_wait(void *barrier)
+{
+	REEACT_EVENTS_OBSERVE_BARRIER(barrier, 
+		real_pthread_barrier_wait((pthread_barrier_t*)barrier));
+	return real_pthread_barrier_wait((pthread_barrier_t*)barrier);
+}
+
+static int reeact_passthrough_pthread_barrier_destroy(void *barrier)
+{
+	return real_pthread_barrier_destroy((pthread_barrier_t*)barrier);
+}
+
+/*
+ * pthread_mutex hooks
+ */
+
+static int reeact_passthrough_pthread_mutex_init(void *mutex, void *attr)
+{
+	return real_pthread_mutex_init((pthread_mutex_t*)mutex,
+				       (pthread_mutexattr_t*)attr);
+}
+
+static int reeact_passthrough_pthread_mutex_lock(void *mutex)
+{
+	REEACT_EVENTS_OBSERVE_LOCK(mutex,
+		real_pthread_mutex_trylock((pthread_mutex_t*)mutex),
+		real_pthread_mutex_lock((pthread_mutex_t*)mutex));
+	return real_pthread_mutex_lock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_mutex_trylock(void *mutex)
+{
+	return real_pthread_mutex_trylock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_mutex_timedlock(void *mutex,
+						      void *abs_timeout)
+{
+	return real_pthread_mutex_timedlock((pthread_mutex_t*)mutex,
+					    (struct timespec*)abs_timeout);
+}
+
+static int reeact_passthrough_pthread_mutex_unlock(void *mutex)
+{
+	return real_pthread_mutex_unlock((pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_mutex_consistent(void *mutex)
+{
+	return real_pthread_mutex_consistent((pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_mutex_destroy(void *mutex)
+{
+	return real_pthread_mutex_destroy((pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_cond_init(void *cond, void *attr)
+{
+	return real_pthread_cond_init((pthread_cond_t*)cond, 
+				      (pthread_condattr_t*)attr);
+}
+
+static int reeact_passthrough_pthread_cond_signal(void *cond)
+{
+	return real_pthread_cond_signal((pthread_cond_t*)cond);
+}
+
+static int reeact_passthrough_pthread_cond_broadcast(void *cond)
+{
+	return real_pthread_cond_broadcast((pthread_cond_t*)cond);
+}
+
+static int reeact_passthrough_pthread_cond_destroy(void *cond)
+{
+	return real_pthread_cond_destroy((pthread_cond_t*)cond);
+}
+
+static int reeact_passthrough_pthread_cond_wait(void *cond, void *mutex)
+{
+	REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+		real_pthread_cond_wait((pthread_cond_t*)cond,
+				       (pthread_mutex_t*)mutex));
+	return real_pthread_cond_wait((pthread_cond_t*)cond,
+				      (pthread_mutex_t*)mutex);
+}
+
+static int reeact_passthrough_pthread_cond_timedwait(void *cond, void *mutex,
+						     void *abstime)
+{
+	REEACT_EVENTS_OBSERVE_WAIT(REEACT_EVENT_COND_WAKEUP, cond,
+		real_pthread_cond_timedwait((pthread_cond_t*)cond,
+					    (pthread_mutex_t*)mutex,
+					    (struct timespec*)abstime));
+	return real_pthread_cond_timedwait((pthread_cond_t*)cond,
+					   (pthread_mutex_t*)mutex,
+					   (struct timespec*)abstime);
+}
+
+/*
+ * pthread_rwlock hooks
+ */
+static int reeact_passthrough_pthread_rwlock_init(void *rwlock, void *attr)
+{
+	return real_pthread_rwlock_init((pthread_rwlock_t*)rwlock,
+					(pthread_rwlockattr_t*)attr);
+}
+
+static int reeact_passthrough_pthread_rwlock_destroy(void *rwlock)
+{
+	return real_pthread_rwlock_destroy((pthread_rwlock_t*)rwlock);
+}
+
+static int reeact_passthrough_pthread_rwlock_rdlock(void *rwlock)
+{
+	REEACT_EVENTS_OBSERVE_LOCK(rwlock,
+		real_pthread_rwlock_tryrdlock((pthread_rwlock_t*)rwlock),
+		real_pthread_rwlock_rdlock((pthread_rwlock_t*)rwlock));
+	return real_pthread_rwlock_rdlock((pthread_rwlock_t*)rwlock);
+}
+
+static int reeact_passthrough_pthread_rwlock_tryrdlock(void *rwlock)
+{
+	return real_pthread_rwlock_tryrdlock((pthread_rwlock_t*)rwlock);
+}
+
+static int reeact_passthrough_pthread_rwlock_timedrdlock(void *rwlock,
+							 void *abstime)
+{
+	return real_pthread_rwlock_timedrdlock((pthread_rwlock_t*)rwlock,
+					       (struct timespec*)abstime);
+}
+
+static int reeact_passthrough_pthread_rwlock_wrlock(void *rwlock)
+{
+	REEACT_EVENTS_OBSERVE_LOCK(rwlock,
+		real_pthread_rwlock_trywrlock((pthread_rwlock_t*)rwlock),
+		real_pthread_rwlock_wrlock((pthread_rwlock_t*)rwlock));
+	return real_pthread_rwlock_wrlock((pthread_rwlock_t*)rwlock);
+}
+
+static int reeact_passthrough_pthread_rwlock_trywrlock(void *rwlock)
+{
+	return real_pthread_rwlock_trywrlock((pthread_rwlock_t*)rwlock);
+}
+
+static int reeact_passthrough_pthread_rwlock_timedwrlock(void *rwlock,
+							 void *abstime)
+{
+	return real_pthread_rwlock_timedwrlock((pthread_rwlock_t*)rwlock,
+					       (struct timespec*)abstime);
+}
+
+static int reeact_passthrough_pthread_rwlock_unlock(void *rwlock)
+{
+	return real_pthread_rwlock_unlock((pthread_rwlock_t*)rwlock);
+}
+
+/*
+ * pthread_spin hooks
+ */
+static int reeact_passthrough_pthread_spin_init(void *lock, int pshared)
+{
+	return real_pthread_spin_init((pthread_spinlock_t*)lock, pshared);
+}
+
+static int reeact_passthrough_pthread_spin_destroy(void *lock)
+{
+	return real_pthread_spin_destroy((pthread_spinlock_t*)lock);
+}
+
+static int reeact_passthrough_pthread_spin_lock(void *lock)
+{
+	REEACT_EVENTS_OBSERVE_LOCK(lock,
+		real_pthread_spin_trylock((pthread_spinlock_t*)lock),
+		real_pthread_spin_lock((pthread_spinlock_t*)lock));
+	return real_pthread_spin_lock((pthread_spinlock_t*)lock);
+}
+
+static int reeact_passthrough_pthread_spin_trylock(void *lock)
+{
+	return real_pthread_spin_trylock((pthread_spinlock_t*)lock);
+}
+
+static int reeact_passthrough_pthread_spin_unlock(void *lock)
+{
+	return real_pthread_spin_unlock((pthread_spinlock_t*)lock);
+}
+
+/*
+ * semaphore hooks
+ */
+static int reeact_passthrough_sem_init(void *sem, int pshared,
+				       unsigned int value)
+{
+	return real_sem_init((sem_t*)sem, pshared, value);
+}
+
+static int reeact_passthrough_sem_destroy(void *sem)
+{
+	return real_sem_destroy((sem_t*)sem);
+}
+
+static int reeact_passthrough_sem_wait(void *sem)
+{
+	return real_sem_wait((sem_t*)sem);
+}
+
+static int reeact_passthrough_sem_trywait(void *sem)
+{
+	return real_sem_trywait((sem_t*)sem);
+}
+
+static int reeact_passthrough_sem_timedwait(void *sem, void *abstime)
+{
+	return real_sem_timedwait((sem_t*)sem, (struct timespec*)abstime);
+}
+
+static int reeact_passthrough_sem_post(void *sem)
+{
+	return real_sem_post((sem_t*)sem);
+}
+
+static int reeact_passthrough_sem_getvalue(void *sem, int *sval)
+{
+	return real_sem_getvalue((sem_t*)sem, sval);
+}
+
+static int reeact_passthrough_gomp_barrier_init(void *bar, unsigned count)
+{
+	DPRINTF("%s called with bar %p, count %u\n", __FUNCTION__, bar, count);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_reinit(void *bar, unsigned count)
+{
+	DPRINTF("%s called with bar %p, count %u\n", __FUNCTION__, bar, count);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_destroy(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_wait(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_wait_last(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_wait_end(void *bar,
+						    unsigned int state)
+{
+	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
+		state);	
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_wait(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_wait_end(void *bar,
+							 unsigned int state)
+{
+	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
+		state);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_wake(void *bar, int count)
+{
+	DPRINTF("%s called with bar %p and count %d\n", __FUNCTION__, bar, count);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_set_task_pending(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_clear_task_pending(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_set_waiting_for_tasks(void *bar)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_done(void *bar,
+						     unsigned int state)
+{
+	DPRINTF("%s called with bar %p and state %d\n", __FUNCTION__, bar, 
+		state);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_team_barrier_waiting_for_tasks(void *bar,
+								  int *ret_val)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_last_thread(unsigned int state,
+						       int *ret_val)
+{
+	DPRINTF("%s called with state %d\n", __FUNCTION__, state);
+	return 1;
+}
+
+static int reeact_passthrough_gomp_barrier_wait_start(void *bar,
+						      unsigned int *ret_val)
+{
+	DPRINTF("%s called with bar %p\n", __FUNCTION__, bar);
+	return 1;
+}
+
+/*
+ * affinity hooks: requests are honored, and the thread records are kept up
+ * to date; the affinity of an attribute is used when the thread is created,
+ * and recorded as the thread's request when it starts
+ */
+static int reeact_passthrough_pthread_setaffinity_np(pthread_t thread,
+						     size_t size,
+						     const void *cpuset)
+{
+	return reeact_threads_pthread_setaffinity_np(REEACT_AFFINITY_HONOR,
+						     thread, size,
+						     (const cpu_set_t*)cpuset);
+}
+
+static int reeact_passthrough_sched_setaffinity(int pid, size_t size,
+						const void *cpuset)
+{
+	return reeact_threads_sched_setaffinity(REEACT_AFFINITY_HONOR, pid,
+						size, (const cpu_set_t*)cpuset);
+}
+
+static int reeact_passthrough_pthread_attr_setaffinity_np(void *attr,
+							  size_t size,
+							  const void *cpuset)
+{
+	return real_pthread_attr_setaffinity_np((pthread_attr_t*)attr, size,
+						(const cpu_set_t*)cpuset);
+}
+
+/*
+ * the passthrough policy
+ */
+const struct reeact_policy_ops reeact_policy_passthrough = {
+	.abi_version = REEACT_POLICY_ABI_VERSION,
+	.name = "passthrough",
+	.init = NULL,
+	.cleanup = NULL,
+	.pthread_create = reeact_passthrough_pthread_create,
+	.pthread_barrier_init = reeact_passthrough_pthread_barrier_init,
+	.pthread_barrier_wait = reeact_passthrough_pthread_barrier_wait,
+	.pthread_barrier_destroy = reeact_passthrough_pthread_barrier_destroy,
+	.pthread_mutex_init = reeact_passthrough_pthread_mutex_init,
+	.pthread_mutex_lock = reeact_passthrough_pthread_mutex_lock,
+	.pthread_mutex_trylock = reeact_passthrough_pthread_mutex_trylock,
+	.pthread_mutex_timedlock = reeact_passthrough_pthread_mutex_timedlock,
+	.pthread_mutex_unlock = reeact_passthrough_pthread_mutex_unlock,
+	.pthread_mutex_consistent = reeact_passthrough_pthread_mutex_consistent,
+	.pthread_mutex_destroy = reeact_passthrough_pthread_mutex_destroy,
+	.pthread_cond_init = reeact_passthrough_pthread_cond_init,
+	.pthread_cond_signal = reeact_passthrough_pthread_cond_signal,
+	.pthread_cond_broadcast = reeact_passthrough_pthread_cond_broadcast,
+	.pthread_cond_destroy = reeact_passthrough_pthread_cond_destroy,
+	.pthread_cond_wait = reeact_passthrough_pthread_cond_wait,
+	.pthread_cond_timedwait = reeact_passthrough_pthread_cond_timedwait,
+	.pthread_rwlock_init = reeact_passthrough_pthread_rwlock_init,
+	.pthread_rwlock_destroy = reeact_passthrough_pthread_rwlock_destroy,
+	.pthread_rwlock_rdlock = reeact_passthrough_pthread_rwlock_rdlock,
+	.pthread_rwlock_tryrdlock = reeact_passthrough_pthread_rwlock_tryrdlock,
+	.pthread_rwlock_timedrdlock = reeact_passthrough_pthread_rwlock_timedrdlock,
+	.pthread_rwlock_wrlock = reeact_passthrough_pthread_rwlock_wrlock,
+	.pthread_rwlock_trywrlock = reeact_passthrough_pthread_rwlock_trywrlock,
+	.pthread_rwlock_timedwrlock = reeact_passthrough_pthread_rwlock_timedwrlock,
+	.pthread_rwlock_unlock = reeact_passthrough_pthread_rwlock_unlock,
+	.pthread_spin_init = reeact_passthrough_pthread_spin_init,
+	.pthread_spin_destroy = reeact_passthrough_pthread_spin_destroy,
+	.pthread_spin_lock = reeact_passthrough_pthread_spin_lock,
+	.pthread_spin_trylock = reeact_passthrough_pthread_spin_trylock,
+	.pthread_spin_unlock = reeact_passthrough_pthread_spin_unlock,
+	.sem_init = reeact_passthrough_sem_init,
+	.sem_destroy = reeact_passthrough_sem_destroy,
+	.sem_wait = reeact_passthrough_sem_wait,
+	.sem_trywait = reeact_passthrough_sem_trywait,
+	.sem_timedwait = reeact_passthrough_sem_timedwait,
+	.sem_post = reeact_passthrough_sem_post,
+	.sem_getvalue = reeact_passthrough_sem_getvalue,
+	.gomp_barrier_init = reeact_passthrough_gomp_barrier_init,
+	.gomp_barrier_reinit = reeact_passthrough_gomp_barrier_reinit,
+	.gomp_barrier_destroy = reeact_passthrough_gomp_barrier_destroy,
+	.gomp_barrier_wait = reeact_passthrough_gomp_barrier_wait,
+	.gomp_barrier_wait_last = reeact_passthrough_gomp_barrier_wait_last,
+	.gomp_barrier_wait_end = reeact_passthrough_gomp_barrier_wait_end,
+	.gomp_team_barrier_wait = reeact_passthrough_gomp_team_barrier_wait,
+	.gomp_team_barrier_wait_end =
+		reeact_passthrough_gomp_team_barrier_wait_end,
+	.gomp_team_barrier_wake = reeact_passthrough_gomp_team_barrier_wake,
+	.gomp_team_barrier_set_task_pending =
+		reeact_passthrough_gomp_team_barrier_set_task_pending,
+	.gomp_team_barrier_clear_task_pending =
+		reeact_passthrough_gomp_team_barrier_clear_task_pending,
+	.gomp_team_barrier_set_waiting_for_tasks =
+		reeact_passthrough_gomp_team_barrier_set_waiting_for_tasks,
+	.gomp_team_barrier_done = reeact_passthrough_gomp_team_barrier_done,
+	.gomp_team_barrier_waiting_for_tasks =
+		reeact_passthrough_gomp_team_barrier_waiting_for_tasks,
+	.gomp_barrier_last_thread = reeact_passthrough_gomp_barrier_last_thread,
+	.gomp_barrier_wait_start = reeact_passthrough_gomp_barrier_wait_start,
+	.pthread_setaffinity_np = reeact_passthrough_pthread_setaffinity_np,
+	.sched_setaffinity = reeact_passthrough_sched_setaffinity,
+	.pthread_attr_setaffinity_np =
+		reeact_passthrough_pthread_attr_setaffinity_np,
+};
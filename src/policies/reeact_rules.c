@@ -0,0 +1,310 @@
+/*
+ * Implementation of the per-object policy rules: parsing the configuration
+ * file, and matching objects against the rules at their first use.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dlfcn.h>
+
+#include "reeact_rules.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+
+/*
+ * the rules, and whether they have been loaded
+ */
+struct reeact_rule *reeact_rules = NULL;
+int reeact_rules_cnt = 0;
+static int reeact_rules_loaded = 0;
+
+/*
+ * the spin counts of objects without a rule
+ */
+int reeact_rules_default_spin[REEACT_RULE_TYPES];
+
+/*
+ * the number of objects of each type used so far, for order rules
+ */
+static unsigned long reeact_rules_order[REEACT_RULE_TYPES];
+
+/*
+ * Parse a rule from the tokens of a line.
+ * Return value:
+ *     0: success
+ *     1: the line is not a valid rule
+ */
+static int reeact_rules_parse(char *line, struct reeact_rule *rule)
+{
+	char *tok[4], *param, *saveptr, *end, *p;
+	int i;
+
+	memset(rule, 0, sizeof(*rule));
+
+	for(i = 0; i < 4; i++){
+		tok[i] = strtok_r(i == 0 ? line : NULL, " \t", &saveptr);
+		if(tok[i] == NULL)
+			return 1;
+	}
+
+	/* the type */
+	if(strcmp(tok[0], "mutex") == 0)
+		rule->type = REEACT_RULE_MUTEX;
+	else if(strcmp(tok[0], "barrier") == 0)
+		rule->type = REEACT_RULE_BARRIER;
+	else
+		return 1;
+
+	/* the selector */
+	if(strcmp(tok[1], "site") == 0){
+		rule->selector = REEACT_RULE_SITE;
+		p = strchr(tok[2], '+');
+		if(p != NULL){
+			*p = '\0';
+			rule->offset = strtoul(p + 1, &end, 16);
+			if(*end != '\0' || end == p + 1)
+				return 1;
+			rule->has_offset = 1;
+		}
+		rule->name = strdup(tok[2]);
+		if(rule->name == NULL)
+			return 1;
+	}
+	else if(strcmp(tok[1], "addr") == 0){
+		rule->selector = REEACT_RULE_ADDR;
+		rule->addr = (void*)strtoul(tok[2], &end, 16);
+		if(*end != '\0')
+			return 1;
+	}
+	else if(strcmp(tok[1], "order") == 0){
+		rule->selector = REEACT_RULE_ORDER;
+		rule->order = strtoul(tok[2], &end, 10);
+		if(*end != '\0' || rule->order == 0)
+			return 1;
+	}
+	else
+		return 1;
+
+	/* the algorithm */
+	if(strcmp(tok[3], "futex") == 0){
+		rule->algorithm = REEACT_RULE_FUTEX;
+		rule->spin = 0;
+	}
+	else if(strcmp(tok[3], "spin") == 0){
+		rule->algorithm = REEACT_RULE_SPIN;
+		rule->spin = REEACT_RULES_SPIN;
+	}
+	else if(strcmp(tok[3], "spinonly") == 0){
+		rule->algorithm = REEACT_RULE_SPINONLY;
+		rule->spin = -1;
+	}
+	else
+		return 1;
+
+	/* the parameters */
+	while((param = strtok_r(NULL, " \t", &saveptr)) != NULL){
+		if(strncmp(param, "spin=", 5) == 0 &&
+		   rule->algorithm == REEACT_RULE_SPIN){
+			rule->spin = strtol(param + 5, &end, 10);
+			if(*end != '\0' || rule->spin < 0)
+				return 1;
+		}
+		else
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * read the rules
+ */
+int reeact_rules_load(void)
+{
+	FILE *fp;
+	char *buf = NULL, *line;
+	size_t buf_size;
+	char *conf_file;
+	int ln_len, ln_num = 0;
+	struct reeact_rule rule, *rules;
+	int ret_val = 0;
+
+	/* e.g., the policy is activated again */
+	if(reeact_rules_loaded)
+		return 0;
+
+	conf_file = getenv(REEACT_USER_RULES_CONFIG);
+	if(conf_file == NULL)
+		goto loaded;
+
+	fp = fopen(conf_file, "r");
+	if(fp == NULL){
+		LOGERRX("Unable to open file %s: ", conf_file);
+		ret_val = 2;
+		goto loaded;
+	}
+
+	/* parse the file line by line */
+	while((ln_len = getline(&buf, &buf_size, fp)) != -1){
+		ln_num++;
+		if(ln_len > 0 && buf[ln_len-1] == '\n')
+			buf[ln_len-1] = '\0';
+		line = buf;
+		while(*line == ' ' || *line == '\t')
+			line++;
+		if(*line == '\0' || *line == '#')
+			continue;
+
+		if(reeact_rules_parse(line, &rule)){
+			LOGERR("Error parsing rule at line %d of %s\n",
+			       ln_num, conf_file);
+			free(rule.name);
+			ret_val = 2;
+			continue;
+		}
+
+		rules = (struct reeact_rule*)realloc(reeact_rules,
+			sizeof(struct reeact_rule) * (reeact_rules_cnt + 1));
+		if(rules == NULL){
+			LOGERRX("Unable to allocate memory for rules: ");
+			free(rule.name);
+			ret_val = 3;
+			break;
+		}
+		rules[reeact_rules_cnt++] = rule;
+		reeact_rules = rules;
+	}
+
+	DPRINTF("%d rules read from %s\n", reeact_rules_cnt, conf_file);
+
+	/* cleanup */
+	if(buf)
+		free(buf);
+	fclose(fp);
+
+ loaded:
+	/* the rules are complete before objects are matched */
+	mem_barrier();
+	reeact_rules_loaded = 1;
+
+	return ret_val;
+}
+
+/*
+ * change the spin count of a rule
+ */
+int reeact_rules_set_spin(int rule, int spin)
+{
+	if(rule < 0 || rule >= reeact_rules_cnt ||
+	   reeact_rules[rule].algorithm == REEACT_RULE_FUTEX)
+		return EINVAL;
+
+	atomic_read(reeact_rules[rule].spin) = spin;
+	reeact_rules[rule].algorithm = spin < 0 ? REEACT_RULE_SPINONLY : 
+		REEACT_RULE_SPIN;
+
+	return 0;
+}
+
+/*
+ * check if a call site matches a site rule
+ */
+static int reeact_rules_site_match(const struct reeact_rule *rule,
+				   Dl_info *info, void *site)
+{
+	const char *module;
+
+	/* the function containing the call */
+	if(info->dli_sname != NULL && strcmp(info->dli_sname, rule->name) == 0)
+		return !rule->has_offset ||
+			(unsigned long)site - (unsigned long)info->dli_saddr ==
+			rule->offset;
+
+	/* the executable or library */
+	if(info->dli_fname == NULL)
+		return 0;
+	module = strrchr(info->dli_fname, '/');
+	module = module ? module + 1 : info->dli_fname;
+	if(strcmp(module, rule->name) == 0)
+		return !rule->has_offset ||
+			(unsigned long)site - (unsigned long)info->dli_fbase ==
+			rule->offset;
+
+	return 0;
+}
+
+/*
+ * match an object against the rules
+ */
+static int reeact_rules_match(int type, void *obj, void *site)
+{
+	struct reeact_rule *rule;
+	unsigned long order;
+	Dl_info info;
+	int have_info = -1;
+	int i;
+
+	order = atomic_addf(&(reeact_rules_order[type]), 1);
+
+	for(i = 0; i < reeact_rules_cnt; i++){
+		rule = &(reeact_rules[i]);
+		if(rule->type != type)
+			continue;
+		switch(rule->selector){
+		case REEACT_RULE_ADDR:
+			if(rule->addr == obj)
+				return REEACT_RULE_FIRST + i;
+			break;
+		case REEACT_RULE_ORDER:
+			if(rule->order == order)
+				return REEACT_RULE_FIRST + i;
+			break;
+		case REEACT_RULE_SITE:
+			/* resolve the call site once */
+			if(have_info == -1)
+				have_info = site != NULL &&
+					dladdr(site, &info) != 0;
+			if(have_info && reeact_rules_site_match(rule, &info,
+								site))
+				return REEACT_RULE_FIRST + i;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return REEACT_RULE_NONE;
+}
+
+/*
+ * match an object at its first use
+ */
+const struct reeact_rule *reeact_rules_first_use(int *decision, int type,
+						 void *obj, void *site)
+{
+	int d;
+
+	if(!atomic_read(reeact_rules_loaded))
+		return NULL;
+
+	/* one thread matches, the others use the default meanwhile */
+	if(atomic_cmpxchg(decision, REEACT_RULE_UNMATCHED, REEACT_RULE_NONE)
+	   != REEACT_RULE_UNMATCHED)
+		return NULL;
+
+	d = REEACT_RULE_NONE;
+	if(reeact_rules_cnt != 0)
+		d = reeact_rules_match(type, obj, site);
+	if(d == REEACT_RULE_NONE)
+		return NULL;
+
+	atomic_read(*decision) = d;
+	DPRINTF("object %p matches rule %d\n", obj, d - REEACT_RULE_FIRST);
+
+	return &(reeact_rules[d - REEACT_RULE_FIRST]);
+}
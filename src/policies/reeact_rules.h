@@ -0,0 +1,206 @@
+/*
+ * Header file of the per-object policy rules. Different objects of one
+ * process may need different algorithms, e.g., spinning for a hot lock that
+ * is held briefly, and blocking right away for cold locks. The rules are read
+ * from a configuration file named by the REEACT_RULES_CONFIG environment
+ * variable, one rule per line:
+ *
+ *     TYPE SELECTOR VALUE ALGORITHM [spin=N]
+ *
+ *     TYPE: the type of objects, "mutex" or "barrier"
+ *     SELECTOR VALUE: which objects of the type the rule applies to
+ *         site NAME[+OFFSET]: objects first used (locked or waited at) by a
+ *                             call from NAME, the function containing the
+ *                             call or the base name of the executable or
+ *                             library; OFFSET, in hex, is the offset of the
+ *                             return address of the call from NAME, and any
+ *                             call from NAME matches without it. Functions of
+ *                             the executable are only known if it is linked
+ *                             with -rdynamic.
+ *         addr ADDRESS: the object at ADDRESS
+ *         order N: the N-th object of the type to be used, from 1
+ *     ALGORITHM:
+ *         futex: block right away
+ *         spin: spin N times (default REEACT_RULES_SPIN) before blocking
+ *         spinonly: spin without ever blocking
+ *
+ * Empty lines and lines starting with '#' are skipped. The first rule that
+ * matches an object applies; objects that match no rule use the default
+ * algorithm of the policy. For example:
+ *
+ *     mutex site my_alloc spin spin=2000
+ *     mutex order 1 futex
+ *     barrier site libsolver.so+0x1a2b spinonly
+ *
+ * The rules are matched once per object, at its first use after REEact is
+ * initialized, and the decision is cached in the object, so that the hooks
+ * only check the cached decision afterwards. Re-initializing an object makes
+ * it match again. Currently the rules apply to the mutexes and barriers
+ * handled by the fastsync policy; the call site is the return address of the
+ * call into the policy, i.e., the application's call when the hooks are bound
+ * at load time (see pthread_hooks.h). Objects shared by processes always use
+ * the default algorithm: the other processes may have other rules, or none,
+ * so a decision cached in the object would mean nothing to them.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_RULES_H__
+#define __REEACT_RULES_H__
+
+#define REEACT_USER_RULES_CONFIG "REEACT_RULES_CONFIG"
+
+/*
+ * the types of objects
+ */
+#define REEACT_RULE_MUTEX 0
+#define REEACT_RULE_BARRIER 1
+#define REEACT_RULE_TYPES 2
+
+/*
+ * the selectors
+ */
+#define REEACT_RULE_SITE 0
+#define REEACT_RULE_ADDR 1
+#define REEACT_RULE_ORDER 2
+
+/*
+ * the algorithms, and the default spin count of "spin"
+ */
+#define REEACT_RULE_FUTEX 0
+#define REEACT_RULE_SPIN 1
+#define REEACT_RULE_SPINONLY 2
+#define REEACT_RULES_SPIN 1000
+
+/*
+ * A rule.
+ *     type: REEACT_RULE_MUTEX or REEACT_RULE_BARRIER
+ *     selector: REEACT_RULE_SITE, REEACT_RULE_ADDR or REEACT_RULE_ORDER
+ *     name, offset, has_offset: the call site of a site rule
+ *     addr: the object of an addr rule
+ *     order: the order of an order rule
+ *     algorithm: REEACT_RULE_FUTEX, REEACT_RULE_SPIN or REEACT_RULE_SPINONLY
+ *     spin: the number of spins before blocking, 0 for futex and negative for
+ *           spinonly
+ */
+struct reeact_rule{
+	int type;
+	int selector;
+	char *name;
+	unsigned long offset;
+	int has_offset;
+	void *addr;
+	unsigned long order;
+	int algorithm;
+	int spin;
+};
+
+/*
+ * The decision cached in an object, a zero-filled int in the object:
+ *     UNMATCHED: the object has not been matched yet
+ *     NONE: no rule matches the object
+ *     FIRST + i: rule i matches the object
+ */
+#define REEACT_RULE_UNMATCHED 0
+#define REEACT_RULE_NONE 1
+#define REEACT_RULE_FIRST 2
+
+/*
+ * the rules, in the order of the configuration file, and their number
+ */
+extern struct reeact_rule *reeact_rules;
+extern int reeact_rules_cnt;
+
+/*
+ * the number of spins before blocking of the objects of each type that match
+ * no rule; 0 (the default) to block right away, negative to never block
+ */
+extern int reeact_rules_default_spin[REEACT_RULE_TYPES];
+
+/*
+ * Read the rules from the file named by REEACT_RULES_CONFIG, if it is set.
+ * Objects are matched after this function is called. Later calls do nothing.
+ * Return value:
+ *     0: success
+ *     2: error reading the file; lines that cannot be parsed are skipped
+ *        with an error message
+ *     3: error allocating space
+ */
+int reeact_rules_load(void);
+
+/*
+ * Match an object at its first use, caching the decision in the object.
+ * Input parameters:
+ *     decision: the cached decision in the object
+ *     type: the type of the object
+ *     obj: the object
+ *     site: the return address of the call using the object
+ * Return value:
+ *     the rule of the object, NULL if no rule matches or the rules are not
+ *     loaded yet
+ */
+const struct reeact_rule *reeact_rules_first_use(int *decision, int type,
+						 void *obj, void *site);
+
+/*
+ * Change the number of spins before blocking of a rule at run-time; the 
+ * objects matching the rule use the new count from their next wait.
+ * Input parameters:
+ *     rule: the index of the rule
+ *     spin: the number of spins, negative to never block
+ * Return value:
+ *     0: success
+ *     EINVAL: no such rule, or the rule blocks right away (futex)
+ */
+int reeact_rules_set_spin(int rule, int spin);
+
+/*
+ * Get the rule of an object, matching it on its first use.
+ * Input parameters:
+ *     decision: the cached decision in the object, NULL for an object shared
+ *               by processes, which is not matched
+ *     others: same as reeact_rules_first_use
+ * Return value:
+ *     the rule of the object, NULL if no rule matches
+ */
+static inline const struct reeact_rule *reeact_rules_lookup(int *decision,
+							    int type,
+							    void *obj,
+							    void *site)
+{
+	int d;
+
+	if(decision == (int*)0)
+		return (const struct reeact_rule*)0;
+
+	d = *(volatile int*)decision;
+	if(d == REEACT_RULE_NONE)
+		return (const struct reeact_rule*)0;
+	if(d == REEACT_RULE_UNMATCHED)
+		return reeact_rules_first_use(decision, type, obj, site);
+	/* not a decision of this process, e.g., garbage in the object */
+	if(d < REEACT_RULE_FIRST || d - REEACT_RULE_FIRST >= reeact_rules_cnt)
+		return (const struct reeact_rule*)0;
+
+	return &(reeact_rules[d - REEACT_RULE_FIRST]);
+}
+
+/*
+ * Get the number of spins before blocking of an object, matching it on its
+ * first use.
+ * Input parameters:
+ *     same as reeact_rules_lookup
+ * Return value:
+ *     the spin count of the rule of the object, or the default of its type
+ */
+static inline int reeact_rules_spin(int *decision, int type, void *obj,
+				    void *site)
+{
+	const struct reeact_rule *rule = 
+		reeact_rules_lookup(decision, type, obj, site);
+
+	return rule ? *(const volatile int*)&(rule->spin) : 
+		*(volatile int*)&(reeact_rules_default_spin[type]);
+}
+
+#endif
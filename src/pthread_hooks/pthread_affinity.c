@@ -0,0 +1,40 @@
+/*
+ * The implementation of the REEact hooks for setting the cpu affinity of
+ * threads: pthread_setaffinity_np, sched_setaffinity and
+ * pthread_attr_setaffinity_np. Like pthread_create, they are not on the hot
+ * path, and always dispatch through the policy table.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "../utils/reeact_utils.h"
+#include "../policies/reeact_policy.h"
+#include "pthread_hooks.h"
+
+int REEACT_HOOK(pthread_setaffinity_np)(pthread_t thread, size_t cpusetsize,
+					const cpu_set_t *cpuset)
+{
+	return reeact_policy_pthread_setaffinity_np(thread, cpusetsize,
+						    (const void*)cpuset);
+}
+
+int REEACT_HOOK(sched_setaffinity)(pid_t pid, size_t cpusetsize,
+				   const cpu_set_t *mask)
+{
+	return reeact_policy_sched_setaffinity(pid, cpusetsize,
+					       (const void*)mask);
+}
+
+int REEACT_HOOK(pthread_attr_setaffinity_np)(pthread_attr_t *attr,
+					     size_t cpusetsize,
+					     const cpu_set_t *cpuset)
+{
+	return reeact_policy_pthread_attr_setaffinity_np((void*)attr,
+							 cpusetsize,
+							 (const void*)cpuset);
+}
@@ -7,20 +7,25 @@
 #include <pthread.h>
 
 #include "../policies/reeact_policy.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "pthread_hooks.h"
 
-int pthread_barrier_wait(pthread_barrier_t *barrier)
+int REEACT_HOOK(pthread_barrier_wait)(pthread_barrier_t *barrier)
 {
 	return reeact_policy_pthread_barrier_wait((void*)barrier);	
 }
 
-int pthread_barrier_destroy(pthread_barrier_t *barrier)
+int REEACT_HOOK(pthread_barrier_destroy)(pthread_barrier_t *barrier)
 {
+	reeact_sidetable_remove((void*)barrier);
 	return reeact_policy_pthread_barrier_destroy((void*)barrier);
 }
-int pthread_barrier_init(pthread_barrier_t *barrier,
-			 const pthread_barrierattr_t *attr, 
-			 unsigned count)
+int REEACT_HOOK(pthread_barrier_init)(pthread_barrier_t *barrier,
+				      const pthread_barrierattr_t *attr, 
+				      unsigned count)
 {
+	/* drop side-table state left by an old object at this address */
+	reeact_sidetable_remove((void*)barrier);
 	return reeact_policy_pthread_barrier_init((void*)barrier, (void*)attr, 
 						  count);
 }
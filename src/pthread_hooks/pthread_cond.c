@@ -8,37 +8,44 @@
 #include <pthread.h>
 
 #include "../policies/reeact_policy.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "pthread_hooks.h"
 
 
-int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *cond_attr)
+int REEACT_HOOK(pthread_cond_init)(pthread_cond_t *cond,
+				   const pthread_condattr_t *cond_attr)
 {
+	reeact_sidetable_remove((void*)cond);
 	return reeact_policy_pthread_cond_init((void*)cond, (void*)cond_attr);
 }
 
 
-int pthread_cond_signal(pthread_cond_t *cond)
+int REEACT_HOOK(pthread_cond_signal)(pthread_cond_t *cond)
 {
 	return reeact_policy_pthread_cond_signal((void*)cond);
 }
 
-int pthread_cond_broadcast(pthread_cond_t *cond)
+int REEACT_HOOK(pthread_cond_broadcast)(pthread_cond_t *cond)
 {
 	return reeact_policy_pthread_cond_broadcast((void*)cond);
 }
 
-int pthread_cond_destroy(pthread_cond_t *cond)
+int REEACT_HOOK(pthread_cond_destroy)(pthread_cond_t *cond)
 {
+	reeact_sidetable_remove((void*)cond);
 	return reeact_policy_pthread_cond_destroy((void*)cond);
 }
 
 
-int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+int REEACT_HOOK(pthread_cond_wait)(pthread_cond_t *cond, 
+				   pthread_mutex_t *mutex)
 {
 	return reeact_policy_pthread_cond_wait((void*)cond, (void*)mutex);
 }
 
-int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, 
-			   const struct timespec *abstime)
+int REEACT_HOOK(pthread_cond_timedwait)(pthread_cond_t *cond, 
+					pthread_mutex_t *mutex, 
+					const struct timespec *abstime)
 {
 	return reeact_policy_pthread_cond_timedwait((void*)cond, (void*)mutex, 
 						    (void*)abstime);
@@ -1,22 +1,67 @@
 /*
- * The implementation of the REEact pthread hook for pthread_create.
+ * The implementation of the REEact pthread hooks for pthread_create and
+ * pthread_join.
  *
  * Author: Wei Wang <wwang@virginia.edu>
  */
 
 
 #include <stdio.h>
+#include <errno.h>
 #include <pthread.h>
 
 
 #include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
 #include "../policies/reeact_policy.h"
+#include "../threads/reeact_threads.h"
+#include "../threads/reeact_throttle.h"
+#include "pthread_hooks.h"
+#include "pthread_hooks_originals.h"
 
-int pthread_create(pthread_t *thread, const pthread_attr_t *attr, 
-		   void *(*start_routine) (void *), void *arg)
+int REEACT_HOOK(pthread_create)(pthread_t *thread, 
+				const pthread_attr_t *attr,
+				void *(*start_routine) (void *), void *arg)
 {
+	int ret_val;
+
 	DPRINTF("pthread_create called\n");
 
-	return reeact_policy_pthread_create((void*)thread, (void*)attr, 
-					    start_routine, arg);
+	/* leave the single-threaded fast path before there is a second thread */
+	reeact_multithreaded = 1;
+	/* 
+	 * the nodes matter once there are threads to spread; load the 
+	 * topology here, where blocking is safe, not in the lock paths
+	 */
+	fastsync_load_topology();
+
+	/* register the thread and report its start and exit */
+	if(reeact_threads_wrap(&start_routine, &arg, attr) != 0)
+		return EAGAIN;
+
+	ret_val = reeact_policy_pthread_create((void*)thread, (void*)attr, 
+					       start_routine, arg);
+	if(ret_val != 0)
+		reeact_threads_unwrap(start_routine, arg);
+
+	return ret_val;
+}
+
+/*
+ * pthread_join only maintains the thread records, and the count of blocked
+ * threads of the throttling, and is not dispatched to the policies
+ */
+int REEACT_HOOK(pthread_join)(pthread_t thread, void **retval)
+{
+	int ret_val;
+
+	if(reeact_throttle_on)
+		reeact_throttle_wait_begin();
+	ret_val = real_pthread_join(thread, retval);
+	if(reeact_throttle_on)
+		reeact_throttle_wait_end(REEACT_THROTTLE_JOIN, ret_val);
+	if(ret_val == 0)
+		reeact_threads_joined(thread);
+
+	return ret_val;
 }
@@ -11,9 +11,12 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <dlfcn.h>
+#include <errno.h>
 
 #include "pthread_hooks.h"
+#include "../fastsync/fastsync.h"
 #include "../utils/reeact_utils.h"
 
 /* 
@@ -22,6 +25,7 @@
 typedef int (*pthread_create_type)(pthread_t *thread, 
 				   const pthread_attr_t *attr,
 				   void *(*start_routine) (void *), void *arg);
+typedef int (*pthread_join_type)(pthread_t thread, void **retval);
 typedef int (*pthread_barrier_init_type)(pthread_barrier_t *barrier, 
 					 const pthread_barrierattr_t *attr,
 					 unsigned count);
@@ -46,102 +50,354 @@ typedef int (*pthread_cond_timedwait_type)(pthread_cond_t *cond,
 					   pthread_mutex_t *mutex, 
 					   const struct timespec *abstime);
 
+typedef int (*pthread_rwlock_init_type)(pthread_rwlock_t *rwlock,
+					const pthread_rwlockattr_t *attr);
+typedef int (*pthread_rwlock_general_type)(pthread_rwlock_t *rwlock);
+typedef int (*pthread_rwlock_timedlock_type)(pthread_rwlock_t *rwlock,
+					     const struct timespec *abstime);
 
-pthread_create_type real_pthread_create;
-pthread_barrier_init_type real_pthread_barrier_init;
-pthread_barrier_wait_type real_pthread_barrier_wait;
-pthread_barrier_destroy_type real_pthread_barrier_destroy;
+typedef int (*pthread_spin_init_type)(pthread_spinlock_t *lock, int pshared);
+typedef int (*pthread_spin_general_type)(pthread_spinlock_t *lock);
 
-pthread_mutex_init_type real_pthread_mutex_init;
-pthread_mutex_general_type real_pthread_mutex_lock;
-pthread_mutex_general_type real_pthread_mutex_trylock;
-pthread_mutex_timedlock_type real_pthread_mutex_timedlock;
-pthread_mutex_general_type real_pthread_mutex_unlock;
-pthread_mutex_general_type real_pthread_mutex_consistent;
-pthread_mutex_general_type real_pthread_mutex_destroy;
+typedef int (*sem_init_type)(sem_t *sem, int pshared, unsigned int value);
+typedef int (*sem_general_type)(sem_t *sem);
+typedef int (*sem_timedwait_type)(sem_t *sem, const struct timespec *abstime);
+typedef int (*sem_getvalue_type)(sem_t *sem, int *sval);
 
-pthread_cond_init_type real_pthread_cond_init;
-pthread_cond_general_type real_pthread_cond_destroy;
-pthread_cond_general_type real_pthread_cond_signal;
-pthread_cond_general_type real_pthread_cond_broadcast;
-pthread_cond_wait_type real_pthread_cond_wait;
-pthread_cond_timedwait_type real_pthread_cond_timedwait;
+typedef int (*pthread_setaffinity_np_type)(pthread_t thread, size_t size,
+					   const cpu_set_t *cpuset);
+typedef int (*sched_setaffinity_type)(pid_t pid, size_t size,
+				      const cpu_set_t *cpuset);
+typedef int (*pthread_attr_setaffinity_np_type)(pthread_attr_t *attr,
+						size_t size,
+						const cpu_set_t *cpuset);
+
+
+/*
+ * Bootstrap of the real pthread functions. Other libraries' constructors may
+ * call pthread functions before reeact_init runs, so every real_* pointer 
+ * starts at a stub that locates all the original functions on first use and
+ * then calls the original. Afterwards the pointers are never changed, and the
+ * hooks call them without any check.
+ *
+ * dlsym may allocate memory, and a malloc replacement may lock a mutex, 
+ * which comes back to the hooks. The bootstrap runs under a spinlock that 
+ * does not depend on any pthread function; while it runs, no other thread
+ * gets past the stubs, so the stubs let the bootstrapping thread's own
+ * nested calls succeed without doing anything.
+ */
+#ifdef _REEACT_WRAP_
+/*
+ * in the static build, the real_* pointers are bound by the linker to the 
+ * originals, see pthread_hooks.h
+ */
+#define REEACT_BOOTSTRAP_STUB(type, func, params, args, err)		\
+	extern int __real_##func params;				\
+	type real_##func = __real_##func;
+#else
+#define REEACT_BOOTSTRAP_NONE 0
+#define REEACT_BOOTSTRAP_DONE 1
+static int reeact_bootstrap_state = REEACT_BOOTSTRAP_NONE;
+static fastsync_spinlock reeact_bootstrap_lock;
+static __thread int reeact_bootstrapping = 0;
+
+static int reeact_pthread_hooks_bootstrap(void);
+
+/*
+ * error of a function that reports errors in errno (semaphores, 
+ * sched_setaffinity) whose original cannot be located
+ */
+#define REEACT_ERRNO_ENOSYS (errno = ENOSYS, -1)
+
+/*
+ * Define a real_* pointer, initialized to its bootstrap stub.
+ *     type: the type of the pointer
+ *     func: the pthread function
+ *     params: the parameter list of the function
+ *     args: the arguments passed to the original
+ *     err: the return value if the original cannot be located
+ */
+#define REEACT_BOOTSTRAP_STUB(type, func, params, args, err)		\
+	static int reeact_bootstrap_##func params;			\
+	type real_##func = reeact_bootstrap_##func;			\
+	static int reeact_bootstrap_##func params			\
+	{								\
+		if(reeact_pthread_hooks_bootstrap() != 0)		\
+			return 0;					\
+		if(real_##func == reeact_bootstrap_##func)		\
+			return err;					\
+		return real_##func args;				\
+	}
+#endif
+
+REEACT_BOOTSTRAP_STUB(pthread_create_type, pthread_create,
+		      (pthread_t *thread, const pthread_attr_t *attr,
+		       void *(*start_routine) (void *), void *arg),
+		      (thread, attr, start_routine, arg), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_join_type, pthread_join,
+		      (pthread_t thread, void **retval), (thread, retval),
+		      ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_barrier_init_type, pthread_barrier_init,
+		      (pthread_barrier_t *barrier,
+		       const pthread_barrierattr_t *attr, unsigned count),
+		      (barrier, attr, count), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_barrier_wait_type, pthread_barrier_wait,
+		      (pthread_barrier_t *barrier),
+		      (barrier), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_barrier_destroy_type, pthread_barrier_destroy,
+		      (pthread_barrier_t *barrier),
+		      (barrier), ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(pthread_mutex_init_type, pthread_mutex_init,
+		      (pthread_mutex_t *mutex,
+		       const pthread_mutexattr_t *mutexattr),
+		      (mutex, mutexattr), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_general_type, pthread_mutex_lock,
+		      (pthread_mutex_t *mutex),
+		      (mutex), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_general_type, pthread_mutex_trylock,
+		      (pthread_mutex_t *mutex),
+		      (mutex), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_timedlock_type, pthread_mutex_timedlock,
+		      (pthread_mutex_t *mutex,
+		       const struct timespec *abs_timeout),
+		      (mutex, abs_timeout), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_general_type, pthread_mutex_unlock,
+		      (pthread_mutex_t *mutex),
+		      (mutex), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_general_type, pthread_mutex_consistent,
+		      (pthread_mutex_t *mutex),
+		      (mutex), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_mutex_general_type, pthread_mutex_destroy,
+		      (pthread_mutex_t *mutex),
+		      (mutex), ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(pthread_cond_init_type, pthread_cond_init,
+		      (pthread_cond_t *cond,
+		       pthread_condattr_t *cond_attr),
+		      (cond, cond_attr), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_cond_general_type, pthread_cond_destroy,
+		      (pthread_cond_t *cond),
+		      (cond), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_cond_general_type, pthread_cond_signal,
+		      (pthread_cond_t *cond),
+		      (cond), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_cond_general_type, pthread_cond_broadcast,
+		      (pthread_cond_t *cond),
+		      (cond), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_cond_wait_type, pthread_cond_wait,
+		      (pthread_cond_t *cond,
+		       pthread_mutex_t *mutex),
+		      (cond, mutex), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_cond_timedwait_type, pthread_cond_timedwait,
+		      (pthread_cond_t *cond,
+		       pthread_mutex_t *mutex, const struct timespec *abstime),
+		      (cond, mutex, abstime), ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_init_type, pthread_rwlock_init,
+		      (pthread_rwlock_t *rwlock,
+		       const pthread_rwlockattr_t *attr),
+		      (rwlock, attr), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_destroy,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_rdlock,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_tryrdlock,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_timedlock_type, pthread_rwlock_timedrdlock,
+		      (pthread_rwlock_t *rwlock,
+		       const struct timespec *abstime),
+		      (rwlock, abstime), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_wrlock,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_trywrlock,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_timedlock_type, pthread_rwlock_timedwrlock,
+		      (pthread_rwlock_t *rwlock,
+		       const struct timespec *abstime),
+		      (rwlock, abstime), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_rwlock_general_type, pthread_rwlock_unlock,
+		      (pthread_rwlock_t *rwlock),
+		      (rwlock), ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(pthread_spin_init_type, pthread_spin_init,
+		      (pthread_spinlock_t *lock, int pshared),
+		      (lock, pshared), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_spin_general_type, pthread_spin_destroy,
+		      (pthread_spinlock_t *lock),
+		      (lock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_spin_general_type, pthread_spin_lock,
+		      (pthread_spinlock_t *lock),
+		      (lock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_spin_general_type, pthread_spin_trylock,
+		      (pthread_spinlock_t *lock),
+		      (lock), ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_spin_general_type, pthread_spin_unlock,
+		      (pthread_spinlock_t *lock),
+		      (lock), ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(sem_init_type, sem_init,
+		      (sem_t *sem, int pshared, unsigned int value),
+		      (sem, pshared, value), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_general_type, sem_destroy,
+		      (sem_t *sem),
+		      (sem), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_general_type, sem_wait,
+		      (sem_t *sem),
+		      (sem), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_general_type, sem_trywait,
+		      (sem_t *sem),
+		      (sem), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_timedwait_type, sem_timedwait,
+		      (sem_t *sem, const struct timespec *abstime),
+		      (sem, abstime), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_general_type, sem_post,
+		      (sem_t *sem),
+		      (sem), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(sem_getvalue_type, sem_getvalue,
+		      (sem_t *sem, int *sval),
+		      (sem, sval), REEACT_ERRNO_ENOSYS)
+
+REEACT_BOOTSTRAP_STUB(pthread_setaffinity_np_type, pthread_setaffinity_np,
+		      (pthread_t thread, size_t size, const cpu_set_t *cpuset),
+		      (thread, size, cpuset), ENOSYS)
+REEACT_BOOTSTRAP_STUB(sched_setaffinity_type, sched_setaffinity,
+		      (pid_t pid, size_t size, const cpu_set_t *cpuset),
+		      (pid, size, cpuset), REEACT_ERRNO_ENOSYS)
+REEACT_BOOTSTRAP_STUB(pthread_attr_setaffinity_np_type,
+		      pthread_attr_setaffinity_np,
+		      (pthread_attr_t *attr, size_t size,
+		       const cpu_set_t *cpuset),
+		      (attr, size, cpuset), ENOSYS)
+
+#ifndef _REEACT_WRAP_
+/*
+ * the originals located by the bootstrap
+ */
+#define REEACT_ORIGINAL(func)						\
+	{#func, (void**)&real_##func, (void*)reeact_bootstrap_##func}
+static const struct{
+	const char *name;
+	void **real;
+	void *stub;
+}reeact_originals[] = {
+	REEACT_ORIGINAL(pthread_create),
+	REEACT_ORIGINAL(pthread_join),
+	REEACT_ORIGINAL(pthread_barrier_init),
+	REEACT_ORIGINAL(pthread_barrier_wait),
+	REEACT_ORIGINAL(pthread_barrier_destroy),
+	REEACT_ORIGINAL(pthread_mutex_init),
+	REEACT_ORIGINAL(pthread_mutex_lock),
+	REEACT_ORIGINAL(pthread_mutex_trylock),
+	REEACT_ORIGINAL(pthread_mutex_timedlock),
+	REEACT_ORIGINAL(pthread_mutex_unlock),
+	REEACT_ORIGINAL(pthread_mutex_consistent),
+	REEACT_ORIGINAL(pthread_mutex_destroy),
+	REEACT_ORIGINAL(pthread_cond_init),
+	REEACT_ORIGINAL(pthread_cond_destroy),
+	REEACT_ORIGINAL(pthread_cond_signal),
+	REEACT_ORIGINAL(pthread_cond_broadcast),
+	REEACT_ORIGINAL(pthread_cond_wait),
+	REEACT_ORIGINAL(pthread_cond_timedwait),
+	REEACT_ORIGINAL(pthread_rwlock_init),
+	REEACT_ORIGINAL(pthread_rwlock_destroy),
+	REEACT_ORIGINAL(pthread_rwlock_rdlock),
+	REEACT_ORIGINAL(pthread_rwlock_tryrdlock),
+	REEACT_ORIGINAL(pthread_rwlock_timedrdlock),
+	REEACT_ORIGINAL(pthread_rwlock_wrlock),
+	REEACT_ORIGINAL(pthread_rwlock_trywrlock),
+	REEACT_ORIGINAL(pthread_rwlock_timedwrlock),
+	REEACT_ORIGINAL(pthread_rwlock_unlock),
+	REEACT_ORIGINAL(pthread_spin_init),
+	REEACT_ORIGINAL(pthread_spin_destroy),
+	REEACT_ORIGINAL(pthread_spin_lock),
+	REEACT_ORIGINAL(pthread_spin_trylock),
+	REEACT_ORIGINAL(pthread_spin_unlock),
+	REEACT_ORIGINAL(sem_init),
+	REEACT_ORIGINAL(sem_destroy),
+	REEACT_ORIGINAL(sem_wait),
+	REEACT_ORIGINAL(sem_trywait),
+	REEACT_ORIGINAL(sem_timedwait),
+	REEACT_ORIGINAL(sem_post),
+	REEACT_ORIGINAL(sem_getvalue),
+	REEACT_ORIGINAL(pthread_setaffinity_np),
+	REEACT_ORIGINAL(sched_setaffinity),
+	REEACT_ORIGINAL(pthread_attr_setaffinity_np),
+};
+#define REEACT_ORIGINAL_CNT						\
+	(sizeof(reeact_originals) / sizeof(reeact_originals[0]))
+
+/*
+ * Locate the original pthread functions, once.
+ * Return value:
+ *     0: the real_* pointers are set
+ *     1: called by the bootstrapping thread itself, from within dlsym
+ */
+static int reeact_pthread_hooks_bootstrap(void)
+{
+	void *func;
+	int i;
+
+	if(atomic_read(reeact_bootstrap_state) == REEACT_BOOTSTRAP_DONE)
+		return 0;
+	if(reeact_bootstrapping)
+		return 1;
+
+	fastsync_spin_lock(&reeact_bootstrap_lock);
+	if(reeact_bootstrap_state != REEACT_BOOTSTRAP_DONE){
+		reeact_bootstrapping = 1;
+		for(i = 0; i < REEACT_ORIGINAL_CNT; i++){
+			func = dlsym(RTLD_NEXT, reeact_originals[i].name);
+			if(func != NULL)
+				*(reeact_originals[i].real) = func;
+		}
+		reeact_bootstrapping = 0;
+		mem_barrier();
+		reeact_bootstrap_state = REEACT_BOOTSTRAP_DONE;
+	}
+	fastsync_spin_unlock(&reeact_bootstrap_lock);
+
+	return 0;
+}
+
+/*
+ * locate the originals before other constructors, when possible
+ */
+__attribute__((constructor(101)))
+static void reeact_pthread_hooks_preinit(void)
+{
+	/* processes that are not selected locate them on first use */
+	if(reeact_proc_selected())
+		reeact_pthread_hooks_bootstrap();
+}
+
+#endif
 
 /*
  * initialization function for REEact pthread hooks.
  */
 int reeact_pthread_hooks_init(void *data)
 {
-	char *error = NULL;
-	int ret_val = 0;
-
-	/*
-	 * locate the original pthread functions
-	 */
-	dlerror();    // Clear any existing error
-	real_pthread_create = 
-		(pthread_create_type)dlsym(RTLD_NEXT, "pthread_create");
-	real_pthread_barrier_init = 
-		(pthread_barrier_init_type)dlsym(RTLD_NEXT, 
-						 "pthread_barrier_init");
-	real_pthread_barrier_wait = 
-		(pthread_barrier_wait_type)dlsym(RTLD_NEXT, 
-						 "pthread_barrier_wait");
-	real_pthread_barrier_destroy = 
-		(pthread_barrier_destroy_type)dlsym(RTLD_NEXT, 
-						    "pthread_barrier_destroy");
-
-	real_pthread_mutex_init = 
-		(pthread_mutex_init_type)dlsym(RTLD_NEXT, "pthread_mutex_init");
-	real_pthread_mutex_lock = 
-		(pthread_mutex_general_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_lock");
-	real_pthread_mutex_trylock = 
-		(pthread_mutex_general_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_trylock");
-	real_pthread_mutex_unlock = 
-		(pthread_mutex_general_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_unlock");
-	real_pthread_mutex_consistent = 
-		(pthread_mutex_general_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_consistent");
-	real_pthread_mutex_destroy = 
-		(pthread_mutex_general_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_destroy");
-	real_pthread_mutex_timedlock = 
-		(pthread_mutex_timedlock_type)dlsym(RTLD_NEXT, 
-						  "pthread_mutex_timedlock");
-	
-	real_pthread_cond_init = 
-		(pthread_cond_init_type)dlsym(RTLD_NEXT, "pthread_cond_init");
-	real_pthread_cond_destroy = 
-		(pthread_cond_general_type)dlsym(RTLD_NEXT, 
-						 "pthread_cond_destroy");
-	real_pthread_cond_signal = 
-		(pthread_cond_general_type)dlsym(RTLD_NEXT, 
-						 "pthread_cond_signal");
-	real_pthread_cond_broadcast = 
-		(pthread_cond_general_type)dlsym(RTLD_NEXT, 
-						 "pthread_cond_broadcast");
-	real_pthread_cond_wait = 
-		(pthread_cond_wait_type)dlsym(RTLD_NEXT, 
-						 "pthread_cond_wait");
-	real_pthread_cond_timedwait = 
-		(pthread_cond_timedwait_type)dlsym(RTLD_NEXT, 
-						 "pthread_cond_timedwait");
-
-
-	if ((error = dlerror()) != NULL)  {
-		LOGERR("Error opening original pthread functions with "
-			"error :%s\n", error);
-		ret_val = REEACT_PTHREAD_HOOKS_ERR_LOAD_ORIGINAL_FUNCTION;
-		goto error;
+#ifndef _REEACT_WRAP_
+	int i;
+
+	reeact_pthread_hooks_bootstrap();
+
+	for(i = 0; i < REEACT_ORIGINAL_CNT; i++){
+		if(*(reeact_originals[i].real) == reeact_originals[i].stub){
+			LOGERR("Error opening original pthread function %s\n",
+			       reeact_originals[i].name);
+			return REEACT_PTHREAD_HOOKS_ERR_LOAD_ORIGINAL_FUNCTION;
+		}
 	}
+#endif
 	
 	return 0;
-
- error:
-	return ret_val;
 }
 
 /*
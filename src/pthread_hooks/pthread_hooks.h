@@ -34,4 +34,19 @@ int reeact_pthread_hooks_init(void *data);
  */
 int reeact_pthread_hooks_cleanup(void *data);
 
+/*
+ * The static build. libreeact_wrap.a is built with _REEACT_WRAP_, for
+ * programs that are linked statically, or that cannot be preloaded. Such a
+ * program is linked with -Wl,--wrap=<function> for every hooked function (see
+ * libreeact_wrap.opts, generated by "make wrap"), so the linker sends its
+ * calls to __wrap_<function>, and binds __real_<function>, which the real_*
+ * pointers point to, to the original function. There is no dlsym; as in
+ * libreeact.so, the hooks dispatch through reeact_active_policy.
+ */
+#ifdef _REEACT_WRAP_
+#define REEACT_HOOK(func) __wrap_##func
+#else
+#define REEACT_HOOK(func) func
+#endif
+
 #endif
@@ -1,6 +1,8 @@
 /*
  * Header file that defines wrappers of the original pthread functions. Include
- * this file if there is a need to call the real pthread functions.
+ * this file if there is a need to call the real pthread functions. The 
+ * pointers can be called at any time, even before REEact is initialized: they
+ * start at stubs that locate the real functions on first use.
  *
  * Author: Wei Wang <wwang@virginia.edu>
  */
@@ -10,9 +12,11 @@
 #define __REEACT_PTHREAD_HOOKS_ORIGINALS_H__
 
 #include <pthread.h>
+#include <semaphore.h>
 
 extern int (*real_pthread_create)(pthread_t *thread, const pthread_attr_t *attr,
 				  void *(*start_routine) (void *), void *arg);
+extern int (*real_pthread_join)(pthread_t thread, void **retval);
 
 extern int (*real_pthread_barrier_init)(pthread_barrier_t *barrier, 
 					const pthread_barrierattr_t *attr,
@@ -41,6 +45,44 @@ extern int (*real_pthread_cond_timedwait)(pthread_cond_t *cond,
 				     pthread_mutex_t *mutex, 
 				     const struct timespec *abstime);
 
+extern int (*real_pthread_rwlock_init)(pthread_rwlock_t *rwlock,
+				       const pthread_rwlockattr_t *attr);
+extern int (*real_pthread_rwlock_destroy)(pthread_rwlock_t *rwlock);
+extern int (*real_pthread_rwlock_rdlock)(pthread_rwlock_t *rwlock);
+extern int (*real_pthread_rwlock_tryrdlock)(pthread_rwlock_t *rwlock);
+extern int (*real_pthread_rwlock_timedrdlock)(pthread_rwlock_t *rwlock,
+					      const struct timespec *abstime);
+extern int (*real_pthread_rwlock_wrlock)(pthread_rwlock_t *rwlock);
+extern int (*real_pthread_rwlock_trywrlock)(pthread_rwlock_t *rwlock);
+extern int (*real_pthread_rwlock_timedwrlock)(pthread_rwlock_t *rwlock,
+					      const struct timespec *abstime);
+extern int (*real_pthread_rwlock_unlock)(pthread_rwlock_t *rwlock);
+
+extern int (*real_pthread_spin_init)(pthread_spinlock_t *lock, int pshared);
+extern int (*real_pthread_spin_destroy)(pthread_spinlock_t *lock);
+extern int (*real_pthread_spin_lock)(pthread_spinlock_t *lock);
+extern int (*real_pthread_spin_trylock)(pthread_spinlock_t *lock);
+extern int (*real_pthread_spin_unlock)(pthread_spinlock_t *lock);
+
+extern int (*real_sem_init)(sem_t *sem, int pshared, unsigned int value);
+extern int (*real_sem_destroy)(sem_t *sem);
+extern int (*real_sem_wait)(sem_t *sem);
+extern int (*real_sem_trywait)(sem_t *sem);
+extern int (*real_sem_timedwait)(sem_t *sem, const struct timespec *abstime);
+extern int (*real_sem_post)(sem_t *sem);
+extern int (*real_sem_getvalue)(sem_t *sem, int *sval);
+
+/* cpu_set_t is only declared with _GNU_SOURCE */
+#ifdef _GNU_SOURCE
+extern int (*real_pthread_setaffinity_np)(pthread_t thread, size_t size,
+					  const cpu_set_t *cpuset);
+extern int (*real_sched_setaffinity)(pid_t pid, size_t size,
+				     const cpu_set_t *cpuset);
+extern int (*real_pthread_attr_setaffinity_np)(pthread_attr_t *attr,
+					       size_t size,
+					       const cpu_set_t *cpuset);
+#endif
+
 
 #endif
 
@@ -0,0 +1,64 @@
+/*
+ * Implementation of the reader-writer lock functions that replace pthread 
+ * rwlock.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#include <pthread.h>
+
+#include "../policies/reeact_policy.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "pthread_hooks.h"
+
+int REEACT_HOOK(pthread_rwlock_init)(pthread_rwlock_t *rwlock,
+				     const pthread_rwlockattr_t *attr)
+{
+	reeact_sidetable_remove((void*)rwlock);
+	return reeact_policy_pthread_rwlock_init((void*)rwlock, (void*)attr);
+}
+
+int REEACT_HOOK(pthread_rwlock_destroy)(pthread_rwlock_t *rwlock)
+{
+	reeact_sidetable_remove((void*)rwlock);
+	return reeact_policy_pthread_rwlock_destroy((void*)rwlock);
+}
+
+int REEACT_HOOK(pthread_rwlock_rdlock)(pthread_rwlock_t *rwlock)
+{
+	return reeact_policy_pthread_rwlock_rdlock((void*)rwlock);
+}
+
+int REEACT_HOOK(pthread_rwlock_tryrdlock)(pthread_rwlock_t *rwlock)
+{
+	return reeact_policy_pthread_rwlock_tryrdlock((void*)rwlock);
+}
+
+int REEACT_HOOK(pthread_rwlock_timedrdlock)(pthread_rwlock_t *rwlock,
+	const struct timespec *abstime)
+{
+	return reeact_policy_pthread_rwlock_timedrdlock((void*)rwlock,
+							(void*)abstime);
+}
+
+int REEACT_HOOK(pthread_rwlock_wrlock)(pthread_rwlock_t *rwlock)
+{
+	return reeact_policy_pthread_rwlock_wrlock((void*)rwlock);
+}
+
+int REEACT_HOOK(pthread_rwlock_trywrlock)(pthread_rwlock_t *rwlock)
+{
+	return reeact_policy_pthread_rwlock_trywrlock((void*)rwlock);
+}
+
+int REEACT_HOOK(pthread_rwlock_timedwrlock)(pthread_rwlock_t *rwlock,
+	const struct timespec *abstime)
+{
+	return reeact_policy_pthread_rwlock_timedwrlock((void*)rwlock,
+							(void*)abstime);
+}
+
+int REEACT_HOOK(pthread_rwlock_unlock)(pthread_rwlock_t *rwlock)
+{
+	return reeact_policy_pthread_rwlock_unlock((void*)rwlock);
+}
@@ -0,0 +1,51 @@
+/*
+ * Implementation of the POSIX semaphore functions that replace the ones in 
+ * the pthread library. Named semaphores are opened and closed by the original
+ * sem_open and sem_close; they share the layout of unnamed semaphores and are
+ * operated by the functions here.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#include <semaphore.h>
+
+#include "../policies/reeact_policy.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "pthread_hooks.h"
+
+int REEACT_HOOK(sem_init)(sem_t *sem, int pshared, unsigned int value)
+{
+	reeact_sidetable_remove((void*)sem);
+	return reeact_policy_sem_init((void*)sem, pshared, value);
+}
+
+int REEACT_HOOK(sem_destroy)(sem_t *sem)
+{
+	reeact_sidetable_remove((void*)sem);
+	return reeact_policy_sem_destroy((void*)sem);
+}
+
+int REEACT_HOOK(sem_wait)(sem_t *sem)
+{
+	return reeact_policy_sem_wait((void*)sem);
+}
+
+int REEACT_HOOK(sem_trywait)(sem_t *sem)
+{
+	return reeact_policy_sem_trywait((void*)sem);
+}
+
+int REEACT_HOOK(sem_timedwait)(sem_t *sem, const struct timespec *abstime)
+{
+	return reeact_policy_sem_timedwait((void*)sem, (void*)abstime);
+}
+
+int REEACT_HOOK(sem_post)(sem_t *sem)
+{
+	return reeact_policy_sem_post((void*)sem);
+}
+
+int REEACT_HOOK(sem_getvalue)(sem_t *sem, int *sval)
+{
+	return reeact_policy_sem_getvalue((void*)sem, sval);
+}
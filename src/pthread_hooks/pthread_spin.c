@@ -0,0 +1,38 @@
+/*
+ * Implementation of the spinlock functions that replace pthread spinlock.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#include <pthread.h>
+
+#include "../policies/reeact_policy.h"
+#include "../sidetable/reeact_sidetable.h"
+#include "pthread_hooks.h"
+
+int REEACT_HOOK(pthread_spin_init)(pthread_spinlock_t *lock, int pshared)
+{
+	reeact_sidetable_remove((void*)lock);
+	return reeact_policy_pthread_spin_init((void*)lock, pshared);
+}
+
+int REEACT_HOOK(pthread_spin_destroy)(pthread_spinlock_t *lock)
+{
+	reeact_sidetable_remove((void*)lock);
+	return reeact_policy_pthread_spin_destroy((void*)lock);
+}
+
+int REEACT_HOOK(pthread_spin_lock)(pthread_spinlock_t *lock)
+{
+	return reeact_policy_pthread_spin_lock((void*)lock);
+}
+
+int REEACT_HOOK(pthread_spin_trylock)(pthread_spinlock_t *lock)
+{
+	return reeact_policy_pthread_spin_trylock((void*)lock);
+}
+
+int REEACT_HOOK(pthread_spin_unlock)(pthread_spinlock_t *lock)
+{
+	return reeact_policy_pthread_spin_unlock((void*)lock);
+}
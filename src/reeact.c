@@ -17,6 +17,12 @@
 #include "./pthread_hooks/pthread_hooks.h"
 #include "./hooks/gomp_hooks/gomp_hooks.h"
 #include "./policies/reeact_policy.h"
+#include "./fastsync/fastsync.h"
+#include "./control/reeact_control.h"
+#include "./threads/reeact_threads.h"
+#include "./threads/reeact_placement.h"
+#include "./threads/reeact_rebalance.h"
+#include "./threads/reeact_throttle.h"
 
 struct reeact_data *reeact_handle = NULL;
 
@@ -89,6 +95,73 @@ inline void reeact_log_topology(struct reeact_data *rh)
 #endif
 }
 
+/*
+ * Map the nodes to their sockets. 
+ */
+static void reeact_map_node_sockets(struct processor_topo *topo)
+{
+	int i, cnt = topo->socket_cnt * topo->node_cnt;
+	int max_id = -1;
+
+	if(topo->nodes == NULL)
+		return;
+
+	for(i = 0; i < cnt; i++)
+		if(topo->nodes[i] > max_id)
+			max_id = topo->nodes[i];
+	if(max_id < 0)
+		return;
+
+	topo->node_sockets = (int*)malloc(sizeof(int) * (max_id + 1));
+	if(topo->node_sockets == NULL){
+		LOGERRX("Unable to allocate memory for node sockets: ");
+		return;
+	}
+	for(i = 0; i <= max_id; i++)
+		topo->node_sockets[i] = -1;
+	for(i = 0; i < cnt; i++)
+		if(topo->nodes[i] >= 0)
+			topo->node_sockets[topo->nodes[i]] = 
+				i / topo->node_cnt;
+	topo->node_id_cnt = max_id + 1;
+
+	return;
+}
+
+/*
+ * Detect the processor topology and register the node of each cpu with the
+ * fastsync primitives. Reading the topology from sysfs is costly, so it is
+ * not done at initialization, but by the first pthread_create, or by the
+ * features that need it; single-threaded processes do not pay for it.
+ */
+static void reeact_load_topology(void)
+{
+	if(reeact_handle == NULL)
+		return;
+
+	reeact_get_topology(&(reeact_handle->topology.nodes), 
+			    &(reeact_handle->topology.cores),
+			    &(reeact_handle->topology.socket_cnt),
+			    &(reeact_handle->topology.node_cnt),
+			    &(reeact_handle->topology.core_cnt));
+	reeact_log_topology(reeact_handle);
+	reeact_map_node_sockets(&(reeact_handle->topology));
+	// let the fastsync primitives know the nodes of the cpus
+	if(reeact_get_cpu_node_map(&(reeact_handle->topology.cpu_nodes),
+				   &(reeact_handle->topology.cpu_cnt)) == 0){
+		fastsync_set_cpu_node_map(reeact_handle->topology.cpu_nodes,
+					  reeact_handle->topology.cpu_cnt,
+					  reeact_handle->topology.socket_cnt *
+					  reeact_handle->topology.node_cnt);
+		// the SMT siblings, for thread placement
+		reeact_get_cpu_core_map(&(reeact_handle->topology.cpu_cores),
+					reeact_handle->topology.cpu_nodes,
+					reeact_handle->topology.cpu_cnt);
+	}
+
+	return;
+}
+
 /*
  * initialization function for REEact
  */
@@ -96,6 +169,12 @@ __attribute__ ((__constructor__))
 void reeact_init(void) 
 {
 	int ret_val = 0;
+
+	if(!reeact_proc_selected()){
+		DPRINTF("%s is not selected, REEact is inactive\n",
+			program_invocation_short_name);
+		return;
+	}
 	
         DPRINTF("reeact initialization\n");
 
@@ -109,20 +188,27 @@ void reeact_init(void)
 
 	// per process initialization
 	reeact_per_proc_init(reeact_handle);
-	// determine processor topology
-	reeact_get_topology(&(reeact_handle->topology.nodes), 
-			    &(reeact_handle->topology.cores),
-			    &(reeact_handle->topology.socket_cnt),
-			    &(reeact_handle->topology.node_cnt),
-			    &(reeact_handle->topology.core_cnt));
-	reeact_log_topology(reeact_handle);
-		
+	// the processor topology is detected when it is first needed
+	fastsync_set_topology_loader(reeact_load_topology);
+
 	// pthread hooks initialization
 	ret_val = reeact_pthread_hooks_init((void*)reeact_handle);
 	if(ret_val != 0)
 		LOGERR("Error initializing pthread hooks with error %d\n",
 		       ret_val);
 
+	// register the main thread, before any policy looks for it
+	ret_val = reeact_threads_init((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error initializing thread records with error %d\n",
+		       ret_val);
+
+	// thread placement initialization
+	ret_val = reeact_placement_init((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error initializing thread placement with error %d\n",
+		       ret_val);
+
 	// gomp hooks initialization
 	ret_val = reeact_gomp_hooks_init((void*)reeact_handle);
 	if(ret_val != 0)
@@ -135,6 +221,24 @@ void reeact_init(void)
 		LOGERR("Error initializing user policy with error %d\n",
 		       ret_val);
 
+	// control socket initialization, after the policy is active
+	ret_val = reeact_control_init((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error initializing control socket with error %d\n",
+		       ret_val);
+
+	// rebalancing monitor, after the threads are registered
+	ret_val = reeact_rebalance_init((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error initializing rebalancing with error %d\n",
+		       ret_val);
+
+	// concurrency throttling, after the policy is active
+	ret_val = reeact_throttle_init((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error initializing throttling with error %d\n",
+		       ret_val);
+
 	return;
 }
 
@@ -146,8 +250,27 @@ void reeact_cleanup(void)
 {
 	int ret_val;
 
+	// nothing to clean up in a process that is not selected
+	if(reeact_handle == NULL)
+		return;
+
         DPRINTF("reeact cleanup\n");
 
+	ret_val = reeact_throttle_cleanup((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error cleaning up throttling with error %d\n",
+		       ret_val);
+
+	ret_val = reeact_rebalance_cleanup((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error cleaning up rebalancing with error %d\n",
+		       ret_val);
+
+	ret_val = reeact_control_cleanup((void*)reeact_handle);
+	if(ret_val != 0)
+		LOGERR("Error cleaning up control socket with error %d\n",
+		       ret_val);
+
 	ret_val = reeact_policy_cleanup((void*)reeact_handle);
 	if(ret_val != 0)
 		LOGERR("Error cleaning up pthread hooks with error %d\n",
@@ -158,8 +281,7 @@ void reeact_cleanup(void)
 		LOGERR("Error cleaning up user policy with error %d\n",
 		       ret_val);
 
-	if(reeact_handle != NULL)
-		free(reeact_handle);
+	free(reeact_handle);
 
 	return;
 }
@@ -21,6 +21,14 @@
  *    socket_cnt: the number of sockets
  *    node_cnt: the number of nodes per socket
  *    core_cnt: the number of cores per node
+ *    cpu_nodes: array of node ids indexed by cpu id (SMT contexts included),
+ *               -1 for offline cpus
+ *    cpu_cnt: the number of entries in cpu_nodes and cpu_cores
+ *    cpu_cores: array of core ids indexed by cpu id, a core being named by
+ *               its first SMT context; -1 for offline cpus
+ *    node_sockets: array of socket ids indexed by node id, -1 for node ids
+ *                  that are not in nodes
+ *    node_id_cnt: the number of entries in node_sockets
  */
 struct processor_topo{
 	int socket_cnt;
@@ -28,6 +36,11 @@ struct processor_topo{
 	int core_cnt;
 	int *nodes;
 	int *cores;
+	int cpu_cnt;
+	int *cpu_nodes;
+	int *cpu_cores;
+	int node_id_cnt;
+	int *node_sockets;
 };
 
 /*
@@ -38,8 +51,14 @@ struct reeact_data{
 	char *proc_name_short; // process name long
 	char *proc_name_long; // process base name (without path)
 	void *policy_data; // pointing to the user-specified policy data
-	struct processor_topo topology; // processor topology
+	struct processor_topo topology; // processor topology, detected on 
+	                                // first use, see fastsync_load_topology
 	
 };
 
+/*
+ * the REEact data of this process, NULL if REEact is not initialized
+ */
+extern struct reeact_data *reeact_handle;
+
 #endif
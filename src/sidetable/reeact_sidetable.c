@@ -0,0 +1,608 @@
+/*
+ * Implementation of the REEact side table.
+ *
+ * The table is an open-addressing hash table with linear probing. A slot has
+ * a key (the address of an object) and a pointer to the entry of the object.
+ * A key, once claimed with a compare-and-swap, stays in its slot for the life
+ * of the table; removing an object only clears the entry pointer, so the
+ * probe sequences never change and lookups need no locks. The same object
+ * re-uses its slot if it gets an entry again.
+ *
+ * When the claimed keys fill three quarters of the table, the table is
+ * replaced by a new one, which only has the keys with entries. The resizer
+ * freezes every slot of the old table by setting the lowest bit of the entry
+ * pointer (and turning empty keys into a frozen marker), so that inserts and
+ * removes on the old table fail and retry on the new table; lookups simply
+ * ignore the bit. Resizes are serialized by a spinlock, which readers never
+ * touch. The old table and removed entries are reclaimed with the epoch
+ * service, and lookups run in a read-side critical section.
+ *
+ * Entries come from per-node arenas, carved from chunks that are first
+ * touched by a thread on the node, so that the entry of an object ends up in
+ * the memory of the node that created it (under the default first-touch
+ * policy). Like epoch records, chunks are never returned to the system;
+ * reclaimed entries go back to the free list of their arena.
+ *
+ * Every thread caches its recent lookups. A global generation number,
+ * increased on every remove, invalidates all caches at once, so a cached
+ * entry is never used after it is removed. Removes are rare (objects are
+ * destroyed much less often than they are used), so the caches stay warm.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "reeact_sidetable.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../epoch/reeact_epoch.h"
+
+/*
+ * the number of slots of the first table, must be a power of 2
+ */
+#define REEACT_SIDETABLE_INIT_SLOTS 256
+
+/*
+ * the number of slots of the per-thread lookup cache, must be a power of 2
+ */
+#define REEACT_SIDETABLE_CACHE_SLOTS 8
+
+/*
+ * the maximum number of arenas; nodes beyond this share arenas
+ */
+#define REEACT_SIDETABLE_MAX_NODES 64
+
+/*
+ * the number of entries carved from the system at a time
+ */
+#define REEACT_SIDETABLE_CHUNK_ENTRIES 64
+
+/*
+ * the marker of a frozen empty key, and the frozen bit of an entry pointer
+ */
+#define REEACT_SIDETABLE_FROZEN_KEY ((void*)1)
+#define REEACT_SIDETABLE_FROZEN 1UL
+
+/*
+ * a slot of the table
+ */
+struct reeact_sidetable_slot{
+	void *key;
+	reeact_sidetable_entry *entry; // may have the frozen bit set
+};
+
+/*
+ * a table
+ *     mask: the number of slots minus one
+ *     used: the number of claimed keys
+ */
+struct reeact_sidetable{
+	unsigned long mask;
+	int used;
+	struct reeact_sidetable_slot slots[];
+};
+
+/*
+ * an arena of entries, on its own cache line
+ *     lock: protects the arena
+ *     free: reclaimed entries
+ *     chunk: the unused part of the current chunk
+ *     chunk_left: the number of entries left in the current chunk
+ */
+struct reeact_sidetable_arena{
+	fastsync_spinlock lock;
+	reeact_sidetable_entry *free;
+	reeact_sidetable_entry *chunk;
+	int chunk_left;
+	char padding[64 - sizeof(fastsync_spinlock) -
+		     2 * sizeof(reeact_sidetable_entry*) - sizeof(int)];
+};
+
+/*
+ * a cached lookup
+ */
+struct reeact_sidetable_cached{
+	void *obj;
+	reeact_sidetable_entry *entry;
+	unsigned long gen; // the generation number when the lookup is done
+};
+
+/*
+ * the current table, and the lock serializing resizes
+ */
+static struct reeact_sidetable *reeact_sidetable_cur = NULL;
+static fastsync_spinlock reeact_sidetable_resize_lock = {{0}};
+
+/*
+ * the number of entries in the table, and the generation number
+ */
+static int reeact_sidetable_live = 0;
+static unsigned long reeact_sidetable_gen = 0;
+
+static struct reeact_sidetable_arena
+reeact_sidetable_arenas[REEACT_SIDETABLE_MAX_NODES] __attribute__((aligned(64)));
+
+/*
+ * the lookup cache of current thread
+ */
+static __thread struct reeact_sidetable_cached
+reeact_sidetable_cache[REEACT_SIDETABLE_CACHE_SLOTS];
+
+static inline unsigned long reeact_sidetable_hash(void *obj)
+{
+	unsigned long a = (unsigned long)obj;
+
+	a ^= a >> 17;
+	a *= 0x9E3779B97F4A7C15UL;
+
+	return a ^ (a >> 29);
+}
+
+static inline struct reeact_sidetable_cached *reeact_sidetable_cache_of(
+	void *obj)
+{
+	unsigned long a = (unsigned long)obj;
+
+	return &(reeact_sidetable_cache[(a >> 4) &
+					(REEACT_SIDETABLE_CACHE_SLOTS - 1)]);
+}
+
+/*
+ * allocate an entry from the arena of current node
+ */
+static reeact_sidetable_entry *reeact_sidetable_entry_alloc()
+{
+	int node = fastsync_get_node() % REEACT_SIDETABLE_MAX_NODES;
+	struct reeact_sidetable_arena *a = &(reeact_sidetable_arenas[node]);
+	reeact_sidetable_entry *e;
+
+	fastsync_spin_lock(&(a->lock));
+	if(a->free != NULL){
+		e = a->free;
+		a->free = e->next;
+	}
+	else{
+		if(a->chunk_left == 0){
+			if(posix_memalign((void**)&(a->chunk), 64,
+					  REEACT_SIDETABLE_CHUNK_ENTRIES *
+					  sizeof(reeact_sidetable_entry))){
+				fastsync_spin_unlock(&(a->lock));
+				return NULL;
+			}
+			a->chunk_left = REEACT_SIDETABLE_CHUNK_ENTRIES;
+		}
+		e = a->chunk++;
+		a->chunk_left--;
+	}
+	fastsync_spin_unlock(&(a->lock));
+
+	/* the first touch of a new chunk places it on this node */
+	memset(e, 0, sizeof(reeact_sidetable_entry));
+	e->node = node;
+
+	return e;
+}
+
+/*
+ * release an entry to its arena
+ */
+static void reeact_sidetable_entry_release(void *data)
+{
+	reeact_sidetable_entry *e = (reeact_sidetable_entry*)data;
+	struct reeact_sidetable_arena *a = &(reeact_sidetable_arenas[e->node]);
+
+	if(e->destroy)
+		e->destroy(e);
+
+	fastsync_spin_lock(&(a->lock));
+	e->next = a->free;
+	a->free = e;
+	fastsync_spin_unlock(&(a->lock));
+
+	return;
+}
+
+/*
+ * allocate a table of cnt slots
+ */
+static struct reeact_sidetable *reeact_sidetable_alloc(unsigned long cnt)
+{
+	struct reeact_sidetable *t;
+	size_t size = sizeof(struct reeact_sidetable) +
+		cnt * sizeof(struct reeact_sidetable_slot);
+
+	if(posix_memalign((void**)&t, 64, size))
+		return NULL;
+	memset(t, 0, size);
+	t->mask = cnt - 1;
+
+	return t;
+}
+
+/*
+ * get the current table, creating the first one if there is none
+ */
+static struct reeact_sidetable *reeact_sidetable_get_table()
+{
+	struct reeact_sidetable *t = atomic_read(reeact_sidetable_cur);
+	struct reeact_sidetable *old;
+
+	if(t != NULL)
+		return t;
+
+	t = reeact_sidetable_alloc(REEACT_SIDETABLE_INIT_SLOTS);
+	if(t == NULL)
+		return NULL;
+	old = atomic_cmpxchg(&reeact_sidetable_cur, NULL, t);
+	if(old != NULL){
+		/* some one else has created the table */
+		free(t);
+		return old;
+	}
+
+	return t;
+}
+
+/*
+ * wait for the resize of a table to finish
+ */
+static inline void reeact_sidetable_wait_resize(struct reeact_sidetable *t)
+{
+	while(atomic_read(reeact_sidetable_cur) == t)
+		spinlock_hint();
+}
+
+/*
+ * Replace a full table with a new one. Called in a read-side critical
+ * section.
+ * Return value:
+ *     0: success, or some one else has replaced the table
+ *     ENOMEM: unable to allocate the new table
+ */
+static int reeact_sidetable_resize(struct reeact_sidetable *t)
+{
+	struct reeact_sidetable *new_t;
+	struct reeact_sidetable_slot *s;
+	reeact_sidetable_entry *e;
+	unsigned long i, j, cnt;
+	int live = 0;
+
+	fastsync_spin_lock(&reeact_sidetable_resize_lock);
+	if(atomic_read(reeact_sidetable_cur) != t){
+		fastsync_spin_unlock(&reeact_sidetable_resize_lock);
+		return 0;
+	}
+
+	/*
+	 * Allocate the new table before freezing the old one, so that a failed
+	 * allocation leaves the old table usable. The new table is at least as
+	 * large as the old one, so every entry of the old table fits; it grows
+	 * when the live entries would fill a quarter of it.
+	 */
+	cnt = t->mask + 1;
+	while(cnt < 4 * (unsigned long)(atomic_read(reeact_sidetable_live) + 1))
+		cnt *= 2;
+	new_t = reeact_sidetable_alloc(cnt);
+	if(new_t == NULL){
+		fastsync_spin_unlock(&reeact_sidetable_resize_lock);
+		LOGERR("Unable to allocate side table of %lu slots\n", cnt);
+		return ENOMEM;
+	}
+
+	/* freeze the slots, then nothing in the old table can change */
+	for(i = 0; i <= t->mask; i++){
+		s = &(t->slots[i]);
+		(void)atomic_cmpxchg(&(s->key), NULL,
+				     REEACT_SIDETABLE_FROZEN_KEY);
+		do{
+			e = atomic_read(s->entry);
+		}while(atomic_cmpxchg(&(s->entry), e, (reeact_sidetable_entry*)
+				      ((unsigned long)e |
+				       REEACT_SIDETABLE_FROZEN)) != e);
+		if(e != NULL)
+			live++;
+	}
+
+	/* the new table is private until published, no atomics needed */
+	for(i = 0; i <= t->mask; i++){
+		e = (reeact_sidetable_entry*)((unsigned long)t->slots[i].entry &
+					      ~REEACT_SIDETABLE_FROZEN);
+		if(e == NULL)
+			continue;
+		j = reeact_sidetable_hash(e->obj) & new_t->mask;
+		while(new_t->slots[j].key != NULL)
+			j = (j + 1) & new_t->mask;
+		new_t->slots[j].key = e->obj;
+		new_t->slots[j].entry = e;
+		new_t->used++;
+	}
+
+	(void)atomic_xchg(&reeact_sidetable_cur, new_t);
+	fastsync_spin_unlock(&reeact_sidetable_resize_lock);
+
+	DPRINTF("side table resized to %lu slots with %d entries\n", cnt,
+		live);
+
+	if(reeact_defer_free(t, NULL))
+		LOGERR("Unable to reclaim old side table %p\n", t);
+
+	return 0;
+}
+
+/*
+ * Find the slot of an object in a table. Called in a read-side critical
+ * section.
+ * Return value:
+ *     the slot of the object; NULL if the object is not in the table
+ *     REEACT_SIDETABLE_FROZEN_KEY: the table is being resized
+ */
+static struct reeact_sidetable_slot *reeact_sidetable_find(
+	struct reeact_sidetable *t, void *obj)
+{
+	struct reeact_sidetable_slot *s;
+	unsigned long i, n;
+	void *key;
+
+	i = reeact_sidetable_hash(obj) & t->mask;
+	for(n = 0; n <= t->mask; n++, i = (i + 1) & t->mask){
+		s = &(t->slots[i]);
+		key = atomic_read(s->key);
+		if(key == obj)
+			return s;
+		if(key == NULL)
+			return NULL;
+		if(key == REEACT_SIDETABLE_FROZEN_KEY)
+			return (struct reeact_sidetable_slot*)
+				REEACT_SIDETABLE_FROZEN_KEY;
+	}
+
+	return NULL;
+}
+
+/*
+ * find the entry of an object
+ */
+reeact_sidetable_entry *reeact_sidetable_lookup(void *obj)
+{
+	struct reeact_sidetable_cached *c;
+	struct reeact_sidetable *t;
+	struct reeact_sidetable_slot *s;
+	reeact_sidetable_entry *e = NULL;
+	unsigned long gen;
+
+	if(atomic_read(reeact_sidetable_live) == 0)
+		return NULL;
+
+	gen = atomic_read(reeact_sidetable_gen);
+	c = reeact_sidetable_cache_of(obj);
+	if(c->obj == obj && c->gen == gen)
+		return c->entry;
+
+	if(reeact_read_lock())
+		return NULL;
+	/* read the generation before the slot, see reeact_sidetable_remove */
+	gcc_barrier();
+	t = atomic_read(reeact_sidetable_cur);
+	if(t != NULL){
+		s = reeact_sidetable_find(t, obj);
+		/*
+		 * a frozen empty key was empty when frozen, so the object is
+		 * not in the table; frozen entries are still valid
+		 */
+		if(s != NULL && s != (struct reeact_sidetable_slot*)
+		   REEACT_SIDETABLE_FROZEN_KEY)
+			e = (reeact_sidetable_entry*)
+				((unsigned long)atomic_read(s->entry) &
+				 ~REEACT_SIDETABLE_FROZEN);
+	}
+	reeact_read_unlock();
+
+	if(e != NULL){
+		c->obj = obj;
+		c->entry = e;
+		c->gen = gen;
+	}
+
+	return e;
+}
+
+/*
+ * Remove the entry in a slot. Called in a read-side critical section.
+ * Return value:
+ *     the removed entry, which the caller should reclaim; NULL if the entry
+ *     has changed
+ */
+static reeact_sidetable_entry *reeact_sidetable_unlink(
+	struct reeact_sidetable_slot *s, reeact_sidetable_entry *e)
+{
+	if(atomic_cmpxchg(&(s->entry), e, NULL) != e)
+		return NULL;
+
+	/* invalidate the cached lookups */
+	atomic_addf(&reeact_sidetable_live, -1);
+	atomic_addf(&reeact_sidetable_gen, 1);
+
+	return e;
+}
+
+/*
+ * reclaim a removed entry after a grace period; called outside read-side
+ * critical sections
+ */
+static void reeact_sidetable_reclaim(reeact_sidetable_entry *e)
+{
+	if(reeact_defer_free(e, reeact_sidetable_entry_release) == 0)
+		return;
+
+	/* no reclamation thread, wait for the grace period here */
+	reeact_synchronize();
+	reeact_sidetable_entry_release(e);
+
+	return;
+}
+
+/*
+ * find or create the entry of an object
+ */
+int reeact_sidetable_get(void *obj, int type,
+			 int (*init)(reeact_sidetable_entry *entry, void *arg),
+			 void *arg, reeact_sidetable_entry **entry)
+{
+	struct reeact_sidetable *t;
+	struct reeact_sidetable_slot *s;
+	reeact_sidetable_entry *e, *new_e = NULL, *stale = NULL;
+	unsigned long i, n;
+	void *key;
+	int ret_val = 0;
+
+	e = reeact_sidetable_lookup(obj);
+	if(e != NULL && e->type == type){
+		*entry = e;
+		return 0;
+	}
+
+	if(reeact_read_lock())
+		return ENOMEM;
+
+ retry:
+	t = reeact_sidetable_get_table();
+	if(t == NULL){
+		ret_val = ENOMEM;
+		goto out;
+	}
+
+	i = reeact_sidetable_hash(obj) & t->mask;
+	for(n = 0; n <= t->mask; n++, i = (i + 1) & t->mask){
+		s = &(t->slots[i]);
+		key = atomic_read(s->key);
+		if(key == NULL){
+			if((atomic_read(t->used) + 1) * 4 >
+			   (int)(t->mask + 1) * 3)
+				break; // full, resize
+			key = atomic_cmpxchg(&(s->key), NULL, obj);
+			if(key == NULL){
+				atomic_addf(&(t->used), 1);
+				key = obj;
+			}
+		}
+		if(key == REEACT_SIDETABLE_FROZEN_KEY){
+			reeact_sidetable_wait_resize(t);
+			goto retry;
+		}
+		if(key != obj)
+			continue;
+
+		/* the slot of the object */
+		while(1){
+			e = atomic_read(s->entry);
+			if((unsigned long)e & REEACT_SIDETABLE_FROZEN){
+				reeact_sidetable_wait_resize(t);
+				goto retry;
+			}
+			if(e != NULL && e->type == type){
+				/* created by some one else */
+				*entry = e;
+				goto out;
+			}
+			if(e != NULL){
+				/* left by an old object at this address */
+				e = reeact_sidetable_unlink(s, e);
+				if(e != NULL){
+					e->next = stale;
+					stale = e;
+				}
+				continue;
+			}
+
+			if(new_e == NULL){
+				new_e = reeact_sidetable_entry_alloc();
+				if(new_e == NULL){
+					ret_val = ENOMEM;
+					goto out;
+				}
+				new_e->obj = obj;
+				new_e->type = type;
+				if(init && (ret_val = init(new_e, arg)) != 0)
+					goto out;
+			}
+			if(atomic_cmpxchg(&(s->entry), NULL, new_e) == NULL){
+				atomic_addf(&reeact_sidetable_live, 1);
+				*entry = new_e;
+				new_e = NULL;
+				goto out;
+			}
+		}
+	}
+
+	/* no free slot in the table */
+	ret_val = reeact_sidetable_resize(t);
+	if(ret_val == 0)
+		goto retry;
+
+ out:
+	reeact_read_unlock();
+
+	/* the unpublished entry is only seen by this thread */
+	if(new_e != NULL)
+		reeact_sidetable_entry_release(new_e);
+	while(stale != NULL){
+		e = stale;
+		stale = e->next;
+		reeact_sidetable_reclaim(e);
+	}
+
+	return ret_val;
+}
+
+/*
+ * remove the entry of an object
+ */
+int reeact_sidetable_remove(void *obj)
+{
+	struct reeact_sidetable *t;
+	struct reeact_sidetable_slot *s;
+	reeact_sidetable_entry *e = NULL;
+
+	if(atomic_read(reeact_sidetable_live) == 0)
+		return ENOENT;
+
+	if(reeact_read_lock())
+		return ENOENT;
+
+ retry:
+	t = atomic_read(reeact_sidetable_cur);
+	s = t ? reeact_sidetable_find(t, obj) : NULL;
+	if(s == (struct reeact_sidetable_slot*)REEACT_SIDETABLE_FROZEN_KEY){
+		reeact_sidetable_wait_resize(t);
+		goto retry;
+	}
+	if(s != NULL){
+		e = atomic_read(s->entry);
+		if((unsigned long)e & REEACT_SIDETABLE_FROZEN){
+			reeact_sidetable_wait_resize(t);
+			goto retry;
+		}
+		if(e != NULL && reeact_sidetable_unlink(s, e) == NULL)
+			goto retry;
+	}
+
+	reeact_read_unlock();
+
+	if(e == NULL)
+		return ENOENT;
+
+	reeact_sidetable_reclaim(e);
+
+	return 0;
+}
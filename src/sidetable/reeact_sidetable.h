@@ -0,0 +1,92 @@
+/*
+ * Header file of the REEact side table. The side table keeps the state of a
+ * synchronization object that does not fit in the object itself, e.g., the
+ * per-node parts of a tree barrier or the statistics of an object, keyed by
+ * the address of the object. Lookups are lock-free and usually hit a small
+ * per-thread cache; entries are allocated from an arena of the node of the
+ * thread that creates them.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_SIDETABLE_H__
+#define __REEACT_SIDETABLE_H__
+
+/*
+ * the size of an entry, two cache lines
+ */
+#define REEACT_SIDETABLE_ENTRY_SIZE 128
+
+/*
+ * the types of entries
+ *     EVENTS: the state of a barrier observed by the event API
+ */
+#define REEACT_SIDETABLE_EVENTS 1
+
+/*
+ * An entry of the side table.
+ *     obj: the object the entry belongs to
+ *     destroy: releases the resources held by data before the entry is
+ *              reclaimed; may be NULL
+ *     type: the type of the entry, set by its creator; an entry of another
+ *           type left by an object that used to be at the same address is
+ *           replaced
+ *     node: the node of the arena the entry is allocated from
+ *     next: used by the arena only
+ *     data: the state of the object, zero-filled when the entry is created
+ */
+typedef struct _reeact_sidetable_entry{
+	void *obj;
+	void (*destroy)(struct _reeact_sidetable_entry *entry);
+	int type;
+	int node;
+	struct _reeact_sidetable_entry *next;
+	char data[REEACT_SIDETABLE_ENTRY_SIZE - 2 * sizeof(void*) -
+		  2 * sizeof(int) - sizeof(void*)] __attribute__((aligned(8)));
+}reeact_sidetable_entry;
+
+/*
+ * Find the entry of an object.
+ * Input parameters:
+ *     obj: the address of the object
+ * Return value:
+ *     the entry of the object; NULL if the object has no entry
+ */
+reeact_sidetable_entry *reeact_sidetable_lookup(void *obj);
+
+/*
+ * Find the entry of an object, creating it if the object has no entry of the
+ * given type. A new entry is initialized by the init function before it is
+ * visible to other threads; if several threads create the entry at the same
+ * time, only one entry is kept and the others are discarded (with their
+ * destroy functions called).
+ * Input parameters:
+ *     obj: the address of the object
+ *     type: the type of the entry
+ *     init: the function to initialize a new entry, may be NULL; a non-zero
+ *           return value aborts the creation and is returned to the caller
+ *     arg: the argument of the init function
+ * Output parameters:
+ *     entry: the entry of the object
+ * Return value:
+ *     0: success
+ *     ENOMEM: unable to allocate the entry or the table
+ *     other: error returned by the init function
+ */
+int reeact_sidetable_get(void *obj, int type,
+			 int (*init)(reeact_sidetable_entry *entry, void *arg),
+			 void *arg, reeact_sidetable_entry **entry);
+
+/*
+ * Remove the entry of an object, e.g., when the object is destroyed or
+ * initialized again. The entry is reclaimed after the threads that may still
+ * be looking it up are done.
+ * Input parameters:
+ *     obj: the address of the object
+ * Return value:
+ *     0: success
+ *     ENOENT: the object has no entry
+ */
+int reeact_sidetable_remove(void *obj);
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * Implementation of the REEact thread placement policies.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <common_toolx.h>
+
+#include "reeact_placement.h"
+#include "reeact_threads.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+int reeact_placement = REEACT_PLACEMENT_NONE;
+
+/*
+ * the cpus of list placement, as given in REEACT_PLACEMENT
+ */
+static char *reeact_placement_list = NULL;
+
+/*
+ * the cpus of the threads: thread i is placed on slot i mod slot_cnt
+ */
+static cpu_set_t *reeact_placement_slots = NULL;
+static int reeact_placement_slot_cnt = 0;
+static pthread_once_t reeact_placement_once = PTHREAD_ONCE_INIT;
+
+/*
+ * a cpu and where it is in the topology
+ *     cpu: the cpu id
+ *     socket: the socket of the cpu
+ *     node_pos: the position of its node in topology.nodes
+ *     core_pos: the position of its core in the cores of the node
+ *     smt: the position of the cpu among the SMT contexts of its core
+ *     rank: the position of the cpu among the cpus of its socket with the
+ *           same smt, for scatter
+ */
+struct reeact_placement_cpu{
+	int cpu;
+	int socket;
+	int node_pos;
+	int core_pos;
+	int smt;
+	int rank;
+};
+
+/*
+ * the compact order: sockets, nodes, cores, then SMT contexts
+ */
+static int reeact_placement_cmp_compact(const void *a, const void *b)
+{
+	const struct reeact_placement_cpu *x = a, *y = b;
+
+	if(x->node_pos != y->node_pos)
+		return x->node_pos - y->node_pos;
+	if(x->core_pos != y->core_pos)
+		return x->core_pos - y->core_pos;
+	return x->cpu - y->cpu;
+}
+
+/*
+ * the order of ranking within a socket: the first SMT contexts of all cores,
+ * then the second ones, and so on
+ */
+static int reeact_placement_cmp_socket(const void *a, const void *b)
+{
+	const struct reeact_placement_cpu *x = a, *y = b;
+
+	if(x->socket != y->socket)
+		return x->socket - y->socket;
+	if(x->smt != y->smt)
+		return x->smt - y->smt;
+	return reeact_placement_cmp_compact(a, b);
+}
+
+/*
+ * the scatter order: round-robin across the sockets
+ */
+static int reeact_placement_cmp_scatter(const void *a, const void *b)
+{
+	const struct reeact_placement_cpu *x = a, *y = b;
+
+	if(x->smt != y->smt)
+		return x->smt - y->smt;
+	if(x->rank != y->rank)
+		return x->rank - y->rank;
+	return x->socket - y->socket;
+}
+
+/*
+ * Find the cpus the process may run on, in the compact order.
+ * Return value:
+ *     the number of cpus in list; 0 if the topology is not known
+ */
+static int reeact_placement_topo_cpus(struct reeact_placement_cpu **list)
+{
+	struct processor_topo *topo;
+	struct reeact_placement_cpu *cpus;
+	cpu_set_t allowed;
+	int node_total, cnt = 0;
+	int c, i, node, core;
+
+	*list = NULL;
+	if(reeact_handle == NULL || fastsync_load_topology() != 0)
+		return 0;
+	topo = &(reeact_handle->topology);
+	if(topo->cpu_nodes == NULL || topo->nodes == NULL ||
+	   topo->cores == NULL)
+		return 0;
+	node_total = topo->socket_cnt * topo->node_cnt;
+
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		return 0;
+
+	cpus = (struct reeact_placement_cpu*)calloc(topo->cpu_cnt,
+						    sizeof(*cpus));
+	if(cpus == NULL)
+		return 0;
+
+	for(c = 0; c < topo->cpu_cnt && c < CPU_SETSIZE; c++){
+		node = topo->cpu_nodes[c];
+		if(node < 0 || node >= node_total || !CPU_ISSET(c, &allowed))
+			continue;
+		cpus[cnt].cpu = c;
+		cpus[cnt].node_pos = -1;
+		for(i = 0; i < node_total; i++)
+			if(topo->nodes[i] == node)
+				cpus[cnt].node_pos = i;
+		if(cpus[cnt].node_pos == -1)
+			continue;
+		cpus[cnt].socket = cpus[cnt].node_pos / topo->node_cnt;
+		/* cores not in the topology go after the others */
+		core = c;
+		if(topo->cpu_cores != NULL && topo->cpu_cores[c] >= 0)
+			core = topo->cpu_cores[c];
+		cpus[cnt].core_pos = topo->core_cnt + core;
+		for(i = 0; i < topo->core_cnt; i++)
+			if(topo->cores[node * topo->core_cnt + i] == core)
+				cpus[cnt].core_pos = i;
+		cnt++;
+	}
+
+	qsort(cpus, cnt, sizeof(*cpus), reeact_placement_cmp_compact);
+	for(i = 1; i < cnt; i++)
+		if(cpus[i].node_pos == cpus[i-1].node_pos &&
+		   cpus[i].core_pos == cpus[i-1].core_pos)
+			cpus[i].smt = cpus[i-1].smt + 1;
+
+	*list = cpus;
+
+	return cnt;
+}
+
+/*
+ * Compute the cpus of the threads.
+ */
+static void reeact_placement_build(void)
+{
+	struct reeact_placement_cpu *cpus = NULL;
+	cpu_set_t allowed, *slot;
+	int cnt = 0, *ids = NULL;
+	char *buf;
+	int i;
+
+	if(reeact_placement == REEACT_PLACEMENT_LIST){
+		buf = strdup(reeact_placement_list);
+		if(buf == NULL || parse_value_list_expand(buf, (void**)&ids,
+							  &cnt, 0) != 0 ||
+		   sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			cnt = 0;
+		free(buf);
+	}
+	else
+		cnt = reeact_placement_topo_cpus(&cpus);
+	if(cnt == 0){
+		LOGERR("No cpus to place threads on, threads are not placed\n");
+		goto cleanup;
+	}
+
+	reeact_placement_slots = (cpu_set_t*)calloc(cnt, sizeof(cpu_set_t));
+	if(reeact_placement_slots == NULL){
+		LOGERRX("Unable to allocate memory for thread placement: ");
+		goto cleanup;
+	}
+
+	switch(reeact_placement){
+	case REEACT_PLACEMENT_LIST:
+		for(i = 0; i < cnt; i++){
+			if(ids[i] < 0 || ids[i] >= CPU_SETSIZE ||
+			   !CPU_ISSET(ids[i], &allowed)){
+				LOGERR("Cpu %d is not available for placement"
+				       "\n", ids[i]);
+				continue;
+			}
+			slot = &(reeact_placement_slots[
+					 reeact_placement_slot_cnt++]);
+			CPU_SET(ids[i], slot);
+		}
+		break;
+	case REEACT_PLACEMENT_SCATTER:
+		qsort(cpus, cnt, sizeof(*cpus), reeact_placement_cmp_socket);
+		for(i = 1; i < cnt; i++)
+			if(cpus[i].socket == cpus[i-1].socket &&
+			   cpus[i].smt == cpus[i-1].smt)
+				cpus[i].rank = cpus[i-1].rank + 1;
+		qsort(cpus, cnt, sizeof(*cpus),
+		      reeact_placement_cmp_scatter);
+		/* fall through */
+	case REEACT_PLACEMENT_COMPACT:
+		for(i = 0; i < cnt; i++)
+			CPU_SET(cpus[i].cpu, &(reeact_placement_slots[i]));
+		reeact_placement_slot_cnt = cnt;
+		break;
+	case REEACT_PLACEMENT_NODE:
+		/* one slot per node, the cpus are grouped by node */
+		for(i = 0; i < cnt; i++){
+			if(i > 0 && cpus[i].node_pos != cpus[i-1].node_pos)
+				reeact_placement_slot_cnt++;
+			slot = &(reeact_placement_slots[
+					 reeact_placement_slot_cnt]);
+			CPU_SET(cpus[i].cpu, slot);
+		}
+		reeact_placement_slot_cnt++;
+		break;
+	default:
+		break;
+	}
+
+	DPRINTF("threads are placed on %d sets of cpus\n",
+		reeact_placement_slot_cnt);
+
+ cleanup:
+	if(cpus != NULL)
+		free(cpus);
+	if(ids != NULL)
+		free(ids);
+
+	return;
+}
+
+/*
+ * read the placement policy
+ */
+int reeact_placement_init(void *data)
+{
+	const char *placement = getenv(REEACT_PLACEMENT_ENV);
+
+	if(placement == NULL || *placement == '\0')
+		return 0;
+
+	if(strcmp(placement, "compact") == 0)
+		reeact_placement = REEACT_PLACEMENT_COMPACT;
+	else if(strcmp(placement, "scatter") == 0)
+		reeact_placement = REEACT_PLACEMENT_SCATTER;
+	else if(strcmp(placement, "node") == 0)
+		reeact_placement = REEACT_PLACEMENT_NODE;
+	else if(strncmp(placement, "list:", 5) == 0 && placement[5] != '\0'){
+		reeact_placement_list = strdup(placement + 5);
+		if(reeact_placement_list == NULL){
+			LOGERRX("Unable to allocate memory for cpu list: ");
+			return 1;
+		}
+		reeact_placement = REEACT_PLACEMENT_LIST;
+	}
+	else{
+		LOGERR("Unknown %s %s, threads are not placed\n",
+		       REEACT_PLACEMENT_ENV, placement);
+		return 1;
+	}
+
+	DPRINTF("placing threads with %s\n", placement);
+
+	return 0;
+}
+
+/*
+ * get the cpus of a thread
+ */
+int reeact_placement_cpus(int index, cpu_set_t *cpuset)
+{
+	if(reeact_placement == REEACT_PLACEMENT_NONE || index < 0)
+		return 1;
+
+	pthread_once(&reeact_placement_once, reeact_placement_build);
+	if(reeact_placement_slot_cnt == 0)
+		return 1;
+
+	*cpuset = reeact_placement_slots[index % reeact_placement_slot_cnt];
+
+	return 0;
+}
+
+/*
+ * create a placed thread
+ */
+int reeact_placement_pthread_create(int mode, pthread_t *thread,
+				    const pthread_attr_t *attr,
+				    void *(*start_routine) (void *), void *arg)
+{
+	struct reeact_thread *rec;
+	pthread_attr_t place_attr;
+	cpu_set_t cpus, main_cpus, app_cpus;
+	int ret_val;
+
+	if(reeact_placement_cpus(reeact_threads_wrapped_index(start_routine,
+							      arg), &cpus))
+		return real_pthread_create(thread, attr, start_routine, arg);
+
+	/* the main thread, when it creates its first thread */
+	rec = reeact_threads_current();
+	if(rec != NULL && rec->index == 0 && !rec->placed &&
+	   reeact_placement_cpus(0, &main_cpus) == 0 &&
+	   reeact_threads_place(rec, mode, &main_cpus) != 0)
+		LOGERR("Unable to place the main thread\n");
+
+	/* the affinity the application gives the thread */
+	if(attr != NULL &&
+	   pthread_attr_getaffinity_np(attr, sizeof(app_cpus), &app_cpus) == 0
+	   && CPU_COUNT(&app_cpus) < CPU_SETSIZE)
+		return real_pthread_create(thread, attr, start_routine, arg);
+
+	/*
+	 * recorded for the trampoline, which also applies it if the
+	 * attributes are the application's
+	 */
+	reeact_threads_wrapped_place(start_routine, arg, mode, &cpus);
+	if(attr != NULL || pthread_attr_init(&place_attr) != 0)
+		return real_pthread_create(thread, attr, start_routine, arg);
+
+	if(real_pthread_attr_setaffinity_np(&place_attr, sizeof(cpus), 
+					    &cpus) == 0)
+		ret_val = real_pthread_create(thread, &place_attr,
+					      start_routine, arg);
+	else
+		ret_val = real_pthread_create(thread, attr, start_routine,
+					      arg);
+	pthread_attr_destroy(&place_attr);
+
+	return ret_val;
+}
@@ -0,0 +1,93 @@
+/*
+ * Header file of the REEact thread placement. When the REEACT_PLACEMENT
+ * environment variable is set, the built-in policies place each thread
+ * created with pthread_create on cpus chosen from its logical index (see
+ * reeact_threads.h) and the processor topology:
+ *     compact: thread i on the i-th cpu in the order of sockets, nodes, cores
+ *              and SMT contexts, i.e., the threads fill the SMT contexts of a
+ *              core, then the cores of a node, then the nodes of a socket;
+ *              for threads that synchronize often
+ *     scatter: thread i on a cpu of socket i mod S, round-robin across the
+ *              sockets, using one SMT context of each core before the
+ *              siblings; for threads that are bound by memory bandwidth
+ *     node: thread i on all the cpus of the (i mod N)-th node, balancing the
+ *           threads across the nodes and leaving the scheduler to balance
+ *           them within a node
+ *     list:CPUS: thread i on the i-th cpu of CPUS, a list such as "0,2,4-7"
+ * Once the cpus are used up, the threads wrap around. The main thread, whose
+ * index is 0, is placed when it creates its first thread.
+ *
+ * The placement is set in the attributes of the thread with
+ * pthread_attr_setaffinity_np, so the thread starts on its cpus. When the
+ * application passes its own attributes, they are left untouched, and the
+ * thread is placed by its trampoline before its start routine runs. A thread
+ * whose attributes already carry an affinity is not placed. The placement is
+ * kept in the record of the thread, and affinity requests of the application
+ * are then treated according to the affinity mode of the policy (see
+ * REEACT_AFFINITY in reeact_threads.h).
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_PLACEMENT_H__
+#define __REEACT_PLACEMENT_H__
+
+#include <sched.h>
+#include <pthread.h>
+
+#define REEACT_PLACEMENT_ENV "REEACT_PLACEMENT"
+
+/*
+ * the placement policies
+ */
+#define REEACT_PLACEMENT_NONE 0
+#define REEACT_PLACEMENT_COMPACT 1
+#define REEACT_PLACEMENT_SCATTER 2
+#define REEACT_PLACEMENT_NODE 3
+#define REEACT_PLACEMENT_LIST 4
+
+/*
+ * the placement policy in use
+ */
+extern int reeact_placement;
+
+/*
+ * Read the placement policy from REEACT_PLACEMENT. The cpus of the threads
+ * are computed when the first thread is created, as the topology is only
+ * detected when it is first needed.
+ * Input parameters:
+ *     data: the data used by the user policy. By default a pointer to the
+ *           "struct reeact_data" is passed.
+ * Return value:
+ *     0: success, or REEACT_PLACEMENT is not set
+ *     1: REEACT_PLACEMENT is not valid, threads are not placed
+ */
+int reeact_placement_init(void *data);
+
+/*
+ * Get the cpus of a thread.
+ * Input parameters:
+ *     index: the logical index of the thread
+ * Output parameters:
+ *     cpuset: the cpus of the thread
+ * Return value:
+ *     0: success
+ *     1: threads are not placed
+ */
+int reeact_placement_cpus(int index, cpu_set_t *cpuset);
+
+/*
+ * Create a thread, placing it according to the placement policy; for the
+ * pthread_create hooks of the policies.
+ * Input parameters:
+ *     mode: the affinity mode of the policy, REEACT_AFFINITY_*
+ *     others: same as pthread_create, start_routine and arg as wrapped by
+ *             reeact_threads_wrap
+ * Return value:
+ *     same as pthread_create
+ */
+int reeact_placement_pthread_create(int mode, pthread_t *thread,
+				    const pthread_attr_t *attr,
+				    void *(*start_routine) (void *), void *arg);
+
+#endif
@@ -0,0 +1,600 @@
+/*
+ * Implementation of the REEact rebalancing monitor.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "reeact_rebalance.h"
+#include "reeact_threads.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../events/reeact_events.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+/*
+ * the period in milliseconds, and whether the moves are logged
+ */
+static int reeact_rebalance_period = 0;
+static int reeact_rebalance_log = 1;
+static int reeact_rebalance_stop = 0;
+
+/*
+ * the cpus the process may run on
+ */
+static cpu_set_t reeact_rebalance_allowed;
+
+/*
+ * the barrier skew since the last period, from the event subscriber
+ */
+static unsigned long long reeact_rebalance_skew = 0;
+static unsigned long reeact_rebalance_episodes = 0;
+
+/*
+ * the samples of a cpu
+ *     busy, total: the busy and total time in /proc/stat, in ticks
+ *     load: the busy ratio of the last period
+ *     demand: the load plus the wait ratio of our threads on the cpu
+ *     node: the node of the cpu, -1 if not known
+ */
+struct reeact_rebalance_cpu{
+	unsigned long long busy;
+	unsigned long long total;
+	double load;
+	double demand;
+	int node;
+};
+static struct reeact_rebalance_cpu reeact_rebalance_cpus[CPU_SETSIZE];
+
+/*
+ * the samples of a thread
+ *     rec, tid: the record of the thread, and its tid when sampled
+ *     run, runq, sync: the run time, the time waiting for a cpu, and the time
+ *                      waiting on synchronization, in nanoseconds
+ *     sampled: 1 once the ratios have been computed
+ *     busy, wait, sync_ratio: the ratios of the last period
+ *     cpu: the cpu the thread runs on, -1 if not known
+ *     cooldown: the periods before the thread may move again
+ *     seen: 1 if the thread was found in the last sampling
+ */
+struct reeact_rebalance_thread{
+	struct reeact_thread *rec;
+	int tid;
+	unsigned long long run;
+	unsigned long long runq;
+	unsigned long long sync;
+	int sampled;
+	double busy;
+	double wait;
+	double sync_ratio;
+	int cpu;
+	int cooldown;
+	int seen;
+};
+static struct reeact_rebalance_thread *reeact_rebalance_threads = NULL;
+static int reeact_rebalance_thread_cnt = 0;
+static int reeact_rebalance_thread_size = 0;
+
+/*
+ * the periods the conditions of the moves have held
+ */
+static int reeact_rebalance_load_streak = 0;
+static int reeact_rebalance_node_streak = 0;
+
+/*
+ * count the barrier skew
+ */
+static void reeact_rebalance_event(const struct reeact_event *event,
+				   void *data)
+{
+	if(event->type != REEACT_EVENT_BARRIER_DONE)
+		return;
+
+	atomic_addf(&reeact_rebalance_skew, event->value);
+	atomic_addf(&reeact_rebalance_episodes, 1);
+
+	return;
+}
+
+/*
+ * Sample the load of the cpus from /proc/stat.
+ */
+static void reeact_rebalance_sample_cpus(void)
+{
+	struct reeact_rebalance_cpu *c;
+	unsigned long long user, nice, system, idle, iowait, irq, softirq;
+	unsigned long long steal, busy, total;
+	char line[512];
+	FILE *fp;
+	int cpu;
+
+	fp = fopen("/proc/stat", "r");
+	if(fp == NULL)
+		return;
+
+	while(fgets(line, sizeof(line), fp) != NULL){
+		steal = 0;
+		if(sscanf(line, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu",
+			  &cpu, &user, &nice, &system, &idle, &iowait, &irq,
+			  &softirq, &steal) < 8)
+			continue;
+		if(cpu < 0 || cpu >= CPU_SETSIZE)
+			continue;
+		c = &(reeact_rebalance_cpus[cpu]);
+		busy = user + nice + system + irq + softirq + steal;
+		total = busy + idle + iowait;
+		c->load = 0;
+		if(c->total != 0 && total > c->total)
+			c->load = (double)(busy - c->busy) / (total - c->total);
+		c->busy = busy;
+		c->total = total;
+	}
+	fclose(fp);
+
+	return;
+}
+
+/*
+ * Read the run time and the time waiting for a cpu of a thread, and the cpu
+ * it runs on, from /proc.
+ * Return value:
+ *     0: success
+ *     1: the thread is gone
+ */
+static int reeact_rebalance_read_thread(int tid, unsigned long long *run,
+					unsigned long long *runq, int *cpu)
+{
+	char path[64], buf[1024], *p;
+	FILE *fp;
+	int i, len;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+	fp = fopen(path, "r");
+	if(fp == NULL)
+		return 1;
+	i = fscanf(fp, "%llu %llu", run, runq);
+	fclose(fp);
+	if(i != 2)
+		return 1;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+	fp = fopen(path, "r");
+	if(fp == NULL)
+		return 1;
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	if(len <= 0)
+		return 1;
+	buf[len] = '\0';
+
+	/* "processor" is the 39th field, the 37th after the command name */
+	*cpu = -1;
+	p = strrchr(buf, ')');
+	for(i = 0; p != NULL && i < 37; i++)
+		p = strchr(p + 1, ' ');
+	if(p != NULL)
+		*cpu = atoi(p + 1);
+
+	return 0;
+}
+
+/*
+ * Find the samples of a thread, adding them if it is new.
+ * Return value:
+ *     the samples; NULL if they cannot be allocated
+ */
+static struct reeact_rebalance_thread *reeact_rebalance_find(
+	struct reeact_thread *rec, int tid)
+{
+	struct reeact_rebalance_thread *t;
+	int i, size;
+
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(t->rec == rec && t->tid == tid)
+			return t;
+	}
+
+	if(reeact_rebalance_thread_cnt == reeact_rebalance_thread_size){
+		size = reeact_rebalance_thread_size * 2 + 16;
+		t = (struct reeact_rebalance_thread*)realloc(
+			reeact_rebalance_threads, sizeof(*t) * size);
+		if(t == NULL)
+			return NULL;
+		reeact_rebalance_threads = t;
+		reeact_rebalance_thread_size = size;
+	}
+
+	t = &(reeact_rebalance_threads[reeact_rebalance_thread_cnt++]);
+	memset(t, 0, sizeof(*t));
+	t->rec = rec;
+	t->tid = tid;
+
+	return t;
+}
+
+/*
+ * Sample the threads of the application.
+ */
+static void reeact_rebalance_sample_threads(unsigned long long period)
+{
+	struct reeact_rebalance_thread *t;
+	struct reeact_thread *rec;
+	unsigned long long run, runq, sync;
+	int tid, cpu, i, j;
+
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++)
+		reeact_rebalance_threads[i].seen = 0;
+
+	for(rec = reeact_threads_all(); rec != NULL; rec = rec->next){
+		tid = rec->tid;
+		if(!rec->in_use || rec->exited || rec->index < 0 || tid == 0)
+			continue;
+		if(reeact_rebalance_read_thread(tid, &run, &runq, &cpu))
+			continue;
+		t = reeact_rebalance_find(rec, tid);
+		if(t == NULL)
+			continue;
+		sync = rec->stats.lock_wait_ns + rec->stats.cond_wait_ns;
+		if(t->seen == 0 && t->run != 0){
+			t->busy = (double)(run - t->run) / period;
+			t->wait = (double)(runq - t->runq) / period;
+			t->sync_ratio = (double)(sync - t->sync) / period;
+			t->sampled = 1;
+		}
+		t->run = run;
+		t->runq = runq;
+		t->sync = sync;
+		t->cpu = (cpu >= 0 && cpu < CPU_SETSIZE) ? cpu : -1;
+		t->seen = 1;
+		if(t->cooldown > 0)
+			t->cooldown--;
+	}
+
+	/* forget the threads that have exited */
+	for(i = j = 0; i < reeact_rebalance_thread_cnt; i++)
+		if(reeact_rebalance_threads[i].seen)
+			reeact_rebalance_threads[j++] =
+				reeact_rebalance_threads[i];
+	reeact_rebalance_thread_cnt = j;
+
+	return;
+}
+
+/*
+ * check if a thread may be moved
+ */
+static int reeact_rebalance_movable(struct reeact_rebalance_thread *t)
+{
+	return t->sampled && t->cpu >= 0 && t->cooldown == 0 &&
+		!t->rec->app_pinned;
+}
+
+/*
+ * Move a thread to a cpu.
+ * Return value:
+ *     0: success
+ *     1: the thread cannot be moved
+ */
+static int reeact_rebalance_move(struct reeact_rebalance_thread *t, int cpu,
+				 const char *reason, double skew)
+{
+	struct reeact_thread *rec = t->rec;
+	cpu_set_t cpuset;
+	int from = t->cpu;
+	int ret_val;
+
+	/* the thread may have exited since it was sampled */
+	if(!rec->in_use || rec->exited || rec->tid != t->tid)
+		return 1;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	ret_val = reeact_threads_place(rec, REEACT_AFFINITY_HONOR, &cpuset);
+	if(ret_val == ESRCH) // exited after the check
+		return 1;
+	if(ret_val){
+		LOGERR("Unable to move thread %d to cpu %d: %s\n", t->tid, cpu,
+		       strerror(ret_val));
+		return 1;
+	}
+
+	dprintf(reeact_rebalance_log, "%s: thread %d (index %d) from cpu %d "
+		"(node %d, demand %.2f) to cpu %d (node %d, demand %.2f); "
+		"busy %.2f, waiting for cpu %.2f, on sync %.2f, %lu "
+		"migrations, barrier skew %.1f%%\n", reason, t->tid,
+		rec->index, from, reeact_rebalance_cpus[from].node,
+		reeact_rebalance_cpus[from].demand, cpu,
+		reeact_rebalance_cpus[cpu].node,
+		reeact_rebalance_cpus[cpu].demand, t->busy, t->wait,
+		t->sync_ratio, rec->stats.migrations, skew * 100);
+
+	reeact_rebalance_cpus[from].demand -= t->wait;
+	reeact_rebalance_cpus[cpu].demand += t->busy;
+	t->cpu = cpu;
+	t->cooldown = REEACT_REBALANCE_COOLDOWN;
+
+	return 0;
+}
+
+/*
+ * Move a thread off the cpu with the highest demand.
+ * Return value:
+ *     1: a thread is moved
+ *     0: otherwise
+ */
+static int reeact_rebalance_load(double skew)
+{
+	struct reeact_rebalance_cpu *cpus = reeact_rebalance_cpus;
+	struct reeact_rebalance_thread *t, *victim = NULL;
+	double score, best = 0;
+	int src = -1, dst = -1;
+	int i;
+
+	/* the busiest cpu with a thread to move */
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(reeact_rebalance_movable(t) &&
+		   (src == -1 || cpus[t->cpu].demand > cpus[src].demand))
+			src = t->cpu;
+	}
+	if(src == -1)
+		goto stable;
+
+	/* the idlest cpu, preferring the node of src */
+	for(i = 0; i < CPU_SETSIZE; i++){
+		if(i == src || !CPU_ISSET(i, &reeact_rebalance_allowed))
+			continue;
+		score = cpus[i].demand;
+		if(cpus[i].node != cpus[src].node)
+			score += REEACT_REBALANCE_REMOTE;
+		if(dst == -1 || score < best){
+			dst = i;
+			best = score;
+		}
+	}
+	if(dst == -1 || cpus[src].demand - best < REEACT_REBALANCE_THRESHOLD)
+		goto stable;
+
+	if(++reeact_rebalance_load_streak < REEACT_REBALANCE_STABLE)
+		return 0;
+	reeact_rebalance_load_streak = 0;
+
+	/* the thread waiting the most for the cpu */
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(reeact_rebalance_movable(t) && t->cpu == src &&
+		   (victim == NULL || t->wait > victim->wait))
+			victim = t;
+	}
+
+	return reeact_rebalance_move(victim, dst, "load", skew) == 0;
+
+ stable:
+	reeact_rebalance_load_streak = 0;
+	return 0;
+}
+
+/*
+ * Move a thread waiting on synchronization to the node of most threads.
+ * Return value:
+ *     1: a thread is moved
+ *     0: otherwise
+ */
+static int reeact_rebalance_node(double skew)
+{
+	struct reeact_rebalance_cpu *cpus = reeact_rebalance_cpus;
+	struct reeact_rebalance_thread *t, *victim = NULL;
+	int counts[64] = {0};
+	int home = -1, dst = -1;
+	int node, i;
+
+	/* the node with most threads */
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(t->cpu < 0)
+			continue;
+		node = cpus[t->cpu].node;
+		if(node < 0 || node >= 64)
+			continue;
+		counts[node]++;
+		if(home == -1 || counts[node] > counts[home])
+			home = node;
+	}
+	if(home == -1)
+		goto stable;
+
+	/* the thread waiting the most on synchronization, away from home */
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(reeact_rebalance_movable(t) &&
+		   cpus[t->cpu].node != home &&
+		   t->sync_ratio >= REEACT_REBALANCE_SYNC &&
+		   (victim == NULL || t->sync_ratio > victim->sync_ratio))
+			victim = t;
+	}
+	if(victim == NULL)
+		goto stable;
+
+	/* an idle cpu at home */
+	for(i = 0; i < CPU_SETSIZE; i++){
+		if(!CPU_ISSET(i, &reeact_rebalance_allowed) ||
+		   cpus[i].node != home ||
+		   cpus[i].demand >= REEACT_REBALANCE_IDLE)
+			continue;
+		if(dst == -1 || cpus[i].demand < cpus[dst].demand)
+			dst = i;
+	}
+	if(dst == -1)
+		goto stable;
+
+	if(++reeact_rebalance_node_streak < REEACT_REBALANCE_STABLE)
+		return 0;
+	reeact_rebalance_node_streak = 0;
+
+	return reeact_rebalance_move(victim, dst, "node", skew) == 0;
+
+ stable:
+	reeact_rebalance_node_streak = 0;
+	return 0;
+}
+
+/*
+ * Decide the moves of a period.
+ */
+static void reeact_rebalance_decide(unsigned long long period)
+{
+	struct reeact_rebalance_cpu *cpus = reeact_rebalance_cpus;
+	struct reeact_rebalance_thread *t;
+	struct processor_topo *topo = NULL;
+	unsigned long long skew_ns;
+	unsigned long episodes;
+	double skew;
+	int i;
+
+	skew_ns = atomic_xchg(&reeact_rebalance_skew, 0);
+	episodes = atomic_xchg(&reeact_rebalance_episodes, 0);
+	skew = (double)skew_ns / period;
+
+	if(reeact_handle != NULL && fastsync_load_topology() == 0)
+		topo = &(reeact_handle->topology);
+
+	for(i = 0; i < CPU_SETSIZE; i++){
+		cpus[i].demand = cpus[i].load;
+		cpus[i].node = -1;
+		if(topo != NULL && topo->cpu_nodes != NULL && i < topo->cpu_cnt)
+			cpus[i].node = topo->cpu_nodes[i];
+	}
+	for(i = 0; i < reeact_rebalance_thread_cnt; i++){
+		t = &(reeact_rebalance_threads[i]);
+		if(t->sampled && t->cpu >= 0)
+			cpus[t->cpu].demand += t->wait;
+	}
+
+	/* the threads are in step, moving them would not help */
+	if(episodes > 0 && skew < REEACT_REBALANCE_SKEW){
+		reeact_rebalance_load_streak = 0;
+		reeact_rebalance_node(skew);
+		return;
+	}
+
+	if(!reeact_rebalance_load(skew))
+		reeact_rebalance_node(skew);
+
+	return;
+}
+
+/*
+ * The monitor thread.
+ */
+static void *reeact_rebalance_thread(void *arg)
+{
+	struct timespec ts;
+	unsigned long long last, now;
+	sigset_t mask;
+
+	/* leave the signals to the application's threads */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	/* run behind the application's threads */
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+
+	ts.tv_sec = reeact_rebalance_period / 1000;
+	ts.tv_nsec = (reeact_rebalance_period % 1000) * 1000000L;
+
+	reeact_rebalance_sample_cpus();
+	last = reeact_events_now();
+	while(!atomic_read(reeact_rebalance_stop)){
+		nanosleep(&ts, NULL);
+		now = reeact_events_now();
+		if(now == last)
+			continue;
+		reeact_rebalance_sample_cpus();
+		reeact_rebalance_sample_threads(now - last);
+		reeact_rebalance_decide(now - last);
+		last = now;
+	}
+
+	return NULL;
+}
+
+/*
+ * start the monitor thread
+ */
+int reeact_rebalance_init(void *data)
+{
+	const char *period = getenv(REEACT_REBALANCE_ENV);
+	const char *log = getenv(REEACT_REBALANCE_LOG_ENV);
+	pthread_t thread;
+	pthread_attr_t attr;
+	char *end;
+	int ret_val;
+
+	if(period == NULL || period[0] == '\0')
+		return 0;
+
+	reeact_rebalance_period = strtol(period, &end, 10);
+	if(*end != '\0' || reeact_rebalance_period <= 0){
+		LOGERR("Invalid %s %s, threads are not rebalanced\n",
+		       REEACT_REBALANCE_ENV, period);
+		return 1;
+	}
+	if(log != NULL && strcmp(log, "0") == 0)
+		reeact_rebalance_log = 0;
+
+	/* the cpus of the process, before any thread is placed */
+	if(sched_getaffinity(0, sizeof(reeact_rebalance_allowed),
+			     &reeact_rebalance_allowed) != 0){
+		LOGERRX("Unable to get the cpus of the process: ");
+		return 2;
+	}
+
+	/* the sync waits of the threads, and the barrier skew */
+	ret_val = reeact_events_subscribe(REEACT_EVENTS_LOCK |
+		REEACT_EVENT_MASK(REEACT_EVENT_BARRIER_DONE) |
+		REEACT_EVENT_MASK(REEACT_EVENT_COND_WAKEUP),
+		reeact_rebalance_event, NULL);
+	if(ret_val)
+		LOGERR("Unable to subscribe to events, no sync statistics: "
+		       "%s\n", strerror(ret_val));
+
+	/* bypass the hooks, this thread is not part of the application */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret_val = real_pthread_create(&thread, &attr, reeact_rebalance_thread,
+				      NULL);
+	pthread_attr_destroy(&attr);
+	if(ret_val){
+		LOGERR("Unable to create monitor thread: %s\n",
+		       strerror(ret_val));
+		return 2;
+	}
+
+	DPRINTF("rebalancing threads every %d ms\n", reeact_rebalance_period);
+
+	return 0;
+}
+
+/*
+ * stop the monitor thread
+ */
+int reeact_rebalance_cleanup(void *data)
+{
+	atomic_read(reeact_rebalance_stop) = 1;
+
+	return 0;
+}
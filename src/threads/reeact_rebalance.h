@@ -0,0 +1,75 @@
+/*
+ * Header file of the REEact rebalancing monitor. When the REEACT_REBALANCE
+ * environment variable gives a period in milliseconds, REEact starts a
+ * low-priority (nice 19) background thread that samples, every period:
+ *     - the load of each cpu the process may run on, from /proc/stat, which
+ *       includes other jobs on the machine
+ *     - the compute ratio (run time) and the wait ratio (time runnable but
+ *       waiting for a cpu) of each thread of the application, from
+ *       /proc/self/task/<tid>/schedstat, and its current cpu
+ *     - the ratio of time each thread waits on locks and conditional
+ *       variables, and its migrations, from its record (see reeact_threads.h)
+ *     - the arrival skew of the barriers
+ * It then re-pins at most one thread per period with reeact_threads_place:
+ *     load: the thread waiting the most for the cpu with the highest demand
+ *           (its load plus the wait of our threads on it) moves to the cpu
+ *           with the lowest demand, preferring the same node, when the
+ *           difference exceeds REEACT_REBALANCE_THRESHOLD
+ *     node: a thread that waits on synchronization and runs on another node
+ *           than most threads moves to an idle cpu of that node, to cut
+ *           cross-node synchronization
+ * A load move is skipped while barriers are observed with a skew below
+ * REEACT_REBALANCE_SKEW of the period, as the threads are then in step.
+ * For hysteresis, a move is only made once its condition has held for
+ * REEACT_REBALANCE_STABLE consecutive periods, and a thread that has moved is
+ * not moved again for REEACT_REBALANCE_COOLDOWN periods. Threads whose
+ * affinity the application has set are never moved. Every move is written to
+ * the log (stderr), unless REEACT_REBALANCE_LOG is 0.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_REBALANCE_H__
+#define __REEACT_REBALANCE_H__
+
+#define REEACT_REBALANCE_ENV "REEACT_REBALANCE"
+#define REEACT_REBALANCE_LOG_ENV "REEACT_REBALANCE_LOG"
+
+/*
+ * the tuning of the decisions, in fractions of a cpu or of the period
+ *     THRESHOLD: the minimum difference of demand for a load move
+ *     REMOTE: the extra demand counted for a cpu on another node
+ *     SKEW: the barrier skew below which threads are in step
+ *     SYNC: the minimum sync wait ratio of a thread for a node move
+ *     IDLE: the maximum demand of the cpu a node move goes to
+ */
+#define REEACT_REBALANCE_THRESHOLD 0.5
+#define REEACT_REBALANCE_REMOTE 0.25
+#define REEACT_REBALANCE_SKEW 0.05
+#define REEACT_REBALANCE_SYNC 0.1
+#define REEACT_REBALANCE_IDLE 0.3
+#define REEACT_REBALANCE_STABLE 3
+#define REEACT_REBALANCE_COOLDOWN 10
+
+/*
+ * Start the monitor thread if REEACT_REBALANCE is set.
+ * Input parameters:
+ *     data: the data used by the user policy. By default a pointer to the
+ *           "struct reeact_data" is passed.
+ * Return value:
+ *     0: success, or REEACT_REBALANCE is not set
+ *     1: REEACT_REBALANCE is not valid
+ *     2: error creating the monitor thread
+ */
+int reeact_rebalance_init(void *data);
+
+/*
+ * Stop the monitor thread.
+ * Input parameters:
+ *     data: the same as reeact_rebalance_init
+ * Return value:
+ *     0: success
+ */
+int reeact_rebalance_cleanup(void *data);
+
+#endif
@@ -0,0 +1,657 @@
+/*
+ * Implementation of the REEact thread records.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "reeact_threads.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../events/reeact_events.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+/*
+ * the list of all records; records are only added to the list, and taken or
+ * released under reeact_threads_lock
+ */
+static struct reeact_thread *reeact_threads_list = NULL;
+static fastsync_spinlock reeact_threads_lock;
+
+unsigned int reeact_threads_generation = 0;
+int reeact_threads_live = 0;
+
+/*
+ * the index of the next thread created
+ */
+static int reeact_threads_next_index = 1;
+
+/*
+ * the record of current thread
+ */
+__thread struct reeact_thread *reeact_my_thread = NULL;
+
+/*
+ * the argument of the thread trampoline
+ */
+struct reeact_threads_start{
+	void *(*start_routine)(void *);
+	void *arg;
+	int index;
+	unsigned long long start; // the time the thread starts
+	int place; // 1 if the thread is to be placed on placement
+	int mode; // the affinity mode of the placement
+	cpu_set_t placement;
+	int pinned; // 1 if the attributes of the thread set its affinity
+	cpu_set_t requested; // the affinity set by the attributes
+};
+
+/*
+ * count the exit of a thread, once
+ */
+static void reeact_threads_exit(struct reeact_thread *rec)
+{
+	if(rec->index < 0 || rec->exited)
+		return;
+
+	rec->exited = 1;
+	atomic_subf(&reeact_threads_live, 1);
+
+	return;
+}
+
+/*
+ * key to release the record when a thread exits
+ */
+static pthread_key_t reeact_threads_key;
+static pthread_once_t reeact_threads_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * release the record of an exited thread
+ */
+static void reeact_threads_release(void *data)
+{
+	struct reeact_thread *rec = (struct reeact_thread*)data;
+
+	/* e.g., the main thread calling pthread_exit */
+	reeact_threads_exit(rec);
+
+	reeact_my_thread = NULL;
+	fastsync_spin_lock(&reeact_threads_lock);
+	rec->owned = 0;
+	rec->in_use = 0;
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	return;
+}
+
+static void reeact_threads_key_init()
+{
+	if(pthread_key_create(&reeact_threads_key, reeact_threads_release))
+		LOGERR("Unable to create key for thread records\n");
+}
+
+/*
+ * Find the node and socket of a cpu.
+ */
+static void reeact_threads_cpu_location(int cpu, int *node, int *socket)
+{
+	struct processor_topo *topo;
+
+	*node = *socket = -1;
+	/* called with locks held and from the hooks, never loads the topology */
+	if(reeact_handle == NULL || cpu < 0 || !fastsync_topology_known())
+		return;
+
+	topo = &(reeact_handle->topology);
+	if(topo->cpu_nodes != NULL && cpu < topo->cpu_cnt)
+		*node = topo->cpu_nodes[cpu];
+	if(topo->node_sockets != NULL && *node >= 0 &&
+	   *node < topo->node_id_cnt)
+		*socket = topo->node_sockets[*node];
+
+	return;
+}
+
+/*
+ * Find the cpu, node and socket the affinity of a thread confines it to.
+ */
+static void reeact_threads_locate(struct reeact_thread *rec)
+{
+	int node, socket, i;
+
+	rec->cpu = rec->node = rec->socket = -2;
+	for(i = 0; i < CPU_SETSIZE; i++){
+		if(!CPU_ISSET(i, &(rec->affinity)))
+			continue;
+		reeact_threads_cpu_location(i, &node, &socket);
+		/* -2 until the first cpu, -1 once they differ */
+		rec->cpu = (rec->cpu == -2) ? i : -1;
+		rec->node = (rec->node == -2 || rec->node == node) ? node : -1;
+		rec->socket = (rec->socket == -2 || rec->socket == socket) ?
+			socket : -1;
+	}
+	if(rec->cpu == -2)
+		rec->cpu = rec->node = rec->socket = -1;
+
+	return;
+}
+
+/*
+ * look up where current thread runs
+ */
+void reeact_threads_refresh(struct reeact_thread *rec)
+{
+	int cpu = sched_getcpu();
+	int node, socket;
+
+	reeact_threads_cpu_location(cpu, &node, &socket);
+	reeact_threads_ran_on(rec, cpu, node, socket);
+
+	return;
+}
+
+/*
+ * Take a free record, or allocate one, with reeact_threads_lock held.
+ */
+static struct reeact_thread *reeact_threads_alloc()
+{
+	struct reeact_thread *rec;
+
+	for(rec = reeact_threads_list; rec != NULL; rec = rec->next)
+		if(!rec->in_use)
+			break;
+
+	if(rec == NULL){
+		if(posix_memalign((void**)&rec, 64, sizeof(*rec)) != 0)
+			return NULL;
+		memset(rec, 0, sizeof(*rec));
+		rec->next = reeact_threads_list;
+		/* the record is complete before it can be found */
+		mem_barrier();
+		atomic_read(reeact_threads_list) = rec;
+	}
+
+	rec->thread = 0;
+	rec->tid = 0;
+	rec->owned = 0;
+	rec->index = -1;
+	rec->exited = 0;
+	rec->app_pinned = 0;
+	rec->placed = 0;
+	rec->run_cpu = rec->run_node = rec->run_socket = -1;
+	memset(&(rec->stats), 0, sizeof(rec->stats));
+	rec->in_use = 1;
+
+	return rec;
+}
+
+/*
+ * Find the live record of a thread, with reeact_threads_lock held.
+ */
+static struct reeact_thread *reeact_threads_lookup(pthread_t thread, int tid)
+{
+	struct reeact_thread *rec;
+
+	for(rec = reeact_threads_list; rec != NULL; rec = rec->next)
+		if(rec->in_use && ((thread != 0 && rec->thread == thread) ||
+				   (tid != 0 && rec->tid == tid)))
+			return rec;
+
+	return NULL;
+}
+
+/*
+ * the list of all records
+ */
+struct reeact_thread *reeact_threads_all(void)
+{
+	return atomic_read(reeact_threads_list);
+}
+
+/*
+ * get the record of current thread
+ */
+struct reeact_thread *reeact_threads_self(void)
+{
+	struct reeact_thread *rec = reeact_my_thread;
+	pthread_t self;
+	int tid;
+
+	if(rec != NULL)
+		return rec;
+
+	pthread_once(&reeact_threads_key_once, reeact_threads_key_init);
+
+	self = pthread_self();
+	tid = syscall(SYS_gettid);
+
+	fastsync_spin_lock(&reeact_threads_lock);
+	/* a record created by another thread that set our affinity */
+	rec = reeact_threads_lookup(self, tid);
+	if(rec != NULL && rec->owned)
+		rec = NULL;
+	if(rec == NULL){
+		rec = reeact_threads_alloc();
+		if(rec != NULL){
+			sched_getaffinity(0, sizeof(cpu_set_t),
+					  &(rec->affinity));
+			reeact_threads_locate(rec);
+		}
+	}
+	if(rec != NULL){
+		rec->thread = self;
+		rec->tid = tid;
+		rec->owned = 1;
+	}
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	if(rec == NULL){
+		LOGERR("Unable to allocate memory for thread record\n");
+		return NULL;
+	}
+
+	pthread_setspecific(reeact_threads_key, rec);
+	reeact_my_thread = rec;
+
+	return rec;
+}
+
+/*
+ * Register the record of current thread under an index.
+ * Return value:
+ *     the record; NULL if it cannot be allocated
+ */
+static struct reeact_thread *reeact_threads_register(int index,
+						     unsigned long long start)
+{
+	struct reeact_thread *rec = reeact_threads_self();
+
+	if(rec == NULL)
+		return NULL;
+
+	rec->index = index;
+	rec->stats.start = start;
+
+	DPRINTF("thread %d registered as thread %d\n", rec->tid, index);
+
+	return rec;
+}
+
+/*
+ * register the main thread; where it runs is looked up later, as the topology
+ * is only detected when it is first needed
+ */
+int reeact_threads_init(void *data)
+{
+	atomic_addf(&reeact_threads_live, 1);
+	if(reeact_threads_register(0, reeact_events_now()) == NULL)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * count the exit of a thread started in the trampoline, and report it
+ */
+static void reeact_threads_cleanup(void *data)
+{
+	struct reeact_threads_start *t = (struct reeact_threads_start*)data;
+	struct reeact_thread *rec = reeact_my_thread;
+
+	reeact_events_emit(REEACT_EVENT_THREAD_EXIT, (void*)t->start_routine,
+			   reeact_events_now() - t->start);
+
+	if(rec != NULL)
+		reeact_threads_exit(rec);
+	else
+		atomic_subf(&reeact_threads_live, 1);
+
+	return;
+}
+
+/*
+ * the trampoline of threads, registering their records and reporting their
+ * start and exit; the exit is also counted for pthread_exit and cancellation
+ */
+static void *reeact_threads_start(void *data)
+{
+	struct reeact_threads_start t = *(struct reeact_threads_start*)data;
+	struct reeact_thread *rec;
+	void *ret_val;
+
+	free(data);
+
+	t.start = reeact_events_now();
+	rec = reeact_threads_register(t.index, t.start);
+	if(rec != NULL){
+		/* the thread is already running on the requested cpus */
+		if(t.pinned){
+			fastsync_spin_lock(&reeact_threads_lock);
+			rec->requested = t.requested;
+			rec->app_pinned = 1;
+			fastsync_spin_unlock(&reeact_threads_lock);
+		}
+		if(t.place && reeact_threads_place(rec, t.mode, &(t.placement)))
+			LOGERR("Unable to place thread %d\n", t.index);
+		reeact_threads_refresh(rec);
+	}
+	else
+		LOGERR("Unable to register thread %d\n", t.index);
+	reeact_events_emit(REEACT_EVENT_THREAD_CREATE, (void*)t.start_routine,
+			   0);
+
+	pthread_cleanup_push(reeact_threads_cleanup, &t);
+	ret_val = t.start_routine(t.arg);
+	pthread_cleanup_pop(1);
+
+	return ret_val;
+}
+
+/*
+ * wrap the start routine of a thread with the trampoline
+ */
+int reeact_threads_wrap(void *(**start_routine)(void *), void **arg,
+			const pthread_attr_t *attr)
+{
+	struct reeact_threads_start *t;
+
+	if(reeact_handle == NULL)
+		return 0;
+
+	t = (struct reeact_threads_start*)malloc(sizeof(*t));
+	if(t == NULL)
+		return ENOMEM;
+
+	t->start_routine = *start_routine;
+	t->arg = *arg;
+	t->index = atomic_fadd(&reeact_threads_next_index, 1);
+	t->place = 0;
+	/* an affinity set in the attributes is the application's request */
+	t->pinned = attr != NULL &&
+		pthread_attr_getaffinity_np(attr, sizeof(t->requested),
+					    &(t->requested)) == 0 &&
+		CPU_COUNT(&(t->requested)) < CPU_SETSIZE;
+	*start_routine = reeact_threads_start;
+	*arg = t;
+
+	atomic_addf(&reeact_threads_live, 1);
+
+	return 0;
+}
+
+/*
+ * undo the wrapping of a thread that is not created
+ */
+void reeact_threads_unwrap(void *(*start_routine)(void *), void *arg)
+{
+	if(start_routine != reeact_threads_start)
+		return;
+
+	free(arg);
+	atomic_subf(&reeact_threads_live, 1);
+
+	return;
+}
+
+/*
+ * the index of a wrapped thread
+ */
+int reeact_threads_wrapped_index(void *(*start_routine)(void *), void *arg)
+{
+	if(start_routine != reeact_threads_start)
+		return -1;
+
+	return ((struct reeact_threads_start*)arg)->index;
+}
+
+/*
+ * have a wrapped thread placed when it starts
+ */
+void reeact_threads_wrapped_place(void *(*start_routine)(void *), void *arg,
+				  int mode, const cpu_set_t *placement)
+{
+	struct reeact_threads_start *t = (struct reeact_threads_start*)arg;
+
+	if(start_routine != reeact_threads_start)
+		return;
+
+	t->place = 1;
+	t->mode = mode;
+	t->placement = *placement;
+
+	return;
+}
+
+/*
+ * release the records left for a joined thread
+ */
+void reeact_threads_joined(pthread_t thread)
+{
+	struct reeact_thread *rec;
+
+	if(reeact_handle == NULL)
+		return;
+
+	/*
+	 * the records the thread has taken are released at its exit; those
+	 * created for it by other threads may be left
+	 */
+	fastsync_spin_lock(&reeact_threads_lock);
+	for(rec = reeact_threads_list; rec != NULL; rec = rec->next)
+		if(rec->in_use && !rec->owned && rec->thread == thread)
+			rec->in_use = 0;
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	return;
+}
+
+/*
+ * find the record of a thread
+ */
+struct reeact_thread *reeact_threads_find(pthread_t thread, int tid)
+{
+	struct reeact_thread *rec;
+
+	if(reeact_handle == NULL)
+		return NULL;
+	/* e.g., sched_setaffinity of another process */
+	if(thread == 0 && syscall(SYS_tgkill, getpid(), tid, 0) != 0)
+		return NULL;
+
+	if((thread != 0 && pthread_equal(thread, pthread_self())) ||
+	   (tid != 0 && tid == syscall(SYS_gettid)))
+		return reeact_threads_self();
+
+	fastsync_spin_lock(&reeact_threads_lock);
+	rec = reeact_threads_lookup(thread, tid);
+	if(rec == NULL){
+		rec = reeact_threads_alloc();
+		if(rec != NULL){
+			rec->thread = thread;
+			rec->tid = tid;
+			if(thread != 0)
+				pthread_getaffinity_np(thread,
+						       sizeof(cpu_set_t),
+						       &(rec->affinity));
+			else
+				sched_getaffinity(tid, sizeof(cpu_set_t),
+						  &(rec->affinity));
+			reeact_threads_locate(rec);
+		}
+	}
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	return rec;
+}
+
+/*
+ * Apply an affinity to a thread. The thread is named by its tid when it is
+ * known: another thread, e.g., the rebalancing monitor, may apply it while
+ * the thread exits, which fails with ESRCH for a tid, but would use the
+ * freed descriptor of a detached thread for a pthread_t.
+ * Return value:
+ *     0: success
+ *     other: the error
+ */
+static int reeact_threads_apply(struct reeact_thread *rec, size_t size,
+				const cpu_set_t *cpuset)
+{
+	if(rec->tid == 0)
+		return real_pthread_setaffinity_np(rec->thread, size, cpuset);
+
+	if(real_sched_setaffinity(rec->tid, size, cpuset) == -1)
+		return errno;
+
+	return 0;
+}
+
+/*
+ * set the affinity of a thread for the application
+ */
+int reeact_threads_set_affinity(struct reeact_thread *rec, int mode,
+				size_t size, const cpu_set_t *cpuset)
+{
+	cpu_set_t requested, effective;
+	int ret_val;
+
+	/* the part of the request the records can hold */
+	CPU_ZERO(&requested);
+	memcpy(&requested, cpuset, size < sizeof(requested) ? size :
+	       sizeof(requested));
+
+	if(!rec->placed || mode == REEACT_AFFINITY_HONOR){
+		/* as the application asked, whatever the size */
+		ret_val = reeact_threads_apply(rec, size, cpuset);
+		effective = requested;
+	}
+	else{
+		if(mode == REEACT_AFFINITY_OVERRIDE)
+			effective = rec->placement;
+		else{
+			CPU_AND(&effective, &requested, &(rec->placement));
+			if(CPU_COUNT(&effective) == 0)
+				effective = requested;
+		}
+		ret_val = reeact_threads_apply(rec, sizeof(effective),
+					       &effective);
+	}
+	if(ret_val)
+		return ret_val;
+
+	fastsync_spin_lock(&reeact_threads_lock);
+	rec->requested = requested;
+	rec->app_pinned = 1;
+	rec->affinity = effective;
+	reeact_threads_locate(rec);
+	rec->generation++;
+	atomic_addf(&reeact_threads_generation, 1);
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	DPRINTF("affinity of thread %d set to %d cpus, cpu %d node %d "
+		"socket %d\n", rec->tid, CPU_COUNT(&effective), rec->cpu,
+		rec->node, rec->socket);
+
+	return 0;
+}
+
+/*
+ * place a thread
+ */
+int reeact_threads_place(struct reeact_thread *rec, int mode,
+			 const cpu_set_t *placement)
+{
+	int ret_val;
+
+	fastsync_spin_lock(&reeact_threads_lock);
+	rec->placement = *placement;
+	rec->placed = 1;
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	/* the affinity the application asked for, within the placement */
+	if(rec->app_pinned)
+		return reeact_threads_set_affinity(rec, mode,
+						   sizeof(rec->requested),
+						   &(rec->requested));
+
+	ret_val = reeact_threads_apply(rec, sizeof(*placement), placement);
+	if(ret_val)
+		return ret_val;
+
+	fastsync_spin_lock(&reeact_threads_lock);
+	rec->affinity = *placement;
+	reeact_threads_locate(rec);
+	rec->generation++;
+	atomic_addf(&reeact_threads_generation, 1);
+	fastsync_spin_unlock(&reeact_threads_lock);
+
+	DPRINTF("thread %d placed on %d cpus, cpu %d node %d socket %d\n",
+		rec->tid, CPU_COUNT(placement), rec->cpu, rec->node,
+		rec->socket);
+
+	return 0;
+}
+
+/*
+ * the affinity hooks
+ */
+int reeact_threads_pthread_setaffinity_np(int mode, pthread_t thread,
+					  size_t size, const cpu_set_t *cpuset)
+{
+	struct reeact_thread *rec = reeact_threads_find(thread, 0);
+
+	if(rec == NULL)
+		return real_pthread_setaffinity_np(thread, size, cpuset);
+
+	return reeact_threads_set_affinity(rec, mode, size, cpuset);
+}
+
+int reeact_threads_sched_setaffinity(int mode, pid_t pid, size_t size,
+				     const cpu_set_t *cpuset)
+{
+	struct reeact_thread *rec;
+	int ret_val;
+
+	if(reeact_handle == NULL)
+		return real_sched_setaffinity(pid, size, cpuset);
+	rec = (pid == 0) ? reeact_threads_self() : 
+		reeact_threads_find(0, pid);
+	if(rec == NULL)
+		return real_sched_setaffinity(pid, size, cpuset);
+
+	ret_val = reeact_threads_set_affinity(rec, mode, size, cpuset);
+	if(ret_val){
+		errno = ret_val;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * read the affinity mode
+ */
+int reeact_threads_affinity_mode(void)
+{
+	const char *mode = getenv(REEACT_AFFINITY_ENV);
+
+	if(mode == NULL || strcmp(mode, "honor") == 0)
+		return REEACT_AFFINITY_HONOR;
+	if(strcmp(mode, "override") == 0)
+		return REEACT_AFFINITY_OVERRIDE;
+	if(strcmp(mode, "merge") == 0)
+		return REEACT_AFFINITY_MERGE;
+
+	LOGERR("Unknown %s %s, honoring affinity requests\n",
+	       REEACT_AFFINITY_ENV, mode);
+
+	return REEACT_AFFINITY_HONOR;
+}
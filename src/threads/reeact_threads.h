@@ -0,0 +1,315 @@
+/*
+ * Header file of the REEact thread records. REEact keeps a record of each
+ * thread of the application: its logical index, where it may run and where it
+ * last ran, and its statistics, so that topology-aware decisions (tree
+ * barriers, per-node grouping, placement) can be made per thread, and follow
+ * the application when it, or its runtime (e.g., libgomp with OMP_PROC_BIND),
+ * pins threads itself. The records are updated by the affinity hooks
+ * (pthread_setaffinity_np, sched_setaffinity), which let the active policy
+ * decide how to treat the request, see reeact_threads_set_affinity.
+ *
+ * The threads created with pthread_create start in a trampoline (see
+ * reeact_threads_wrap), which registers the record of the thread before its
+ * start routine runs, and reports its exit, whether it returns, calls
+ * pthread_exit or is cancelled. The record of the calling thread is then found
+ * through TLS with reeact_threads_current. The main thread is registered by
+ * reeact_threads_init. Other threads, e.g., the helper threads of REEact, get
+ * a record without an index when they first need one.
+ *
+ * A record of a thread that has not asked for it yet may be created when
+ * another thread sets its affinity, and is taken over by the thread later;
+ * pthread_join releases such records of the joined thread. The records are
+ * never freed: the record of an exited thread is reused by a later thread, so
+ * that the list of records can be traversed without locks.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_THREADS_H__
+#define __REEACT_THREADS_H__
+
+#include <sched.h>
+#include <pthread.h>
+
+/*
+ * How a policy treats an affinity request of the application:
+ *     HONOR: apply the request as is
+ *     OVERRIDE: keep the placement of REEact, if the thread has one, and
+ *               only record the request
+ *     MERGE: apply the part of the request within the placement of REEact,
+ *            or the request if they do not overlap
+ * A thread that REEact has not placed gets the request in any mode. The
+ * fastsync policy reads its mode from REEACT_AFFINITY ("honor", "override" or
+ * "merge"; honor by default); the passthrough policy always honors.
+ */
+#define REEACT_AFFINITY_HONOR 0
+#define REEACT_AFFINITY_OVERRIDE 1
+#define REEACT_AFFINITY_MERGE 2
+#define REEACT_AFFINITY_ENV "REEACT_AFFINITY"
+
+/*
+ * The statistics of a thread, only written by the thread itself. The waits
+ * are counted while the events of their type are wanted (see
+ * events/reeact_events.h), e.g., with the control socket on.
+ *     start: the time the thread is registered, in nanoseconds
+ *     migrations: the number of times the thread was seen on another cpu
+ *     lock_waits, lock_wait_ns: the number of waits for contended locks, and
+ *                               their total time
+ *     cond_waits, cond_wait_ns: the number of wakeups from conditional
+ *                               variables, and the total time waited
+ *     locks: the number of mutex and rwlock acquisitions, counted while the
+ *            threads are throttled (see reeact_throttle.h)
+ */
+struct reeact_thread_stats{
+	unsigned long long start;
+	unsigned long migrations;
+	unsigned long lock_waits;
+	unsigned long long lock_wait_ns;
+	unsigned long cond_waits;
+	unsigned long long cond_wait_ns;
+	unsigned long locks;
+};
+
+/*
+ * The record of a thread.
+ *     thread: the pthread_t of the thread, 0 if not known yet
+ *     tid: the thread id (gettid) of the thread, 0 if not known yet
+ *     in_use: 1 if the record belongs to a live thread
+ *     owned: 1 if the thread itself has taken the record
+ *     index: the logical index of the thread: 0 for the main thread, then 1,
+ *            2, ... in the order the threads are created; -1 for threads not
+ *            created with pthread_create. Indices are not reused.
+ *     exited: 1 once the thread has exited
+ *     affinity: the cpus the thread may run on
+ *     requested: the cpus the application asked for, if app_pinned
+ *     placement: the cpus REEact placed the thread on, if placed
+ *     app_pinned: 1 if the application has set the affinity of the thread
+ *     placed: 1 if REEact has placed the thread
+ *     cpu, node, socket: the cpu, node and socket the affinity confines the
+ *                        thread to; -1 if it spans more than one, or the
+ *                        topology is not known
+ *     run_cpu, run_node, run_socket: where the thread was last seen
+ *                                    running; -1 if not known
+ *     stats: the statistics of the thread
+ *     generation: incremented when the affinity changes
+ *     next: the next record in the list of all records
+ */
+struct reeact_thread{
+	pthread_t thread;
+	int tid;
+	int in_use;
+	int owned;
+	int index;
+	int exited;
+	cpu_set_t affinity;
+	cpu_set_t requested;
+	cpu_set_t placement;
+	int app_pinned;
+	int placed;
+	int cpu;
+	int node;
+	int socket;
+	int run_cpu;
+	int run_node;
+	int run_socket;
+	struct reeact_thread_stats stats;
+	unsigned int generation;
+	struct reeact_thread *next;
+} __attribute__((aligned(64)));
+
+/*
+ * Incremented whenever the affinity of any thread changes. Structures built
+ * from the locations of the threads, e.g., the groups of a tree barrier,
+ * should remember the generation they are built at, and be rebuilt lazily,
+ * on their next use, when it has changed.
+ */
+extern unsigned int reeact_threads_generation;
+
+/*
+ * The number of live threads of the application: the main thread, and the
+ * threads created with pthread_create that have not exited. A thread is
+ * counted from the time pthread_create is called, so that the count is right
+ * when pthread_create returns.
+ */
+extern int reeact_threads_live;
+
+/*
+ * the record of the calling thread, if it has one
+ */
+extern __thread struct reeact_thread *reeact_my_thread;
+
+/*
+ * Register the main thread.
+ * Input parameters:
+ *     data: the data used by the user policy. By default a pointer to the
+ *           "struct reeact_data" is passed.
+ * Return value:
+ *     0: success
+ *     1: unable to allocate the record of the main thread
+ */
+int reeact_threads_init(void *data);
+
+/*
+ * Get the record of the calling thread in O(1).
+ * Return value:
+ *     the record; NULL if the thread has no record yet
+ */
+static inline struct reeact_thread *reeact_threads_current(void)
+{
+	return reeact_my_thread;
+}
+
+/*
+ * Get the record of the calling thread, creating it if needed.
+ * Return value:
+ *     the record; NULL if it cannot be allocated
+ */
+struct reeact_thread *reeact_threads_self(void);
+
+/*
+ * Get the list of all records, for traversal through the next pointers. The
+ * records not in_use are free.
+ * Return value:
+ *     the first record; NULL if there are no records
+ */
+struct reeact_thread *reeact_threads_all(void);
+
+/*
+ * Update where the calling thread runs, and count its migrations.
+ * Input parameters:
+ *     rec: the record of the calling thread
+ *     cpu, node, socket: where it runs now
+ */
+static inline void reeact_threads_ran_on(struct reeact_thread *rec, int cpu,
+					 int node, int socket)
+{
+	if(rec->run_cpu != cpu){
+		if(rec->run_cpu != -1)
+			rec->stats.migrations++;
+		rec->run_cpu = cpu;
+		rec->run_node = node;
+		rec->run_socket = socket;
+	}
+}
+
+/*
+ * Look up where the calling thread runs now, and update its record.
+ * Input parameters:
+ *     rec: the record of the calling thread
+ */
+void reeact_threads_refresh(struct reeact_thread *rec);
+
+/*
+ * Make a thread about to be created start in the trampoline, which registers
+ * its record and reports THREAD_CREATE and THREAD_EXIT events, and count it
+ * as live. An affinity set in the attributes of the thread is recorded as
+ * requested by the application, as with pthread_setaffinity_np.
+ * Input parameters:
+ *     start_routine, arg: the start routine and its argument
+ *     attr: the attributes of the thread, may be NULL
+ * Output parameters:
+ *     start_routine, arg: the trampoline and its argument, unchanged if
+ *                         REEact is not initialized
+ * Return value:
+ *     0: success
+ *     ENOMEM: unable to allocate the argument of the trampoline
+ */
+int reeact_threads_wrap(void *(**start_routine)(void *), void **arg,
+			const pthread_attr_t *attr);
+
+/*
+ * Undo reeact_threads_wrap if the thread is not created.
+ * Input parameters:
+ *     start_routine, arg: as returned by reeact_threads_wrap
+ */
+void reeact_threads_unwrap(void *(*start_routine)(void *), void *arg);
+
+/*
+ * Get the logical index of a thread about to be created.
+ * Input parameters:
+ *     start_routine, arg: as returned by reeact_threads_wrap
+ * Return value:
+ *     the index of the thread; -1 if the thread is not wrapped
+ */
+int reeact_threads_wrapped_index(void *(*start_routine)(void *), void *arg);
+
+/*
+ * Have a thread about to be created placed by the trampoline, with
+ * reeact_threads_place, before its start routine runs.
+ * Input parameters:
+ *     start_routine, arg: as returned by reeact_threads_wrap
+ *     mode: REEACT_AFFINITY_*
+ *     placement: the cpus to place the thread on
+ */
+void reeact_threads_wrapped_place(void *(*start_routine)(void *), void *arg,
+				  int mode, const cpu_set_t *placement);
+
+/*
+ * Release the records left for a thread that has been joined.
+ * Input parameters:
+ *     thread: the joined thread
+ */
+void reeact_threads_joined(pthread_t thread);
+
+/*
+ * Find the record of a thread, creating it if needed.
+ * Input parameters:
+ *     thread: the pthread_t of the thread, or 0 if tid is given
+ *     tid: the thread id of the thread, or 0 if thread is given
+ * Return value:
+ *     the record; NULL if REEact is not initialized, tid is not a thread of
+ *     this process, or the record cannot be allocated
+ */
+struct reeact_thread *reeact_threads_find(pthread_t thread, int tid);
+
+/*
+ * Set the affinity of a thread for the application, as decided by a policy.
+ * Input parameters:
+ *     rec: the record of the thread
+ *     mode: REEACT_AFFINITY_*
+ *     size, cpuset: the affinity requested by the application
+ * Return value:
+ *     0: success
+ *     other: the error of pthread_setaffinity_np
+ */
+int reeact_threads_set_affinity(struct reeact_thread *rec, int mode,
+				size_t size, const cpu_set_t *cpuset);
+
+/*
+ * Place a thread on a set of cpus for REEact. The thread runs on the placement
+ * unless the application has set its affinity, in which case the request of
+ * the application is applied again in the given mode.
+ * Input parameters:
+ *     rec: the record of the thread
+ *     mode: REEACT_AFFINITY_*
+ *     placement: the cpus to place the thread on
+ * Return value:
+ *     0: success
+ *     other: the error of pthread_setaffinity_np
+ */
+int reeact_threads_place(struct reeact_thread *rec, int mode,
+			 const cpu_set_t *placement);
+
+/*
+ * The affinity hooks of a policy treating requests in a given mode: they
+ * update the record of the target thread, and fall back to the originals for
+ * threads without records, e.g., of other processes.
+ * Input parameters:
+ *     mode: REEACT_AFFINITY_*
+ *     others: same as pthread_setaffinity_np and sched_setaffinity
+ * Return value:
+ *     same as pthread_setaffinity_np and sched_setaffinity
+ */
+int reeact_threads_pthread_setaffinity_np(int mode, pthread_t thread,
+					  size_t size, const cpu_set_t *cpuset);
+int reeact_threads_sched_setaffinity(int mode, pid_t pid, size_t size,
+				     const cpu_set_t *cpuset);
+
+/*
+ * Read the affinity mode from REEACT_AFFINITY.
+ * Return value:
+ *     REEACT_AFFINITY_*, HONOR if the variable is not set or not valid
+ */
+int reeact_threads_affinity_mode(void);
+
+#endif
@@ -0,0 +1,398 @@
+/*
+ * Implementation of the REEact concurrency throttling.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/futex.h>
+
+#include "reeact_throttle.h"
+#include "reeact_threads.h"
+#include "../reeact.h"
+#include "../utils/reeact_utils.h"
+#include "../fastsync/fastsync.h"
+#include "../events/reeact_events.h"
+#include "../policies/reeact_policy.h"
+#include "../pthread_hooks/pthread_hooks_originals.h"
+
+int reeact_throttle_on = 0;
+int reeact_throttle_surplus = 0;
+__thread int reeact_throttle_held = 0;
+
+/*
+ * the period in milliseconds
+ */
+static int reeact_throttle_period = 0;
+static int reeact_throttle_stop = 0;
+
+/*
+ * the number of parked threads, and of threads blocked in barriers,
+ * conditional variables, semaphores and pthread_join
+ */
+static int reeact_throttle_parked = 0;
+static int reeact_throttle_blocked = 0;
+
+/*
+ * the futex word of the parked threads, incremented to release them
+ */
+static int reeact_throttle_seq = 0;
+
+/*
+ * the lock waits and the barrier episodes since the last period; barrier
+ * waits are not counted, as they come as much from load imbalance as from
+ * too many threads
+ */
+static unsigned long long reeact_throttle_lock_ns = 0;
+static unsigned long reeact_throttle_episodes = 0;
+
+/*
+ * the state of the hill climbing
+ *     locks: the lock acquisitions of all threads at the last period
+ *     rate: the rate of synchronization operations at the last step
+ *     dir: 1 if the last step parked one more thread, -1 if one less
+ *     backoff, idle: the periods to wait before parking threads again after
+ *                    the climbing has found it does not help, doubled every
+ *                    time; the periods left to wait
+ *     calm: the consecutive periods the contention has been below LOW
+ */
+static unsigned long reeact_throttle_locks = 0;
+static double reeact_throttle_rate = 0;
+static int reeact_throttle_dir = 1;
+static int reeact_throttle_backoff = 1;
+static int reeact_throttle_idle = 0;
+static int reeact_throttle_calm = 0;
+
+/*
+ * count the time waited for contended locks
+ */
+static void reeact_throttle_event(const struct reeact_event *event, void *data)
+{
+	if(event->type == REEACT_EVENT_LOCK_ACQUIRED)
+		atomic_addf(&reeact_throttle_lock_ns, event->value);
+
+	return;
+}
+
+/*
+ * release all parked threads
+ */
+static void reeact_throttle_release(void)
+{
+	atomic_addf(&reeact_throttle_seq, 1);
+	fastsync_futex_wake(&reeact_throttle_seq, INT_MAX, FUTEX_PRIVATE_FLAG);
+
+	return;
+}
+
+/*
+ * Park the calling thread if it is surplus, until it is released.
+ */
+static void reeact_throttle_park(void)
+{
+	struct reeact_thread *rec = reeact_threads_current();
+	struct timespec ts;
+	int parked, seq, i;
+
+	if(rec == NULL || rec->index <= 0 || reeact_throttle_held > 0)
+		return;
+
+	/* read before claiming, so that a release in between is not missed */
+	seq = atomic_read(reeact_throttle_seq);
+
+	/* claim a place, leaving at least one thread running */
+	do{
+		parked = atomic_read(reeact_throttle_parked);
+		if(parked >= atomic_read(reeact_throttle_surplus) ||
+		   parked + 1 + atomic_read(reeact_throttle_blocked) >=
+		   atomic_read(reeact_threads_live))
+			return;
+	}while(!atomic_bool_cmpxchg(&reeact_throttle_parked, parked,
+				    parked + 1));
+
+	/* the others may have blocked since */
+	if(atomic_read(reeact_throttle_parked) +
+	   atomic_read(reeact_throttle_blocked) >=
+	   atomic_read(reeact_threads_live)){
+		atomic_subf(&reeact_throttle_parked, 1);
+		return;
+	}
+
+	for(i = 0; i < REEACT_THROTTLE_MAX_PARK; i++){
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += reeact_throttle_period / 1000;
+		ts.tv_nsec += (reeact_throttle_period % 1000) * 1000000L;
+		if(ts.tv_nsec >= 1000000000L){
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		fastsync_futex_wait(&reeact_throttle_seq, seq, &ts,
+				    FUTEX_PRIVATE_FLAG);
+		if(atomic_read(reeact_throttle_seq) != seq)
+			break;
+	}
+
+	atomic_subf(&reeact_throttle_parked, 1);
+
+	return;
+}
+
+/*
+ * count a lock acquisition, parking the thread first if it is surplus
+ */
+void reeact_throttle_lock_entry(int park)
+{
+	struct reeact_thread *rec = reeact_threads_current();
+
+	if(rec != NULL)
+		rec->stats.locks++;
+
+	if(park && reeact_throttle_held == 0 &&
+	   atomic_read(reeact_throttle_surplus) > 0)
+		reeact_throttle_park();
+
+	return;
+}
+
+/*
+ * count the calling thread as blocked
+ */
+void reeact_throttle_wait_begin(void)
+{
+	int blocked, parked;
+
+	blocked = atomic_addf(&reeact_throttle_blocked, 1);
+	parked = atomic_read(reeact_throttle_parked);
+
+	/* no thread left running, the parked threads are waited for */
+	if(parked > 0 && blocked + parked >= atomic_read(reeact_threads_live))
+		reeact_throttle_release();
+
+	return;
+}
+
+/*
+ * count the calling thread as running again
+ */
+void reeact_throttle_wait_end(int kind, int ret_val)
+{
+	atomic_subf(&reeact_throttle_blocked, 1);
+
+	if(kind != REEACT_THROTTLE_BARRIER)
+		return;
+
+	if(ret_val == PTHREAD_BARRIER_SERIAL_THREAD)
+		atomic_addf(&reeact_throttle_episodes, 1);
+
+	if(atomic_read(reeact_throttle_surplus) > 0)
+		reeact_throttle_park();
+
+	return;
+}
+
+/*
+ * Set the number of threads to park.
+ */
+static void reeact_throttle_set(int surplus, double contention, double rate)
+{
+	int old = atomic_read(reeact_throttle_surplus);
+
+	if(surplus == old)
+		return;
+
+	atomic_read(reeact_throttle_surplus) = surplus;
+	/* the parked threads that are no longer surplus run again */
+	if(surplus < old)
+		reeact_throttle_release();
+
+	DPRINTF("%d of %d threads parked, contention %.2f, %.0f ops/s\n",
+		surplus, atomic_read(reeact_threads_live), contention, rate);
+
+	return;
+}
+
+/*
+ * Decide the number of threads to park, for a period.
+ */
+static void reeact_throttle_decide(unsigned long long period)
+{
+	struct reeact_thread *rec;
+	unsigned long long wait_ns;
+	unsigned long locks = 0, ops;
+	double contention, rate;
+	int live, surplus, active;
+
+	wait_ns = atomic_xchg(&reeact_throttle_lock_ns, 0);
+	ops = atomic_xchg(&reeact_throttle_episodes, 0);
+
+	/* the acquisitions of exited threads are lost, as their records are */
+	for(rec = reeact_threads_all(); rec != NULL; rec = rec->next)
+		if(rec->in_use)
+			locks += rec->stats.locks;
+	if(locks > reeact_throttle_locks)
+		ops += locks - reeact_throttle_locks;
+	reeact_throttle_locks = locks;
+
+	live = atomic_read(reeact_threads_live);
+	surplus = atomic_read(reeact_throttle_surplus);
+	active = live - surplus > 0 ? live - surplus : 1;
+	contention = (double)wait_ns / period / active;
+	rate = (double)ops * 1000000000.0 / period;
+
+	/* the main thread and one other thread are always active */
+	if(live <= 2){
+		reeact_throttle_set(0, contention, rate);
+		return;
+	}
+
+	if(surplus == 0){
+		if(reeact_throttle_idle > 0)
+			reeact_throttle_idle--;
+		else if(contention >= REEACT_THROTTLE_HIGH){
+			reeact_throttle_rate = rate;
+			reeact_throttle_dir = 1;
+			reeact_throttle_set(1, contention, rate);
+		}
+		return;
+	}
+
+	if(contention < REEACT_THROTTLE_LOW){
+		if(++reeact_throttle_calm >= REEACT_THROTTLE_CALM){
+			reeact_throttle_calm = 0;
+			reeact_throttle_set(0, contention, rate);
+		}
+		return;
+	}
+	reeact_throttle_calm = 0;
+
+	/* hill climbing: continue a step that helped, undo one that hurt */
+	if(rate < reeact_throttle_rate * (1 - REEACT_THROTTLE_GAIN))
+		reeact_throttle_dir = -reeact_throttle_dir;
+	else if(rate > reeact_throttle_rate * (1 + REEACT_THROTTLE_GAIN) &&
+		reeact_throttle_dir == 1)
+		reeact_throttle_backoff = 1;
+	else if(rate <= reeact_throttle_rate * (1 + REEACT_THROTTLE_GAIN)){
+		reeact_throttle_rate = rate;
+		if(surplus > live - 2)
+			reeact_throttle_set(live - 2, contention, rate);
+		return;
+	}
+	reeact_throttle_rate = rate;
+
+	surplus += reeact_throttle_dir;
+	if(surplus > live - 2)
+		surplus = live - 2;
+	if(surplus <= 0){
+		surplus = 0;
+		reeact_throttle_idle = reeact_throttle_backoff;
+		if(reeact_throttle_backoff < REEACT_THROTTLE_MAX_BACKOFF)
+			reeact_throttle_backoff *= 2;
+	}
+	reeact_throttle_set(surplus, contention, rate);
+
+	return;
+}
+
+/*
+ * The throttling thread.
+ */
+static void *reeact_throttle_thread(void *arg)
+{
+	struct timespec ts;
+	unsigned long long last, now;
+	sigset_t mask;
+
+	/* leave the signals to the application's threads */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	ts.tv_sec = reeact_throttle_period / 1000;
+	ts.tv_nsec = (reeact_throttle_period % 1000) * 1000000L;
+
+	last = reeact_events_now();
+	while(!atomic_read(reeact_throttle_stop)){
+		nanosleep(&ts, NULL);
+		now = reeact_events_now();
+		if(now == last || atomic_read(reeact_throttle_stop))
+			continue;
+		reeact_throttle_decide(now - last);
+		last = now;
+	}
+
+	return NULL;
+}
+
+/*
+ * start the throttling
+ */
+int reeact_throttle_init(void *data)
+{
+	const char *period = getenv(REEACT_THROTTLE_ENV);
+	pthread_t thread;
+	pthread_attr_t attr;
+	char *end;
+	int ret_val;
+
+	if(period == NULL || period[0] == '\0')
+		return 0;
+
+	reeact_throttle_period = strtol(period, &end, 10);
+	if(*end != '\0' || reeact_throttle_period <= 0){
+		LOGERR("Invalid %s %s, threads are not throttled\n",
+		       REEACT_THROTTLE_ENV, period);
+		return 1;
+	}
+	if(reeact_active_policy != &reeact_policy_fastsync){
+		LOGERR("Policy %s cannot park threads, threads are not "
+		       "throttled\n", reeact_active_policy->name);
+		return 1;
+	}
+
+	/* the time waited for contended locks */
+	ret_val = reeact_events_subscribe(
+		REEACT_EVENT_MASK(REEACT_EVENT_LOCK_ACQUIRED),
+		reeact_throttle_event, NULL);
+	if(ret_val)
+		LOGERR("Unable to subscribe to events, no lock contention: "
+		       "%s\n", strerror(ret_val));
+
+	reeact_throttle_on = 1;
+
+	/* bypass the hooks, this thread is not part of the application */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret_val = real_pthread_create(&thread, &attr, reeact_throttle_thread,
+				      NULL);
+	pthread_attr_destroy(&attr);
+	if(ret_val){
+		LOGERR("Unable to create throttling thread: %s\n",
+		       strerror(ret_val));
+		reeact_throttle_on = 0;
+		return 2;
+	}
+
+	DPRINTF("throttling threads every %d ms\n", reeact_throttle_period);
+
+	return 0;
+}
+
+/*
+ * stop the throttling
+ */
+int reeact_throttle_cleanup(void *data)
+{
+	atomic_read(reeact_throttle_stop) = 1;
+	atomic_read(reeact_throttle_surplus) = 0;
+	if(atomic_read(reeact_throttle_parked) > 0)
+		reeact_throttle_release();
+
+	return 0;
+}
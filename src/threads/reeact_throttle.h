@@ -0,0 +1,182 @@
+/*
+ * Header file of the REEact concurrency throttling. Lock-heavy programs often
+ * run faster with fewer threads than cores (see Pusukuri et al., PACT 2011).
+ * When the REEACT_THROTTLE environment variable gives a period in
+ * milliseconds, REEact starts a background thread that measures, every
+ * period, the contention of the application: the time its threads wait for
+ * contended locks, as a fraction of the time of its active threads. The
+ * waits at barriers are not counted, as they mostly come from load imbalance,
+ * which fewer threads do not cure. It then sets the number of surplus threads
+ * to park:
+ *     - when the contention exceeds REEACT_THROTTLE_HIGH, one thread is
+ *       parked, and the number of active threads is then adjusted by hill
+ *       climbing on the rate of synchronization operations (lock
+ *       acquisitions and barrier episodes), which is proportional to the
+ *       progress of a program with a fixed mix of them: a step that raises
+ *       the rate by REEACT_THROTTLE_GAIN is followed by another in the same
+ *       direction, a step that lowers it by as much is reversed; when the
+ *       climbing comes back to no parked thread, parking is not tried again
+ *       for a number of periods that doubles each time, up to
+ *       REEACT_THROTTLE_MAX_BACKOFF
+ *     - when the contention stays below REEACT_THROTTLE_LOW for
+ *       REEACT_THROTTLE_CALM periods, all parked threads are released
+ *
+ * Surplus threads are parked inside the hooks of the fastsync policy: when
+ * entering pthread_mutex_lock, which has no timeout that parking could
+ * outlast, or leaving pthread_barrier_wait, and only if they hold no mutex,
+ * rwlock or spinlock. The main thread, and threads not created with
+ * pthread_create, are never parked. A parked thread has not arrived at the
+ * barriers it uses, so a barrier cannot complete while a participant is
+ * parked; to keep barriers, conditional variables, semaphores and pthread_join
+ * from waiting on parked threads forever, the parked threads are released as
+ * soon as every other live thread is blocked in one of them. As the threads
+ * may also block where REEact does not see them (spinlocks, I/O, etc.), a
+ * thread is never parked for more than REEACT_THROTTLE_MAX_PARK periods at a
+ * time. Parking only changes when a thread runs, never what it does, so the
+ * number of threads is tuned without changing the application.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#ifndef __REEACT_THROTTLE_H__
+#define __REEACT_THROTTLE_H__
+
+#define REEACT_THROTTLE_ENV "REEACT_THROTTLE"
+
+/*
+ * the tuning of the throttling
+ *     HIGH: the contention at which threads start to be parked
+ *     LOW, CALM: the contention below which, for CALM periods, the parked
+ *                threads are released
+ *     GAIN: the relative change of the rate that decides a step
+ *     MAX_PARK: the maximum periods a thread is parked at a time
+ *     MAX_BACKOFF: the maximum periods parking is not tried after it has not
+ *                  helped
+ */
+#define REEACT_THROTTLE_HIGH 0.2
+#define REEACT_THROTTLE_LOW 0.05
+#define REEACT_THROTTLE_CALM 3
+#define REEACT_THROTTLE_GAIN 0.05
+#define REEACT_THROTTLE_MAX_PARK 8
+#define REEACT_THROTTLE_MAX_BACKOFF 64
+
+/*
+ * the kinds of waits reported to the throttling
+ */
+#define REEACT_THROTTLE_BARRIER 0
+#define REEACT_THROTTLE_COND 1
+#define REEACT_THROTTLE_JOIN 2
+#define REEACT_THROTTLE_SEM 3
+
+/*
+ * 1 if the threads are throttled; set at initialization
+ */
+extern int reeact_throttle_on;
+
+/*
+ * the number of threads to park, 0 when none is
+ */
+extern int reeact_throttle_surplus;
+
+/*
+ * the number of mutexes, rwlocks and spinlocks the calling thread holds,
+ * counted while the threads are throttled
+ */
+extern __thread int reeact_throttle_held;
+
+/*
+ * Start the throttling if REEACT_THROTTLE is set. The hooks of the fastsync
+ * policy park the threads, so the active policy has to be fastsync.
+ * Input parameters:
+ *     data: the data used by the user policy. By default a pointer to the
+ *           "struct reeact_data" is passed.
+ * Return value:
+ *     0: success, or REEACT_THROTTLE is not set
+ *     1: REEACT_THROTTLE is not valid, or the policy is not fastsync
+ *     2: error creating the throttling thread
+ */
+int reeact_throttle_init(void *data);
+
+/*
+ * Stop the throttling, releasing the parked threads.
+ * Input parameters:
+ *     data: the same as reeact_throttle_init
+ * Return value:
+ *     0: success
+ */
+int reeact_throttle_cleanup(void *data);
+
+/*
+ * Count a lock acquisition by the calling thread, before it acquires the
+ * lock.
+ * Input parameters:
+ *     park: 1 to park the thread first if it is surplus
+ */
+void reeact_throttle_lock_entry(int park);
+
+/*
+ * Count the calling thread as blocked, and release the parked threads if it
+ * is the last one running.
+ */
+void reeact_throttle_wait_begin(void);
+
+/*
+ * Count the calling thread as running again, and park it if it is surplus
+ * and leaving a barrier.
+ * Input parameters:
+ *     kind: REEACT_THROTTLE_*
+ *     ret_val: the result of the wait
+ */
+void reeact_throttle_wait_end(int kind, int ret_val);
+
+/*
+ * Helpers of the hooks, in the manner of REEACT_EVENTS_OBSERVE_*.
+ *
+ * REEACT_THROTTLE_LOCK returns from the hook with the result of lock_call if
+ * the threads are throttled: the acquisition is counted, the thread may be
+ * parked first if park is 1, and, once it has the lock, it is counted as
+ * holding one.
+ *
+ * REEACT_THROTTLE_UNLOCK returns from the hook with the result of
+ * unlock_call if the threads are throttled, counting the thread as holding
+ * one lock less if the lock is released.
+ *
+ * REEACT_THROTTLE_WAIT returns from the hook with the result of wait_call if
+ * the threads are throttled, counting the thread as blocked during the wait;
+ * kind is REEACT_THROTTLE_*. After a barrier, the thread may be parked.
+ */
+#define REEACT_THROTTLE_LOCK(park, lock_call)				\
+	do{								\
+		int __ret_val;						\
+		if(!reeact_throttle_on)					\
+			break;						\
+		reeact_throttle_lock_entry(park);			\
+		__ret_val = (lock_call);				\
+		if(__ret_val == 0)					\
+			reeact_throttle_held++;				\
+		return __ret_val;					\
+	} while(0)
+
+#define REEACT_THROTTLE_UNLOCK(unlock_call)				\
+	do{								\
+		int __ret_val;						\
+		if(!reeact_throttle_on)					\
+			break;						\
+		__ret_val = (unlock_call);				\
+		if(__ret_val == 0 && reeact_throttle_held > 0)		\
+			reeact_throttle_held--;				\
+		return __ret_val;					\
+	} while(0)
+
+#define REEACT_THROTTLE_WAIT(kind, wait_call)				\
+	do{								\
+		int __ret_val;						\
+		if(!reeact_throttle_on)					\
+			break;						\
+		reeact_throttle_wait_begin();				\
+		__ret_val = (wait_call);				\
+		reeact_throttle_wait_end((kind), __ret_val);		\
+		return __ret_val;					\
+	} while(0)
+
+#endif
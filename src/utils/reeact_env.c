@@ -0,0 +1,141 @@
+/*
+ * Access to the environment before libc is initialized, for the earliest
+ * constructors and hooks of libreeact.so, which decide the policy and the
+ * process selection without relying on getenv. Until libc has set up 
+ * environ, the functions here read the environment the process was started
+ * with directly from the initial stack left by the dynamic linker: argc, 
+ * followed by the argv pointers, a NULL, and the envp pointers. They call no
+ * libc function.
+ *
+ * The process selection (REEACT_ALLOW and REEACT_DENY) is decided here too.
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "reeact_utils.h"
+
+/*
+ * the initial stack pointer, set by the dynamic linker; in a static program
+ * it is set differently, but libc is initialized before any code here runs
+ */
+extern void *__libc_stack_end;
+
+/*
+ * getenv that works before libc is initialized
+ */
+const char *reeact_getenv_early(const char *name)
+{
+	long *sp = (long*)__libc_stack_end;
+	char **envp = environ;
+	const char *e, *n;
+
+	if(name == NULL)
+		return NULL;
+
+	if(envp == NULL){
+		/* libc is not initialized */
+		if(sp == NULL)
+			return NULL;
+		/* skip argc and the argv pointers, and the terminating NULL */
+		envp = (char**)(sp + 1 + sp[0] + 1);
+	}
+
+	for(; *envp != NULL; envp++){
+		for(e = *envp, n = name; *n != '\0' && *e == *n; e++, n++)
+			;
+		if(*n == '\0' && *e == '=')
+			return e + 1;
+	}
+
+	return NULL;
+}
+
+/*
+ * strcmp that works before libc is initialized; only tells whether two 
+ * strings are equal
+ */
+int reeact_streq_early(const char *s1, const char *s2)
+{
+	for(; *s1 != '\0' && *s1 == *s2; s1++, s2++)
+		;
+
+	return *s1 == *s2;
+}
+
+/*
+ * the base name of the program, from argv[0], before libc is initialized
+ */
+const char *reeact_progname_early(void)
+{
+	long *sp = (long*)__libc_stack_end;
+	const char *name, *p;
+
+	/* set by libc at initialization */
+	if(program_invocation_short_name != NULL &&
+	   program_invocation_short_name[0] != '\0')
+		return program_invocation_short_name;
+
+	if(sp == NULL || sp[0] < 1 || (char*)sp[1] == NULL)
+		return "";
+
+	name = (const char*)sp[1];
+	for(p = name; *p != '\0'; p++)
+		if(*p == '/')
+			name = p + 1;
+
+	return name;
+}
+
+/*
+ * Check whether a name is in a list of names separated by ',' or ':'.
+ */
+static int reeact_list_has(const char *list, const char *name)
+{
+	const char *n;
+
+	while(*list != '\0'){
+		for(n = name; *n != '\0' && *list == *n; list++, n++)
+			;
+		if(*n == '\0' && (*list == '\0' || *list == ',' || 
+				   *list == ':'))
+			return 1;
+		/* skip to the next name */
+		while(*list != '\0' && *list != ',' && *list != ':')
+			list++;
+		if(*list != '\0')
+			list++;
+	}
+
+	return 0;
+}
+
+/*
+ * whether REEact is active in this process, decided once
+ */
+static int reeact_selected = -1;
+
+int reeact_proc_selected(void)
+{
+	const char *allow, *deny, *name;
+	int selected = 1;
+
+	if(reeact_selected != -1)
+		return reeact_selected;
+
+	name = reeact_progname_early();
+	allow = reeact_getenv_early(REEACT_ALLOW_ENV);
+	deny = reeact_getenv_early(REEACT_DENY_ENV);
+	if(allow != NULL && allow[0] != '\0' && !reeact_list_has(allow, name))
+		selected = 0;
+	if(deny != NULL && reeact_list_has(deny, name))
+		selected = 0;
+
+	reeact_selected = selected;
+
+	return selected;
+}
@@ -380,6 +380,195 @@ int reeact_get_topo_conf(int **nodes, int **cores, int *socket_cnt,
 	
 }
 
+/*
+ * Read the first line of a file into buf, without the trailing newline; buf
+ * and buf_size are as in getline.
+ * Return value:
+ *     0: success
+ *     2: unable to open or read the file
+ */
+static int reeact_read_first_line(const char *fname, char **buf,
+				  size_t *buf_size)
+{
+	FILE *fp;
+	int ln_len;
+
+	fp = fopen(fname, "r");
+	if(fp == NULL){
+		LOGERRX("Unable to open file %s: ", fname);
+		return 2;
+	}
+	ln_len = getline(buf, buf_size, fp);
+	fclose(fp);
+	if(ln_len == -1){
+		LOGERRX("Unable to read line from file %s: ", fname);
+		return 2;
+	}
+	if((*buf)[ln_len-1] == '\n')
+		(*buf)[ln_len-1] = '\0';
+
+	return 0;
+}
+
+/*
+ * Get the mapping from cpu ids (SMT contexts included) to node ids from sysfs.
+ */
+int reeact_get_cpu_node_map(int **cpu_nodes, int *cpu_cnt)
+{
+	char filename[256] = {0};
+	char *buf = NULL;
+	size_t buf_size;
+	int ret_val;
+	int *node_ids = NULL, node_cnt;
+	int *ctx_ids, ctx_cnt;
+	int i,j;
+
+	if(cpu_nodes == NULL || cpu_cnt == NULL){
+		LOGERR("wrong parameter\n");
+		return 1;
+	}
+	*cpu_nodes = NULL;
+	*cpu_cnt = 0;
+
+	/*
+	 * the largest cpu id determines the size of the map
+	 */
+	ret_val = reeact_read_first_line(ONLINE_CPU_LIST, &buf, &buf_size);
+	if(ret_val)
+		goto error;
+	ret_val = parse_value_list_expand(buf, (void**)&ctx_ids, &ctx_cnt, 0);
+	if(ret_val){
+		LOGERR("Unable to parse online cpu list, error %d\n", ret_val);
+		ret_val = 2;
+		goto error;
+	}
+	for(i = 0; i < ctx_cnt; i++){
+		if(ctx_ids[i] + 1 > *cpu_cnt)
+			*cpu_cnt = ctx_ids[i] + 1;
+	}
+	free(ctx_ids);
+
+	*cpu_nodes = (int*)malloc(*cpu_cnt * sizeof(int));
+	if(*cpu_nodes == NULL){
+		LOGERRX("Unable to allocate space for cpu to node mapping: ");
+		ret_val = 3;
+		goto error;
+	}
+	for(i = 0; i < *cpu_cnt; i++)
+		(*cpu_nodes)[i] = -1;
+
+	/*
+	 * assign the cpus listed by each node
+	 */
+	ret_val = reeact_read_first_line(ONLINE_NODE_LIST, &buf, &buf_size);
+	if(ret_val)
+		goto error;
+	ret_val = parse_value_list_expand(buf, (void**)&node_ids, &node_cnt, 0);
+	if(ret_val){
+		LOGERR("Unable to parse online node list, error %d\n", ret_val);
+		ret_val = 2;
+		goto error;
+	}
+	for(i = 0; i < node_cnt; i++){
+		sprintf(filename, "%s%d/%s", NODE_INFO_DIRECTORY, node_ids[i], 
+			NODE_CORE_LIST_FILE);
+		ret_val = reeact_read_first_line(filename, &buf, &buf_size);
+		if(ret_val)
+			goto error;
+		ret_val = parse_value_list_expand(buf, (void**)&ctx_ids, 
+						  &ctx_cnt, 0);
+		if(ret_val){
+			LOGERR("Unable to parse node %d's contexts, error %d\n",
+			       node_ids[i], ret_val);
+			ret_val = 2;
+			goto error;
+		}
+		for(j = 0; j < ctx_cnt; j++){
+			if(ctx_ids[j] < *cpu_cnt)
+				(*cpu_nodes)[ctx_ids[j]] = node_ids[i];
+		}
+		if(ctx_ids != NULL)
+			free(ctx_ids);
+	}
+
+	/* cleanup */
+	if(node_ids)
+		free(node_ids);
+	if(buf)
+		free(buf);
+
+	return 0;
+
+error:
+	if(*cpu_nodes)
+		free(*cpu_nodes);
+	*cpu_nodes = NULL;
+	*cpu_cnt = 0;
+	if(node_ids)
+		free(node_ids);
+	if(buf)
+		free(buf);
+
+	return ret_val;
+}
+
+/*
+ * Get the mapping from cpu ids (SMT contexts included) to core ids from sysfs.
+ */
+int reeact_get_cpu_core_map(int **cpu_cores, int *cpu_nodes, int cpu_cnt)
+{
+	char filename[256] = {0};
+	FILE *fp;
+	char *buf = NULL;
+	size_t buf_size;
+	int ln_len;
+	int *contexts, ctx_cnt;
+	int i, j;
+
+	if(cpu_cores == NULL || cpu_nodes == NULL){
+		LOGERR("wrong parameter\n");
+		return 1;
+	}
+
+	*cpu_cores = (int*)malloc(cpu_cnt * sizeof(int));
+	if(*cpu_cores == NULL){
+		LOGERRX("Unable to allocate space for cpu to core mapping: ");
+		return 3;
+	}
+
+	for(i = 0; i < cpu_cnt; i++){
+		(*cpu_cores)[i] = -1;
+		if(cpu_nodes[i] == -1)
+			continue; // not online
+		/* the core is named by its first SMT context */
+		(*cpu_cores)[i] = i;
+		sprintf(filename, "%s%d/%s", CPU_INFO_DIRECTORY, i, 
+			CPU_CONTEXT_LIST_FILE);
+		fp = fopen(filename, "r");
+		if(fp == NULL)
+			continue;
+		ln_len = getline(&buf, &buf_size, fp);
+		fclose(fp);
+		if(ln_len == -1)
+			continue;
+		if(buf[ln_len-1] == '\n')
+			buf[ln_len-1] = '\0';
+		if(parse_value_list_expand(buf, (void**)&contexts, &ctx_cnt, 0))
+			continue;
+		for(j = 0; j < ctx_cnt; j++)
+			if(contexts[j] < (*cpu_cores)[i])
+				(*cpu_cores)[i] = contexts[j];
+		if(contexts != NULL)
+			free(contexts);
+	}
+
+	/* cleanup */
+	if(buf)
+		free(buf);
+
+	return 0;
+}
+
 /*
  * Get the processor topology of current machine
  */
@@ -85,9 +85,83 @@ int reeact_log_errx(const char *fmt, ...);
  */
 int reeact_get_topology(int **nodes, int **cores, int *socket_cnt, 
 			int *node_cnt, int *core_cnt);
+/*
+ * Determine the node of each cpu (SMT contexts included) of current machine.
+ * Output parameters:
+ *    cpu_nodes: array of node ids indexed by cpu id, -1 for cpus that are not
+ *               online; array allocated by this function, caller should 
+ *               de-allocate it.
+ *    cpu_cnt: the number of entries in cpu_nodes, i.e., the largest online 
+ *             cpu id plus one
+ * Return value:
+ *    0: success
+ *    1: one of the output parameter is NULL
+ *    2: error reading topology
+ *    3: error allocating space
+ */
+int reeact_get_cpu_node_map(int **cpu_nodes, int *cpu_cnt);
+
+/*
+ * Determine the core of each cpu (SMT contexts included) of current machine.
+ * A core is named by the id of its first SMT context, so the cpus with the
+ * same core id are SMT siblings.
+ * Input parameters:
+ *    cpu_nodes, cpu_cnt: as returned by reeact_get_cpu_node_map
+ * Output parameters:
+ *    cpu_cores: array of core ids indexed by cpu id, -1 for cpus that are not
+ *               online; a cpu whose siblings cannot be read is its own core.
+ *               Array allocated by this function, caller should de-allocate
+ *               it.
+ * Return value:
+ *    0: success
+ *    1: one of the parameters is NULL
+ *    3: error allocating space
+ */
+int reeact_get_cpu_core_map(int **cpu_cores, int *cpu_nodes, int cpu_cnt);
+
 /*
  * user configure file with topology information
  */
 #define REEACT_USER_TOPOLOGY_CONFIG "REEACT_TOPO_CONFIG"
 
+/*
+ * Look up an environment variable before libc is initialized, where getenv
+ * does not work yet. Only the environment the
+ * process was started with is searched; later setenv calls are not seen.
+ * Input parameters:
+ *    name: the name of the variable
+ * Return value:
+ *    the value of the variable; NULL if the variable is not set
+ */
+const char *reeact_getenv_early(const char *name);
+
+/*
+ * Compare two strings before libc is initialized.
+ * Return value:
+ *    1 if the strings are equal, 0 otherwise
+ */
+int reeact_streq_early(const char *s1, const char *s2);
+
+/*
+ * Get the base name of the program (argv[0] without the path) before libc is
+ * initialized, i.e., program_invocation_short_name.
+ */
+const char *reeact_progname_early(void);
+
+/*
+ * Process selection. A launcher may export LD_PRELOAD to every process it
+ * starts, including shells and helpers that do not need REEact. REEact is
+ * only active in the processes selected by the following environment 
+ * variables, each a list of program base names separated by ',' or ':':
+ *     REEACT_ALLOW: if set and not empty, only these programs are selected
+ *     REEACT_DENY: these programs are never selected
+ * In a process that is not selected, REEact does not initialize, and the
+ * passthrough policy stays active, so the hooks call the originals.
+ * Return value:
+ *    1 if REEact is active in this process, 0 otherwise
+ */
+#define REEACT_ALLOW_ENV "REEACT_ALLOW"
+#define REEACT_DENY_ENV "REEACT_DENY"
+int reeact_proc_selected(void);
+
 #endif
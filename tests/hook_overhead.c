@@ -0,0 +1,155 @@
+/*
+ * Simple program to measure the per-call overhead of the REEact pthread
+ * hooks. A single thread repeatedly acquires and releases an uncontended
+ * synchronization object, so the time per pair is dominated by the call path
+ * rather than by synchronization. Run it without REEact, then preloaded with
+ * REEact under different policies, e.g.,
+ *
+ *     ./hookbench -m 10000000
+ *     LD_PRELOAD=libreeact.so REEACT_POLICY=passthrough ./hookbench -m 10000000
+ *     LD_PRELOAD=libreeact.so REEACT_POLICY=fastsync ./hookbench -m 10000000
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+/*
+ * the objects measured
+ */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_spinlock_t spin;
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static sem_t sem;
+static pthread_barrier_t barrier;
+
+/*
+ * print the program usage (the command line parameter usage)
+ */
+int print_usage()
+{
+	char * usage =
+		"Usage: hookbench [options]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help"
+		"\t show this help message and exit\n"
+		"  -m ITERS, --iters=ITERS\n"
+		"\t the number of acquire/release pairs per object; "
+		"default 10000000\n";
+
+	fprintf(stderr, "%s\n", usage);
+
+	return 0;
+}
+
+/*
+ * get the elapsed time in nanoseconds
+ */
+double get_elapsed_ns(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 +
+		(end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char *argv[])
+{
+	struct option long_params[] = {
+		{"iters", required_argument, 0, 1001},
+		{"help", no_argument, 0, 1002},
+		{0, 0, 0, 0},
+	};
+	struct timespec start, end;
+	unsigned long long iters = 10000000, i;
+	int long_index = 0;
+	int opt;
+
+	while((opt = getopt_long(argc, argv, "m:h", long_params,
+				 &long_index)) != -1){
+		switch (opt) {
+		case 'm':
+		case 1001:
+			iters = strtoull(optarg, NULL, 0);
+			break;
+		case 'h':
+		case 1002:
+			print_usage();
+			exit(0);
+		default:
+			print_usage();
+			exit(-1);
+		}
+	}
+	if(iters == 0){
+		print_usage();
+		exit(-1);
+	}
+
+	pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+	sem_init(&sem, 0, 0);
+	pthread_barrier_init(&barrier, NULL, 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++){
+		pthread_mutex_lock(&mutex);
+		pthread_mutex_unlock(&mutex);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("mutex lock/unlock: %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++){
+		pthread_spin_lock(&spin);
+		pthread_spin_unlock(&spin);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("spin lock/unlock: %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++){
+		pthread_rwlock_rdlock(&rwlock);
+		pthread_rwlock_unlock(&rwlock);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("rwlock rdlock/unlock: %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++){
+		sem_post(&sem);
+		sem_wait(&sem);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("sem post/wait: %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++)
+		pthread_cond_signal(&cond);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("cond signal (no waiter): %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < iters; i++)
+		pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("barrier wait (one thread): %.2f ns\n",
+	       get_elapsed_ns(&start, &end) / iters);
+
+	pthread_spin_destroy(&spin);
+	sem_destroy(&sem);
+	pthread_barrier_destroy(&barrier);
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Simple program to measure the start-up cost REEact adds to a process. It
+ * runs a short-lived command many times, optionally with REEact preloaded,
+ * and reports the average time from fork to exit. For example, to see what
+ * the shells and helpers started by a launcher pay when they are excluded
+ * from REEact:
+ *
+ *     ./startbench -n 500 /bin/true
+ *     ./startbench -n 500 -p ../lib/libreeact.so /bin/true
+ *     REEACT_DENY=true ./startbench -n 500 -p ../lib/libreeact.so /bin/true
+ *
+ * Author: Wei Wang <wwang@virginia.edu>
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <err.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * print the program usage (the command line parameter usage)
+ */
+int print_usage()
+{
+	char * usage =
+		"Usage: startbench [options] COMMAND [ARGS...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help"
+		"\t show this help message and exit\n"
+		"  -n RUNS, --runs=RUNS\n"
+		"\t how many times to run the command; default 200\n"
+		"  -p LIBRARY, --preload=LIBRARY\n"
+		"\t the library to preload into the command, e.g., "
+		"libreeact.so\n";
+
+	fprintf(stderr, "%s\n", usage);
+
+	return 0;
+}
+
+/*
+ * get the elapsed time in nanoseconds
+ */
+double get_elapsed_ns(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 +
+		(end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char *argv[])
+{
+	struct option long_params[] = {
+		{"runs", required_argument, 0, 1001},
+		{"preload", required_argument, 0, 1002},
+		{"help", no_argument, 0, 1003},
+		{0, 0, 0, 0},
+	};
+	struct timespec start, end;
+	char *preload = NULL;
+	int runs = 200, i, status;
+	int long_index = 0;
+	int opt;
+	pid_t pid;
+
+	/* stop at the command, its options are its own */
+	while((opt = getopt_long(argc, argv, "+n:p:h", long_params,
+				 &long_index)) != -1){
+		switch (opt) {
+		case 'n':
+		case 1001:
+			runs = atoi(optarg);
+			break;
+		case 'p':
+		case 1002:
+			preload = optarg;
+			break;
+		case 'h':
+		case 1003:
+			print_usage();
+			exit(0);
+		default:
+			print_usage();
+			exit(-1);
+		}
+	}
+	if(runs <= 0 || optind >= argc){
+		print_usage();
+		exit(-1);
+	}
+
+	/* only the command is preloaded, not this program */
+	if(preload != NULL && setenv("LD_PRELOAD", preload, 1) != 0)
+		err(1, "Unable to set LD_PRELOAD:");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < runs; i++){
+		pid = fork();
+		if(pid == -1)
+			err(2, "Unable to fork:");
+		if(pid == 0){
+			execvp(argv[optind], argv + optind);
+			err(3, "Unable to run %s:", argv[optind]);
+		}
+		if(waitpid(pid, &status, 0) == -1)
+			err(4, "Unable to wait for %s:", argv[optind]);
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			errx(5, "%s failed", argv[optind]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%s: %.1f us per run (%d runs)\n", argv[optind],
+	       get_elapsed_ns(&start, &end) / runs / 1000, runs);
+
+	return 0;
+}
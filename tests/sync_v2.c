@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <err.h>
 #include <dlfcn.h>
 #include <sys/time.h>
@@ -18,9 +19,33 @@
 #include <common_toolx.h>
 
 #include "sync_worker_func.h"
+#include "../src/fastsync/fastsync.h"
+#ifdef _REEACT_WRAP_
+#include "../src/policies/reeact_policy.h"
+#include "../src/events/reeact_events.h"
+#endif
 
 #define MAX_CORES 256 // the maximum number of cores this program can use
 #define MAX_THREADS 16384 // the maximum number of threads
+#define QUEUE_SIZE 64 // the capacity of the producer-consumer queues
+
+typedef struct _pthread_queue{ // a bounded queue protected by pthread
+                               // mutex and condition variables
+	pthread_mutex_t mtx; // the mutex protecting the queue
+	pthread_cond_t not_empty; // consumers wait here on empty
+	pthread_cond_t not_full; // producers wait here on full
+	void *items[QUEUE_SIZE]; // the ring of items
+	int head; // the next item to dequeue
+	int cnt; // the number of items in the queue
+}pthread_queue;
+
+typedef struct _fastsync_queue_funcs{ // fastsync queue functions, found in
+                                      // the preloaded REEact library
+	int (*init)(fastsync_queue*, unsigned long);
+	int (*enqueue)(fastsync_queue*, void*);
+	int (*dequeue)(fastsync_queue*, void**);
+	int (*destroy)(fastsync_queue*);
+}fastsync_queue_funcs;
 
 typedef struct _cmd_params{ // data structure for command line parameters
 	int thr_cnt; // worker thread count
@@ -50,6 +75,9 @@ typedef struct _thr_params{ // data structure for thread function parameters
 	pthread_cond_t *all_start; // "all-start" condition for all threads
 	pthread_mutex_t *cond_mtx; // the mutex for the "all-start" condition
 	pthread_mutex_t *mutex; // the mutex for synchronization test
+	sem_t *gate; // the semaphore for synchronization test
+	pthread_queue *pq; // the pthread queue for producer-consumer test
+	fastsync_queue *fq; // the fastsync queue for producer-consumer test
 }thr_params;
 
 /*
@@ -57,6 +85,113 @@ typedef struct _thr_params{ // data structure for thread function parameters
  */
 unsigned long long critical_counter = 0;
 
+/*
+ * the fastsync queue functions
+ */
+fastsync_queue_funcs fq_funcs;
+
+#ifdef _REEACT_WRAP_
+/*
+ * the barrier episodes reported by REEact's events, to check that the
+ * barrier went through the hooks
+ */
+unsigned long long barrier_episodes = 0;
+
+void count_barrier_episode(const struct reeact_event *event, void *data)
+{
+	barrier_episodes++;
+}
+#endif
+
+/*
+ * enqueue an item into a pthread queue, waiting if the queue is full
+ */
+void pthread_queue_enqueue(pthread_queue *q, void *item)
+{
+	pthread_mutex_lock(&(q->mtx));
+	while(q->cnt == QUEUE_SIZE)
+		pthread_cond_wait(&(q->not_full), &(q->mtx));
+	q->items[(q->head + q->cnt) % QUEUE_SIZE] = item;
+	q->cnt++;
+	pthread_mutex_unlock(&(q->mtx));
+	pthread_cond_signal(&(q->not_empty));
+}
+
+/*
+ * dequeue an item from a pthread queue, waiting if the queue is empty
+ */
+void * pthread_queue_dequeue(pthread_queue *q)
+{
+	void *item;
+
+	pthread_mutex_lock(&(q->mtx));
+	while(q->cnt == 0)
+		pthread_cond_wait(&(q->not_empty), &(q->mtx));
+	item = q->items[q->head];
+	q->head = (q->head + 1) % QUEUE_SIZE;
+	q->cnt--;
+	pthread_mutex_unlock(&(q->mtx));
+	pthread_cond_signal(&(q->not_full));
+
+	return item;
+}
+
+/*
+ * Producer-consumer synchronization: even threads produce and odd threads
+ * consume. With an odd thread count, the last thread consumes its own item.
+ */
+void producer_consumer(thr_params *args)
+{
+	cmd_params *p = args->cmd_params;
+	void *item = (void*)1;
+	int produce = (args->tidx % 2 == 0);
+	int consume = (args->tidx % 2 == 1) || 
+		(args->tidx == p->thr_cnt - 1);
+
+	if(produce){
+		if(p->sync_type == 4)
+			pthread_queue_enqueue(args->pq, item);
+		else
+			fq_funcs.enqueue(args->fq, item);
+	}
+
+	if(consume){
+		if(p->sync_type == 4)
+			item = pthread_queue_dequeue(args->pq);
+		else
+			fq_funcs.dequeue(args->fq, &item);
+		__sync_fetch_and_add(&critical_counter, (unsigned long)item);
+	}
+}
+
+/*
+ * find the fastsync queue functions in the preloaded REEact library
+ */
+int open_fastsync_queue()
+{
+#ifdef _REEACT_WRAP_
+	// statically linked with REEact
+	fq_funcs.init = fastsync_queue_init;
+	fq_funcs.enqueue = fastsync_queue_enqueue;
+	fq_funcs.dequeue = fastsync_queue_dequeue;
+	fq_funcs.destroy = fastsync_queue_destroy;
+#else
+	fq_funcs.init = dlsym(RTLD_DEFAULT, "fastsync_queue_init");
+	fq_funcs.enqueue = dlsym(RTLD_DEFAULT, "fastsync_queue_enqueue");
+	fq_funcs.dequeue = dlsym(RTLD_DEFAULT, "fastsync_queue_dequeue");
+	fq_funcs.destroy = dlsym(RTLD_DEFAULT, "fastsync_queue_destroy");
+
+	if(fq_funcs.init == NULL || fq_funcs.enqueue == NULL || 
+	   fq_funcs.dequeue == NULL || fq_funcs.destroy == NULL){
+		fprintf(stderr, "Unable to find the fastsync queue; please "
+			"preload the REEact library\n");
+		exit(6);
+	}
+#endif
+
+	return 0;
+}
+
 /*
  * initialized the values of the command line parameters
  */
@@ -135,7 +270,9 @@ int print_usage()
 		"\t the name of the working function\n"
 		" -s SYNC_TYPE --sync=SYNC_TYPE\n"
 		"\t the type of synchronization: 0: barrier, 1: mutex, 2: "
-		"conditional variable; default 0\n"
+		"conditional variable, 3: semaphore, 4: producer-consumer with "
+		"pthread queue, 5: producer-consumer with fastsync queue "
+		"(requires preloading REEact); default 0\n"
 		"  -d, --debug\n"
 		"\t enable debug output\n"
 		"  -v, --verbose\n"
@@ -372,6 +509,19 @@ void * thread_func(void * thr_args)
 			if(ret_val != 0 && 
 			   ret_val != PTHREAD_BARRIER_SERIAL_THREAD) 
 				warn("Error waiting for barrier");
+			break;
+		case 3:
+			ret_val = sem_wait(args->gate);
+			sync_called++;
+			__sync_fetch_and_add(&critical_counter, 1);
+			ret_val = sem_post(args->gate);
+			ret_val = pthread_barrier_wait(args->sync_point);
+			break;
+		case 4:
+		case 5:
+			sync_called++;
+			producer_consumer(args);
+			break;
 		}
 	}
 
@@ -394,6 +544,20 @@ void * thread_func(void * thr_args)
  */
 int open_worker_func(cmd_params * p)
 {
+#ifdef _REEACT_WRAP_
+	// statically linked with the worker functions, the library is ignored
+	if(strcmp(p->func_name, "add_worker") == 0)
+		p->func = add_worker;
+	else if(strcmp(p->func_name, "div_worker") == 0)
+		p->func = div_worker;
+	else if(strcmp(p->func_name, "mul_worker") == 0)
+		p->func = mul_worker;
+	else{
+		fprintf(stderr, "Error opening worker function %s\n",
+			p->func_name);
+		exit(5);
+	}
+#else
 	char *error = NULL;
 
 	// open the library
@@ -414,6 +578,7 @@ int open_worker_func(cmd_params * p)
 			"%s\n", p->func_name, error);
 		exit(5);
 	}
+#endif
 
 	return 0;
 }
@@ -433,6 +598,9 @@ int main(int argc, char * argv[])
 	pthread_cond_t all_start  = PTHREAD_COND_INITIALIZER;
 	pthread_mutex_t cond_mtx = PTHREAD_MUTEX_INITIALIZER;
 	pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+	sem_t gate;
+	pthread_queue pq;
+	fastsync_queue fq;
 	
 	// read in command line parameters
 	init_parameters(&params);
@@ -446,6 +614,28 @@ int main(int argc, char * argv[])
 	ret_val = pthread_barrier_init(&sync_point, NULL, params.thr_cnt);
 	if(ret_val != 0)
 		err(3, "Error initializing barrier");
+#ifdef _REEACT_WRAP_
+	reeact_events_subscribe(REEACT_EVENT_MASK(REEACT_EVENT_BARRIER_DONE),
+				count_barrier_episode, NULL);
+#endif
+
+	// initialized the semaphore; let half of the threads in at a time
+	ret_val = sem_init(&gate, 0, params.thr_cnt > 1 ? params.thr_cnt / 2 : 1);
+	if(ret_val != 0)
+		err(3, "Error initializing semaphore");
+
+	// initialized the producer-consumer queues
+	pthread_mutex_init(&(pq.mtx), NULL);
+	pthread_cond_init(&(pq.not_empty), NULL);
+	pthread_cond_init(&(pq.not_full), NULL);
+	pq.head = pq.cnt = 0;
+	if(params.sync_type == 5){
+		open_fastsync_queue();
+		ret_val = fq_funcs.init(&fq, QUEUE_SIZE);
+		if(ret_val != 0)
+			errx(3, "Error initializing fastsync queue: %d", 
+			     ret_val);
+	}
 
 	// create worker threads
 	thr_trials = params.total_iters / params.thr_cnt; // trials per thread
@@ -461,6 +651,9 @@ int main(int argc, char * argv[])
 		thr_args[t].all_start = &all_start;
 		thr_args[t].total_iters = thr_trials;
 		thr_args[t].mutex = &mtx;
+		thr_args[t].gate = &gate;
+		thr_args[t].pq = &pq;
+		thr_args[t].fq = &fq;
 		if(extra_trials > 0){
 			thr_args[t].extra_trial = 1;
 			extra_trials--;
@@ -504,10 +697,25 @@ int main(int argc, char * argv[])
 	printf("All threads finished in %f seconds\n", 
 	       get_elapsed_time(&start, &end));
 	printf("Critical counter value is %llu\n", critical_counter);
+#ifdef _REEACT_WRAP_
+	printf("REEact policy is %s\n", reeact_active_policy->name);
+	// a fastsync barrier counts its episodes in seq
+	reeact_events_poll();
+	printf("REEact barrier episodes %llu, fastsync barrier seq %u\n",
+	       barrier_episodes, ((fastsync_barrier*)&sync_point)->seq);
+#endif
 
 	// clean up
 	pthread_barrier_destroy(&sync_point);
+	sem_destroy(&gate);
+	pthread_mutex_destroy(&(pq.mtx));
+	pthread_cond_destroy(&(pq.not_empty));
+	pthread_cond_destroy(&(pq.not_full));
+	if(params.sync_type == 5)
+		fq_funcs.destroy(&fq);
+#ifndef _REEACT_WRAP_
 	dlclose(params.lib);
+#endif
 	
 	return 0;
 }
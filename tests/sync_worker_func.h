@@ -10,4 +10,11 @@
 
 typedef unsigned long long (*worker_func)(void *);
 
+/*
+ * the worker functions of sync_worker_lib.c
+ */
+unsigned long long add_worker(void * args);
+unsigned long long div_worker(void * args);
+unsigned long long mul_worker(void * args);
+
 #endif